@@ -0,0 +1,99 @@
+/**
+ * @file bench.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Timing and reporting helpers shared by the benchmarks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencyStats {
+    double mean_us = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double p999_us = 0;
+    double ops_per_s = 0;
+};
+
+/**
+ * @brief Run `operation` `iterations` times, and return time taken by each
+ */
+template <typename Operation>
+std::vector<Clock::duration> measureLatencies(unsigned int iterations,
+                                              Operation &&operation) {
+    auto samples = std::vector<Clock::duration>();
+    samples.reserve(iterations);
+    for (auto i = 0u; i < iterations; ++i) {
+        auto start = Clock::now();
+        operation(i);
+        samples.push_back(Clock::now() - start);
+    }
+
+    return samples;
+}
+
+/**
+ * @brief Percentiles of `samples`, `wall_time` is used for ops/s, so it
+ * works for samples collected from many threads too
+ */
+inline LatencyStats computeLatencyStats(std::vector<Clock::duration> samples,
+                                        Clock::duration wall_time) {
+    auto stats = LatencyStats();
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto to_us = [](Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    };
+    auto percentile = [&samples, &to_us](double fraction) {
+        auto index = size_t(fraction * double(samples.size() - 1));
+        return to_us(samples[index]);
+    };
+
+    auto total = Clock::duration::zero();
+    for (const auto &sample : samples) {
+        total += sample;
+    }
+
+    stats.mean_us = to_us(total) / double(samples.size());
+    stats.p50_us = percentile(0.50);
+    stats.p99_us = percentile(0.99);
+    stats.p999_us = percentile(0.999);
+    stats.ops_per_s = double(samples.size()) /
+                      std::chrono::duration<double>(wall_time).count();
+    return stats;
+}
+
+inline LatencyStats computeLatencyStats(std::vector<Clock::duration> samples) {
+    auto wall_time = Clock::duration::zero();
+    for (const auto &sample : samples) {
+        wall_time += sample;
+    }
+
+    return computeLatencyStats(std::move(samples), wall_time);
+}
+
+inline void printLatencyHeader(const std::string &first_column) {
+    std::printf("%-28s %10s %10s %10s %10s %12s\n", first_column.c_str(),
+                "mean(us)", "p50(us)", "p99(us)", "p999(us)", "ops/s");
+}
+
+inline void printLatencyRow(const std::string &label,
+                            const LatencyStats &stats) {
+    std::printf("%-28s %10.1f %10.1f %10.1f %10.1f %12.0f\n", label.c_str(),
+                stats.mean_us, stats.p50_us, stats.p99_us, stats.p999_us,
+                stats.ops_per_s);
+}
@@ -0,0 +1,129 @@
+/**
+ * @file bulk_transfer.cpp
+ * @brief Throughput of pulling 1 MB from a BulkTransferService with a
+ * BulkTransferClient, for chunk sizes of 20 to 500 bytes and windows of 1 to
+ * 64 chunks
+ *
+ * Notifications go over the AcquireNotify socket, straight from the
+ * application to the client, so this measures the protocol and the
+ * library's own cost, not the radio
+ *
+ * Usage: ./bench_bulk_transfer [size in KB]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "ble/bulk_transfer_client.h"
+#include "ble/peripheral.h"
+#include "mock/bluez.h"
+#include "mock/private_bus.h"
+
+#include "sdbus-c++/sdbus-c++.h"
+
+using std::cout, std::endl, std::string, std::vector;
+
+const auto DEFAULT_SIZE_KB = 1024u;
+const vector<u16> CHUNK_SIZES_B = {20, 128, 244, 500};
+const vector<u16> WINDOWS = {1, 4, 16, 64};
+
+class BenchApplication : public Application {
+  public:
+    BenchApplication(BusContext &context,
+                     const std::string &application_object_path)
+        : Application(context, application_object_path) {}
+
+    void onInterfacesAdded(
+        const sdbus::ObjectPath &object_path,
+        const std::map<std::string, std::map<std::string, sdbus::Variant>>
+            &interfaces_and_properties) override {}
+    void
+    onInterfacesRemoved(const sdbus::ObjectPath &object_path,
+                        const std::vector<std::string> &interfaces) override {}
+};
+
+/**
+ * @brief Wait till the last client's notify socket is released by the
+ * application, else the next AcquireNotify is refused, and the client falls
+ * back to PropertiesChanged
+ */
+void waitForNotifyRelease(sdbus::IConnection &connection,
+                          const string &server_name, const string &data_path) {
+    auto proxy = sdbus::createProxy(connection, server_name, data_path);
+    while (proxy->getProperty("NotifyAcquired")
+               .onInterface("org.bluez.GattCharacteristic1")
+               .get<bool>()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    auto size_kb = DEFAULT_SIZE_KB;
+    if (argc > 1) {
+        size_kb = std::stoul(argv[1]);
+    }
+
+    auto bus = PrivateBus();
+    cout << "Private bus: " << bus.getAddress() << endl;
+
+    auto config = MockBluezConfig();
+    config.devices_per_adapter = 0;
+    auto bluez_connection = sdbus::createSystemBusConnection();
+    auto bluez = MockBluez(*bluez_connection, config);
+    bluez_connection->enterEventLoopAsync();
+
+    auto server_context = BusContext(sdbus::createSystemBusConnection());
+    auto application = BenchApplication(server_context, "/bench");
+    auto &service = application.addService<BulkTransferService>(
+        0, bulk_transfer::SERVICE_UUID);
+    application.registerWithGattManager(bluez.getAdapterPath(0)).get();
+
+    auto data = vector<u8>(size_t(size_kb) * 1024);
+    for (auto i = size_t(0); i < data.size(); ++i) {
+        data[i] = u8(i * 31 + i / 256);
+    }
+    service.setData(data);
+
+    const auto server_name = server_context.getConnection().getUniqueName();
+    auto client_context = BusContext(sdbus::createSystemBusConnection());
+
+    std::printf("%-20s %14s %14s %8s\n", "chunk/window", "client(KB/s)",
+                "server(KB/s)", "intact");
+    for (auto chunk_b : CHUNK_SIZES_B) {
+        for (auto window : WINDOWS) {
+            auto transfer_config = BulkTransferConfig();
+            transfer_config.chunk_b = chunk_b;
+            transfer_config.window = window;
+            /* A new client each time, so nothing is resumed */
+            waitForNotifyRelease(client_context.getConnection(), server_name,
+                                 service.getDataPath());
+            auto client = BulkTransferClient(
+                client_context.getConnection(), service.getDataPath(),
+                service.getControlPath(), server_name, transfer_config);
+
+            auto is_intact = false;
+            try {
+                is_intact = client.download().get() == data;
+            } catch (const sdbus::Error &e) {
+                std::cerr << "Download failed: " << e.what() << endl;
+            }
+
+            auto label =
+                std::to_string(chunk_b) + "B x" + std::to_string(window);
+            auto intact = "no";
+            if (is_intact) {
+                intact = "yes";
+            }
+            std::printf("%-20s %14.0f %14.0f %8s\n", label.c_str(),
+                        client.getStats().getThroughputKBps(),
+                        service.getStats().getThroughputKBps(), intact);
+        }
+    }
+
+    bluez_connection->leaveEventLoop();
+}
@@ -0,0 +1,130 @@
+/**
+ * @file central.cpp
+ * @brief How central side lookups scale with number of devices bluez knows
+ * about, against the mock bluez on a private bus (no hardware needed). Also
+ * how long a ScanSession takes to report a newly added device
+ *
+ * Usage: ./bench_central [adapters] [iterations]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "ble/central.h"
+#include "ble/scan_session.h"
+#include "bluetooth/device.h"
+#include "bus_context.h"
+#include "mock/bluez.h"
+#include "mock/private_bus.h"
+
+#include "sdbus-c++/sdbus-c++.h"
+
+using std::cout, std::endl, std::string, std::vector;
+
+const auto DEFAULT_ITERATIONS = 100u;
+const vector<unsigned int> DEVICE_COUNTS = {10, 100, 1000, 10000};
+
+int main(int argc, char *argv[]) {
+    auto adapter_count = 1u;
+    auto iterations = DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        adapter_count = std::max(1ul, std::stoul(argv[1]));
+    }
+    if (argc > 2) {
+        iterations = std::stoul(argv[2]);
+    }
+
+    /* Everything below goes to this bus, not the real system bus */
+    auto bus = PrivateBus();
+    cout << "Private bus: " << bus.getAddress() << endl;
+
+    for (auto device_count : DEVICE_COUNTS) {
+        auto config = MockBluezConfig();
+        config.adapter_count = adapter_count;
+        config.devices_per_adapter =
+            (device_count + adapter_count - 1) / adapter_count;
+
+        auto mock_connection = sdbus::createSystemBusConnection();
+        auto bluez = MockBluez(*mock_connection, config);
+        mock_connection->enterEventLoopAsync();
+
+        /* New context for every size, so the cache is seeded again */
+        auto context = BusContext(sdbus::createSystemBusConnection());
+        auto seed = measureLatencies(1, [&context](unsigned int) {
+            (void)context.getObjectTree();
+        });
+
+        auto seed_index = measureLatencies(1, [&context](unsigned int) {
+            (void)context.getDeviceNameIndex();
+        });
+
+        auto peripherals =
+            measureLatencies(iterations, [&context](unsigned int) {
+                (void)getAvailableBLEPeripherals(context);
+            });
+
+        /* Last device's name, so every lookup scans all devices */
+        const auto names = bluez.getDeviceNames();
+        const auto &last_name = names.back();
+        auto by_name = measureLatencies(
+            iterations, [&context, &last_name](unsigned int) {
+                (void)get_device_address_by_name(last_name, context);
+            });
+
+        auto addresses = std::vector<BdAddr>();
+        for (const auto &address : bluez.getDeviceAddresses()) {
+            addresses.push_back(BdAddr::parse(address).value());
+        }
+        const auto adapter_path = bluez.getAdapterPath(0);
+        auto connect = measureLatencies(
+            iterations, [&context, &addresses, &adapter_path](unsigned int i) {
+                connect_to_device_using_address(
+                    addresses[i % addresses.size()], adapter_path, context);
+            });
+
+        /* Time from bluez adding a device, till a scan session reports it */
+        auto found_count = std::atomic<unsigned int>(0);
+        auto session = ScanSession(
+            [&found_count](ScanSession::Event event, const ScanRecord &) {
+                if (event == ScanSession::Event::FOUND) {
+                    ++found_count;
+                }
+            },
+            context, adapter_path);
+        session.start();
+        auto scan_found = measureLatencies(
+            iterations, [&bluez, &found_count](unsigned int i) {
+                char address[sizeof("XX:XX:XX:XX:XX:XX")];
+                (void)std::snprintf(address, sizeof(address),
+                                    "3A:00:00:%02X:%02X:%02X", (i >> 16) & 0xff,
+                                    (i >> 8) & 0xff, i & 0xff);
+                bluez.addDevice(0, address, "New device");
+                while (found_count <= i) {
+                    std::this_thread::yield();
+                }
+            });
+        session.stop();
+
+        cout << '\n'
+             << device_count << " devices, " << adapter_count << " adapter(s)"
+             << endl;
+        printLatencyHeader("operation");
+        printLatencyRow("seed object tree", computeLatencyStats(seed));
+        printLatencyRow("seed name index", computeLatencyStats(seed_index));
+        printLatencyRow("getAvailableBLEPeripherals",
+                        computeLatencyStats(peripherals));
+        printLatencyRow("get_device_address_by_name",
+                        computeLatencyStats(by_name));
+        printLatencyRow("connect_to_device_using_addr",
+                        computeLatencyStats(connect));
+        printLatencyRow("ScanSession FOUND", computeLatencyStats(scan_found));
+
+        mock_connection->leaveEventLoop();
+    }
+}
@@ -0,0 +1,144 @@
+/**
+ * @file connection_manager.cpp
+ * @brief Time to connect every device, with a blocking Connect one after
+ * other, vs ConnectionManager with 1 to 8 connects in flight per adapter
+ *
+ * The mock devices take `connect delay` to connect, and fail their first
+ * `failed connects` attempts, which the serial loop doesn't retry
+ *
+ * Usage: ./bench_connection_manager [devices per adapter] [connect delay ms]
+ * [failed connects per device]
+ */
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "ble/connection_manager.h"
+#include "bus_context.h"
+#include "mock/bluez.h"
+#include "mock/private_bus.h"
+
+#include "sdbus-c++/sdbus-c++.h"
+
+using std::cout, std::endl, std::string, std::vector;
+
+const auto ADAPTER_COUNT = 2u;
+const vector<unsigned int> CONNECTS_IN_FLIGHT = {1, 2, 4, 8};
+
+int main(int argc, char *argv[]) {
+    auto config = MockBluezConfig();
+    config.adapter_count = ADAPTER_COUNT;
+    config.devices_per_adapter = 250;
+    config.connect_delay_ms = std::chrono::milliseconds(20);
+    config.failed_connects_per_device = 0;
+    if (argc > 1) {
+        config.devices_per_adapter = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        config.connect_delay_ms =
+            std::chrono::milliseconds(std::stoul(argv[2]));
+    }
+    if (argc > 3) {
+        config.failed_connects_per_device = std::stoul(argv[3]);
+    }
+
+    auto bus = PrivateBus();
+    cout << "Private bus: " << bus.getAddress() << endl;
+
+    /* Short backoff, so the bench measures overlapping, not sleeping */
+    auto policy = ConnectPolicy();
+    policy.max_attempts = config.failed_connects_per_device + 1;
+    policy.initial_backoff_ms = std::chrono::milliseconds(10);
+
+    cout << ADAPTER_COUNT * config.devices_per_adapter << " devices, "
+         << config.connect_delay_ms.count() << "ms connect, "
+         << config.failed_connects_per_device << " failures per device"
+         << endl;
+    printLatencyHeader("connect all (per device)");
+
+    /* Fresh mock every round, so every device starts disconnected and
+     * failing again */
+    auto run_round = [&config](auto &&connect_all) {
+        auto mock_connection = sdbus::createSystemBusConnection();
+        auto bluez = MockBluez(*mock_connection, config);
+        mock_connection->enterEventLoopAsync();
+
+        auto context = BusContext(sdbus::createSystemBusConnection());
+        (void)context.getObjectTree();
+
+        /* Devices were added adapter by adapter, in order */
+        auto devices = vector<std::pair<BdAddr, string>>();
+        const auto addresses = bluez.getDeviceAddresses();
+        for (auto i = 0u; i < addresses.size(); ++i) {
+            devices.emplace_back(
+                BdAddr::parse(addresses[i]).value(),
+                bluez.getAdapterPath(i / config.devices_per_adapter));
+        }
+
+        connect_all(context, devices);
+        mock_connection->leaveEventLoop();
+    };
+
+    run_round([](BusContext &context,
+                 const vector<std::pair<BdAddr, string>> &devices) {
+        auto samples = vector<Clock::duration>();
+        auto failed = 0u;
+        auto start = Clock::now();
+        for (const auto &device : devices) {
+            auto proxy = context.createBluezProxy(
+                device.first.toObjectPath(device.second));
+            auto connect_start = Clock::now();
+            try {
+                proxy->callMethod("Connect").onInterface("org.bluez.Device1");
+            } catch (sdbus::Error &) {
+                ++failed;
+            }
+            samples.push_back(Clock::now() - connect_start);
+        }
+
+        printLatencyRow("serial",
+                        computeLatencyStats(samples, Clock::now() - start));
+        if (failed) {
+            cout << failed << " connects failed" << endl;
+        }
+    });
+
+    for (auto connects_in_flight : CONNECTS_IN_FLIGHT) {
+        run_round([connects_in_flight, &policy](
+                      BusContext &context,
+                      const vector<std::pair<BdAddr, string>> &devices) {
+            auto manager =
+                ConnectionManager(context, connects_in_flight, policy);
+
+            std::mutex mutex;
+            auto samples = vector<Clock::duration>();
+            auto failed = std::atomic<unsigned int>(0);
+            auto start = Clock::now();
+            for (const auto &device : devices) {
+                /* From the request, so includes waiting for a slot */
+                manager.connect(
+                    device.first,
+                    [&mutex, &samples, &failed,
+                     start](BdAddr, const sdbus::Error *error) {
+                        failed += error != nullptr;
+                        std::lock_guard<std::mutex> lock(mutex);
+                        samples.push_back(Clock::now() - start);
+                    },
+                    device.second);
+            }
+            manager.waitUntilIdle();
+            auto wall = Clock::now() - start;
+
+            auto label =
+                "ConnectionManager x" + std::to_string(connects_in_flight);
+            printLatencyRow(label, computeLatencyStats(samples, wall));
+            if (failed) {
+                cout << failed << " connects failed" << endl;
+            }
+        });
+    }
+}
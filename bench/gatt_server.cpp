@@ -0,0 +1,278 @@
+/**
+ * @file gatt_server.cpp
+ * @brief Round trip latency of ReadValue/WriteValue on a GATT application
+ * built with Application/Service/Characteristic, driven through
+ * CharacteristicProxy, for payloads of 1 to 512 bytes and 1 to 64 clients.
+ * Also time to poll 40 reads one after other, vs all in flight at once, and
+ * a long read of 512 bytes at the minimum MTU, chunk by chunk as bluez does
+ *
+ * The application is registered with the mock bluez's GattManager1 on a
+ * private bus, and clients call it directly (bluez is not in the data path
+ * of the mock), so this measures the library's own per request cost
+ *
+ * Usage: ./bench_gatt_server [operations per client]
+ */
+
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "ble/peripheral.h"
+#include "mock/bluez.h"
+#include "mock/private_bus.h"
+
+#include "sdbus-c++/sdbus-c++.h"
+
+using std::cout, std::endl, std::string, std::vector, std::map;
+
+const auto DEFAULT_OPERATIONS_PER_CLIENT = 200u;
+const vector<size_t> PAYLOAD_SIZES_B = {1, 20, 64, 128, 244, 512};
+const vector<unsigned int> CLIENT_COUNTS = {1, 4, 16, 64};
+
+/* Characteristics our central reads from each device, per poll */
+const auto READS_PER_POLL = 40u;
+
+/* What bluez itself passes to ReadValue/WriteValue, so the options map costs
+ * the same as in production */
+const auto BLUEZ_MTU_B = u16(517);
+
+/* Long read, 22 bytes per ATT Read Blob response, so 24 chunks */
+const auto LONG_VALUE_B = 512u;
+const auto MIN_MTU_B = u16(23);
+
+class BenchApplication : public Application {
+  public:
+    BenchApplication(BusContext &context,
+                     const std::string &application_object_path)
+        : Application(context, application_object_path) {}
+
+    void onInterfacesAdded(
+        const sdbus::ObjectPath &object_path,
+        const std::map<std::string, std::map<std::string, sdbus::Variant>>
+            &interfaces_and_properties) override {}
+    void
+    onInterfacesRemoved(const sdbus::ObjectPath &object_path,
+                        const std::vector<std::string> &interfaces) override {}
+};
+
+class BenchService : public Service {
+  public:
+    BenchService(sdbus::IConnection &connection, std::string application_path,
+                 unsigned int index, std::string UUID)
+        : Service(connection, application_path, index, UUID) {}
+
+    /* Reads return whatever was last written (or set) */
+    struct EchoCharacteristic : public Characteristic {
+        mutable std::mutex mutex;
+        /* Shared with the replies, not copied into them */
+        ValueBuffer value;
+        mutable std::atomic<u64> read_count{0};
+
+        EchoCharacteristic(sdbus::IConnection &connection,
+                           std::string service_path, unsigned int index,
+                           std::string UUID)
+            : Characteristic(connection, service_path, index, UUID) {}
+
+        ValueBuffer ReadValueBuffer(const GattOptions &options) const override {
+            ++read_count;
+            std::lock_guard<std::mutex> lock(mutex);
+            return value;
+        }
+
+        void WriteValue(ByteView value, const GattOptions &options) override {
+            auto buffer = ValueBufferPool::getDefault().acquire();
+            buffer->assign(value.begin(), value.end());
+            std::lock_guard<std::mutex> lock(mutex);
+            this->value = ValueBuffer(std::move(buffer));
+        }
+
+        /* Not called, the base calls the overloads above */
+        std::vector<u8> ReadValue(
+            std::map<std::string, sdbus::Variant> options) const override {
+            std::lock_guard<std::mutex> lock(mutex);
+            return value.get();
+        }
+
+        void
+        WriteValue(std::vector<u8> value,
+                   std::map<std::string, sdbus::Variant> options) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->value = ValueBuffer(std::move(value));
+        }
+    };
+};
+
+/**
+ * @brief Run `operation` from `client_count` threads at once, each with its
+ * own connection, and collect every operation's latency
+ */
+template <typename Operation>
+LatencyStats runClients(unsigned int client_count,
+                        unsigned int operations_per_client,
+                        const std::string &server_name,
+                        const std::string &characteristic_path,
+                        Operation &&operation) {
+    /* Connecting is not what is measured, so done before starting */
+    auto connections = vector<std::unique_ptr<sdbus::IConnection>>();
+    auto proxies = vector<std::unique_ptr<CharacteristicProxy>>();
+    for (auto i = 0u; i < client_count; ++i) {
+        connections.push_back(sdbus::createSystemBusConnection());
+        proxies.push_back(std::make_unique<CharacteristicProxy>(
+            *connections.back(), characteristic_path, server_name));
+    }
+
+    auto samples = vector<vector<Clock::duration>>(client_count);
+    auto is_started = std::atomic<bool>(false);
+    auto clients = vector<std::thread>();
+    for (auto i = 0u; i < client_count; ++i) {
+        clients.emplace_back([&, i]() {
+            while (!is_started) {
+                std::this_thread::yield();
+            }
+            samples[i] = measureLatencies(
+                operations_per_client,
+                [&proxy = *proxies[i], &operation](unsigned int) {
+                    operation(proxy);
+                });
+        });
+    }
+
+    auto start = Clock::now();
+    is_started = true;
+    for (auto &client : clients) {
+        client.join();
+    }
+    auto wall_time = Clock::now() - start;
+
+    auto all_samples = vector<Clock::duration>();
+    for (auto &client_samples : samples) {
+        all_samples.insert(all_samples.end(), client_samples.begin(),
+                           client_samples.end());
+    }
+
+    return computeLatencyStats(std::move(all_samples), wall_time);
+}
+
+int main(int argc, char *argv[]) {
+    auto operations_per_client = DEFAULT_OPERATIONS_PER_CLIENT;
+    if (argc > 1) {
+        operations_per_client = std::stoul(argv[1]);
+    }
+
+    auto bus = PrivateBus();
+    cout << "Private bus: " << bus.getAddress() << endl;
+
+    auto config = MockBluezConfig();
+    config.devices_per_adapter = 0;
+    auto bluez_connection = sdbus::createSystemBusConnection();
+    auto bluez = MockBluez(*bluez_connection, config);
+    bluez_connection->enterEventLoopAsync();
+
+    auto server_context = BusContext(sdbus::createSystemBusConnection());
+    auto application = BenchApplication(server_context, "/bench");
+    auto &service = application.addService<BenchService>(
+        0, "0000180d-0000-1000-8000-00805f9b34fb");
+    auto &characteristic =
+        service.addCharacteristic<BenchService::EchoCharacteristic>(
+            0, "00002a37-0000-1000-8000-00805f9b34fb");
+
+    application.registerWithGattManager(bluez.getAdapterPath(0)).get();
+
+    const auto server_name = server_context.getConnection().getUniqueName();
+    const auto characteristic_path = characteristic.getObjectPath();
+    const auto options = map<string, sdbus::Variant>(
+        {{"device", sdbus::ObjectPath("/org/bluez/hci0/dev_30_4B_00_00_00_00")},
+         {"mtu", BLUEZ_MTU_B},
+         {"link", string("LE")}});
+
+    printLatencyHeader("operation/payload/clients");
+    for (auto payload_size_b : PAYLOAD_SIZES_B) {
+        const auto payload = vector<u8>(payload_size_b, 0xa5);
+        {
+            std::lock_guard<std::mutex> lock(characteristic.mutex);
+            characteristic.value = ValueBuffer(payload);
+        }
+
+        for (auto client_count : CLIENT_COUNTS) {
+            auto read_stats = runClients(
+                client_count, operations_per_client, server_name,
+                characteristic_path,
+                [&options](CharacteristicProxy &proxy) {
+                    (void)proxy.ReadValue(options);
+                });
+            auto write_stats = runClients(
+                client_count, operations_per_client, server_name,
+                characteristic_path,
+                [&options, &payload](CharacteristicProxy &proxy) {
+                    proxy.WriteValue(payload, options);
+                });
+
+            auto suffix = " " + std::to_string(payload_size_b) + "B x" +
+                          std::to_string(client_count);
+            printLatencyRow("ReadValue" + suffix, read_stats);
+            printLatencyRow("WriteValue" + suffix, write_stats);
+        }
+    }
+
+    /* Async replies are dispatched by the client's event loop */
+    auto client_connection = sdbus::createSystemBusConnection();
+    client_connection->enterEventLoopAsync();
+    auto proxy = CharacteristicProxy(*client_connection, characteristic_path,
+                                     server_name);
+
+    auto sync_poll = computeLatencyStats(
+        measureLatencies(operations_per_client, [&](unsigned int) {
+            for (auto i = 0u; i < READS_PER_POLL; ++i) {
+                (void)proxy.ReadValue(options);
+            }
+        }));
+    auto pipelined_poll = computeLatencyStats(
+        measureLatencies(operations_per_client, [&](unsigned int) {
+            auto reads = vector<std::future<vector<u8>>>();
+            for (auto i = 0u; i < READS_PER_POLL; ++i) {
+                reads.push_back(proxy.ReadValueAsync(options));
+            }
+            for (auto &read : reads) {
+                (void)read.get();
+            }
+        }));
+
+    auto suffix = " x" + std::to_string(READS_PER_POLL);
+    printLatencyRow("Poll ReadValue" + suffix, sync_poll);
+    printLatencyRow("Poll ReadValueAsync" + suffix, pipelined_poll);
+
+    {
+        std::lock_guard<std::mutex> lock(characteristic.mutex);
+        characteristic.value = ValueBuffer(vector<u8>(LONG_VALUE_B, 0x5a));
+    }
+    characteristic.read_count = 0;
+    auto long_read_options = options;
+    long_read_options["mtu"] = sdbus::Variant(MIN_MTU_B);
+    auto long_read = computeLatencyStats(
+        measureLatencies(operations_per_client, [&](unsigned int) {
+            /* Till a short chunk, same as an ATT client */
+            auto offset_b = u16(0);
+            while (true) {
+                long_read_options["offset"] = sdbus::Variant(offset_b);
+                auto chunk = proxy.ReadValue(long_read_options);
+                offset_b += chunk.size();
+                if (chunk.size() < MIN_MTU_B - 1u) {
+                    break;
+                }
+            }
+        }));
+    printLatencyRow("Long read " + std::to_string(LONG_VALUE_B) + "B",
+                    long_read);
+    cout << "ReadValue called " << characteristic.read_count << " times for "
+         << operations_per_client << " long reads" << endl;
+
+    client_connection->leaveEventLoop();
+    bluez_connection->leaveEventLoop();
+}
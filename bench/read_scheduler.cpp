@@ -0,0 +1,153 @@
+/**
+ * @file read_scheduler.cpp
+ * @brief Time to read the same characteristics from every device, one device
+ * and one read after other, vs ReadScheduler with 1 to 8 devices in progress
+ * per adapter
+ *
+ * The mock devices take `connect delay` to connect and `read delay` per read
+ * (reads of a device are served one after other), so this measures how much
+ * of that waiting the scheduler overlaps
+ *
+ * Usage: ./bench_read_scheduler [devices per adapter] [characteristics per
+ * device] [connect delay ms] [read delay ms]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "ble/characteristic.h"
+#include "ble/read_scheduler.h"
+#include "bus_context.h"
+#include "mock/bluez.h"
+#include "mock/private_bus.h"
+
+#include "sdbus-c++/sdbus-c++.h"
+
+using std::cout, std::endl, std::string, std::vector;
+
+const auto ADAPTER_COUNT = 2u;
+const vector<unsigned int> DEVICES_IN_PROGRESS = {1, 2, 4, 8};
+
+/* Device object path for an address, the way bluez makes it */
+string get_device_path(const string &adapter_path, string address) {
+    for (auto &c : address) {
+        if (c == ':') {
+            c = '_';
+        }
+    }
+    return adapter_path + "/dev_" + address;
+}
+
+int main(int argc, char *argv[]) {
+    auto config = MockBluezConfig();
+    config.adapter_count = ADAPTER_COUNT;
+    config.devices_per_adapter = 50;
+    config.characteristics_per_device = 40;
+    config.connect_delay_ms = std::chrono::milliseconds(20);
+    config.read_delay_ms = std::chrono::milliseconds(1);
+    if (argc > 1) {
+        config.devices_per_adapter = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        config.characteristics_per_device = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        config.connect_delay_ms =
+            std::chrono::milliseconds(std::stoul(argv[3]));
+    }
+    if (argc > 4) {
+        config.read_delay_ms = std::chrono::milliseconds(std::stoul(argv[4]));
+    }
+
+    auto bus = PrivateBus();
+    cout << "Private bus: " << bus.getAddress() << endl;
+
+    auto mock_connection = sdbus::createSystemBusConnection();
+    auto bluez = MockBluez(*mock_connection, config);
+    mock_connection->enterEventLoopAsync();
+
+    auto context = BusContext(sdbus::createSystemBusConnection());
+
+    /* Devices were added adapter by adapter, in order */
+    auto items = vector<ReadItem>();
+    const auto addresses = bluez.getDeviceAddresses();
+    for (auto i = 0u; i < addresses.size(); ++i) {
+        auto adapter_path =
+            bluez.getAdapterPath(i / config.devices_per_adapter);
+        for (auto j = 0u; j < config.characteristics_per_device; ++j) {
+            items.push_back({get_device_path(adapter_path, addresses[i]),
+                             MockBluez::getCharacteristicUuid(j)});
+        }
+    }
+
+    cout << addresses.size() << " devices, " << items.size() << " reads, "
+         << config.connect_delay_ms.count() << "ms connect, "
+         << config.read_delay_ms.count() << "ms per read" << endl;
+
+    /* What we did before: connect, read everything, disconnect, repeat */
+    auto serial_start = Clock::now();
+    auto serial_samples = vector<Clock::duration>();
+    for (auto i = size_t(0); i < items.size();) {
+        auto device = context.createBluezProxy(items[i].device_path);
+        device->callMethod("Connect").onInterface("org.bluez.Device1");
+
+        auto device_items = vector<ReadItem>();
+        for (; i < items.size() &&
+               items[i].device_path == device->getObjectPath();
+             ++i) {
+            device_items.push_back(items[i]);
+        }
+
+        for (const auto &item : device_items) {
+            auto path = string();
+            context.getObjectTree().forEachObjectWithInterface(
+                "org.bluez.GattCharacteristic1",
+                [&path, &item](const sdbus::ObjectPath &object_path,
+                               const BluezObjectTree::Properties &properties) {
+                    auto uuid = properties.find("UUID");
+                    if (object_path.find(item.device_path + "/") == 0 &&
+                        uuid != properties.end() &&
+                        uuid->second.get<string>() ==
+                            item.characteristic_uuid) {
+                        path = object_path;
+                    }
+                });
+
+            auto proxy = CharacteristicProxy(context.getConnection(), path);
+            auto start = Clock::now();
+            (void)proxy.ReadValue();
+            serial_samples.push_back(Clock::now() - start);
+        }
+
+        device->callMethod("Disconnect").onInterface("org.bluez.Device1");
+    }
+    auto serial_wall = Clock::now() - serial_start;
+
+    printLatencyHeader("sweep (per read latency)");
+    printLatencyRow("serial",
+                    computeLatencyStats(serial_samples, serial_wall));
+
+    for (auto devices_in_progress : DEVICES_IN_PROGRESS) {
+        auto scheduler = ReadScheduler(context, devices_in_progress);
+        auto start = Clock::now();
+        auto results = scheduler.run(items);
+        auto wall = Clock::now() - start;
+
+        auto samples = vector<Clock::duration>();
+        auto failed = 0u;
+        for (const auto &result : results) {
+            samples.push_back(result.latency);
+            failed += result.error.has_value();
+        }
+
+        auto label = "scheduler x" + std::to_string(devices_in_progress);
+        printLatencyRow(label, computeLatencyStats(samples, wall));
+        if (failed) {
+            cout << failed << " reads failed" << endl;
+        }
+    }
+
+    mock_connection->leaveEventLoop();
+}
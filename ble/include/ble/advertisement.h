@@ -1,28 +1,182 @@
 #pragma once
 
+#include <cstddef>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <vector>
 
+#include "bus_context.h"
+#include "declarations.h"
 #include "sdbus-c++/sdbus-c++.h"
 
+/* Advertising data bytes in a legacy advertising PDU, and in an extended one
+ * (one HCI LE Set Extended Advertising Data command) */
+const size_t LEGACY_ADVERTISING_DATA_MAX_B = 31;
+const size_t EXTENDED_ADVERTISING_DATA_MAX_B = 251;
+
+enum class AdvertisingPdu { LEGACY, EXTENDED };
+
+inline size_t getAdvertisingDataMaxSize(AdvertisingPdu pdu) {
+    if (pdu == AdvertisingPdu::EXTENDED) {
+        return EXTENDED_ADVERTISING_DATA_MAX_B;
+    }
+    return LEGACY_ADVERTISING_DATA_MAX_B;
+}
+
+/**
+ * @brief Fields of an advertisement that end up in the advertising data
+ */
+struct AdvertisingData {
+    std::vector<std::string> service_uuids;
+    std::vector<std::string> solicit_uuids;
+    /* Company ID -> data */
+    std::map<u16, std::vector<u8>> manufacturer_data;
+    /* Service UUID -> data */
+    std::map<std::string, std::vector<u8>> service_data;
+    std::string local_name;
+    std::optional<u16> appearance;
+    /* "tx-power", "appearance" or "local-name", added by bluez */
+    std::vector<std::string> includes;
+
+    /**
+     * @brief Bytes these take as AD structures (length, type, data), along
+     * with the flags bluez adds
+     *
+     * @note For "local-name" in includes, only the AD header is counted, the
+     * adapter's name isn't known here
+     */
+    size_t getPayloadSize() const;
+};
+
 /**
  * @brief Advertisement class, this class can be used to easily create
  * advertisements with custom arguments and advertise
+ *
+ * The object is exported on the context's connection, whose event loop the
+ * context runs, so bluez's calls on it (GetAll, Release) are answered while
+ * registration is in flight, without the caller running an event loop
+ *
+ * Setters validate the advertising data against the PDU's size when called,
+ * and throw std::length_error if it won't fit. Data can be changed while
+ * advertising, bluez picks it up from PropertiesChanged, without
+ * re-registering. Optional parameters (appearance, TX power, timeouts,
+ * intervals) can only be set or cleared while not advertising, since bluez
+ * reads which are present only when registering
+ *
+ * Setters and turnOn/turnOffAdvertising are meant to be called from one
+ * thread, the event loop thread only reads the values
+ *
+ * @references:
+ * 1. advertising-api.txt -> LEAdvertisement1
  */
 class Advertisement {
+    BusContext &context;
     std::string adapter_object_path;
-    std::string advertised_name = "A BLE G";
-    sdbus::IConnection &connection;
+    std::string object_path;
+    AdvertisingPdu pdu;
     std::unique_ptr<sdbus::IObject> ad;
+    /* Kept, as destroying a proxy drops replies to its pending calls */
+    std::unique_ptr<sdbus::IProxy> advertising_manager;
+    /* Properties `ad` was exported with, only these can be signalled */
+    std::set<std::string> exported_properties;
+
+    /* Guards everything below, read by the getters on the event loop
+     * thread */
+    mutable std::mutex mutex;
+    bool is_registered = false;
+    /* Optional properties were set or cleared since exporting `ad` */
+    bool is_export_stale = false;
+
+    AdvertisingData data;
+    /* Variants of `data`, built when it is set, not on every GetAll */
+    std::map<u16, sdbus::Variant> manufacturer_data_value;
+    std::map<std::string, sdbus::Variant> service_data_value;
+
+    std::string type = "peripheral";
+    std::optional<bool> is_discoverable;
+    std::optional<i16> tx_power_dbm;
+    std::optional<u16> duration_s;
+    std::optional<u16> timeout_s;
+    std::optional<u32> min_interval_ms;
+    std::optional<u32> max_interval_ms;
+
+    void export_object();
+    void set_data(const AdvertisingData &new_data,
+                  const std::vector<std::string> &changed_properties);
+    template <typename T>
+    void set_optional(std::optional<T> &field, std::optional<T> value,
+                      const std::string &property_name);
 
   public:
-    Advertisement(sdbus::IConnection &connection,
-                  const std::string &object_path = "/ble/ad0");
+    /**
+     * @param pdu EXTENDED allows upto 251 bytes of data, but needs a
+     * controller (and bluez) supporting extended advertising
+     */
+    Advertisement(BusContext &context = getDefaultBusContext(),
+                  const std::string &object_path = "/ble/ad0",
+                  AdvertisingPdu pdu = AdvertisingPdu::LEGACY);
+
+    Advertisement(const Advertisement &) = delete;
+    Advertisement &operator=(const Advertisement &) = delete;
+
+    /**
+     * @brief Register the advertisement with bluez, returns immediately
+     *
+     * @return Future that is ready once bluez replies, `get()` throws
+     * sdbus::Error if bluez refused (eg. too many advertisements)
+     */
+    std::future<void> turnOnAdvertising();
+
+    /**
+     * @brief Unregister the advertisement, the object stays exported, so it
+     * can be turned on again
+     */
+    std::future<void> turnOffAdvertising();
+
+    /**
+     * @brief Replace all of the advertising data at once
+     */
+    Advertisement &setData(const AdvertisingData &new_data);
+    Advertisement &setAdvertisedName(const std::string &new_name);
+    Advertisement &setServiceUuids(std::vector<std::string> uuids);
+    Advertisement &setSolicitUuids(std::vector<std::string> uuids);
+    Advertisement &
+    setManufacturerData(std::map<u16, std::vector<u8>> manufacturer_data);
+    /**
+     * @brief Set data of one company, keeping other companies' data
+     */
+    Advertisement &setManufacturerData(u16 company_id, std::vector<u8> value);
+    Advertisement &
+    setServiceData(std::map<std::string, std::vector<u8>> service_data);
+    Advertisement &setIncludes(std::vector<std::string> includes);
+    Advertisement &setAppearance(std::optional<u16> appearance);
+
+    /**
+     * @brief "peripheral" or "broadcast", only while not advertising
+     */
+    Advertisement &setType(const std::string &new_type);
+    Advertisement &setDiscoverable(std::optional<bool> discoverable);
+    Advertisement &setTxPower(std::optional<i16> tx_power_dbm);
+    Advertisement &setDuration(std::optional<u16> duration_s);
+    Advertisement &setTimeout(std::optional<u16> timeout_s);
+    Advertisement &setInterval(std::optional<u32> min_interval_ms,
+                               std::optional<u32> max_interval_ms);
 
-    void turnOnAdvertising();
-    void turnOffAdvertising();
+    AdvertisingData getData() const;
+    size_t getPayloadBudget() const;
 
-    void setAdvertisedName(const std::string& new_name);
+    bool isAdvertising() const;
 
+    /**
+     * @brief Unregisters advertisement, if registered, and blocks for it
+     *
+     * @note Don't destroy from the context's event loop thread (eg. a reply
+     * callback), the blocking unregister call would wait for that thread
+     */
     ~Advertisement();
 };
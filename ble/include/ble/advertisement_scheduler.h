@@ -0,0 +1,166 @@
+/**
+ * @file advertisement_scheduler.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Advertising more sets than the controller has advertising
+ * instances, by rotating them through the instances
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "advertisement.h"
+#include "bus_context.h"
+#include "timer_queue.h"
+
+/**
+ * @brief Rotates advertising sets through the advertising instances bluez
+ * has left (LEAdvertisingManager1.SupportedInstances), a time slice at a time
+ *
+ * Every instance is one Advertisement, registered once, rotating only
+ * changes its data, which bluez picks up from PropertiesChanged. So an
+ * instance is never given back in between, for someone else to take. Only a
+ * set with appearance following one without (or the other way) needs the
+ * instance re-registered, as bluez reads which properties are present only
+ * when registering
+ *
+ * With no more sets than instances, every set stays on its instance
+ *
+ * bluez is talked to only on the scheduler's own thread, never holding its
+ * lock, so addSet(), updateSet() and removeSet() don't block, and can be
+ * called from the event loop thread
+ */
+class AdvertisementScheduler {
+  public:
+    using SetId = u64;
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    struct AdvertisingSet {
+        AdvertisingData data;
+        /* Of `data`, so an instance showing an older one is updated */
+        u64 version = 0;
+        /* Till it last went off air */
+        Clock::duration air_time{};
+        bool is_on_air = false;
+        Clock::time_point on_air_since;
+    };
+
+    /* An advertising instance */
+    struct Slot {
+        std::unique_ptr<Advertisement> advertisement;
+        /* Set it should show */
+        std::optional<SetId> set_id;
+        /* Set (and its version) bluez last accepted from it */
+        std::optional<SetId> shown_set_id;
+        u64 shown_version = 0;
+    };
+
+    /* What apply() does to an instance, outside the lock, turn it off if
+     * no set */
+    struct Change {
+        Slot *slot;
+        std::optional<SetId> set_id;
+        u64 version = 0;
+        AdvertisingData data;
+        bool is_shown = false;
+    };
+
+    BusContext &context;
+    std::chrono::milliseconds time_slice_ms;
+    unsigned int max_instances;
+    AdvertisingPdu pdu;
+    std::string object_path_prefix;
+
+    std::mutex mutex;
+    std::map<SetId, AdvertisingSet> sets;
+    SetId next_set_id = 1;
+    std::vector<Slot> slots;
+    /* Rotation continues from the first set with id >= this */
+    SetId next_rotation_id = 0;
+    bool is_running = false;
+    TimerQueue::TimerId tick_id = 0;
+
+    /* Last member, so the rotation stops before the rest is destroyed */
+    TimerQueue timer;
+
+    void rotate();
+    void apply();
+    void schedule_apply();
+    bool show(Advertisement &advertisement, const AdvertisingData &data);
+    void take_off_air(Slot &slot, Clock::time_point now);
+    void turn_off(Advertisement &advertisement);
+
+  public:
+    /**
+     * @param time_slice_ms How long a set stays on an instance, when there
+     * are more sets than instances
+     * @param max_instances Instances to use at most, 0 for all available
+     * @param object_path_prefix Instance N is exported at prefix + N
+     */
+    explicit AdvertisementScheduler(
+        BusContext &context = getDefaultBusContext(),
+        std::chrono::milliseconds time_slice_ms = std::chrono::seconds(1),
+        unsigned int max_instances = 0,
+        AdvertisingPdu pdu = AdvertisingPdu::LEGACY,
+        const std::string &object_path_prefix = "/ble/rotation/ad");
+
+    AdvertisementScheduler(const AdvertisementScheduler &) = delete;
+    AdvertisementScheduler &operator=(const AdvertisementScheduler &) = delete;
+
+    /**
+     * @brief Stops, unregistering every instance
+     */
+    ~AdvertisementScheduler();
+
+    /**
+     * @brief Add a set, it gets on air from the next time slice
+     *
+     * @throw std::length_error if it won't fit in the advertising PDU
+     */
+    SetId addSet(AdvertisingData data);
+
+    /**
+     * @brief Change a set's data, right away if it is on air
+     */
+    void updateSet(SetId set_id, AdvertisingData data);
+
+    void removeSet(SetId set_id);
+
+    /**
+     * @brief Register advertisements for the instances bluez has available,
+     * and start rotating, the first sets go on air shortly after
+     *
+     * @return Instances used, 0 if none was available, and so not started
+     *
+     * @note Blocks for bluez, so don't call from the event loop thread
+     */
+    size_t start();
+
+    /**
+     * @brief Stop rotating, and unregister every instance, sets are kept
+     *
+     * @note Waits for the instances to be off, so don't call from the event
+     * loop thread
+     */
+    void stop();
+
+    /**
+     * @brief Time a set has been on air, counted from bluez accepting its
+     * data till it was replaced
+     */
+    Clock::duration getAirTime(SetId set_id);
+    std::map<SetId, Clock::duration> getAirTimes();
+
+    size_t getInstanceCount();
+};
@@ -1,19 +1,30 @@
 #pragma once
 
+#include <future>
 #include <memory>
 #include <vector>
 
+#include "bus_context.h"
 #include "sdbus-c++/Types.h"
 #include "sdbus-c++/sdbus-c++.h"
 #include "service.h"
 
+/**
+ * @brief Root of a GATT server, its services are exported on the context's
+ * connection, whose event loop the context runs
+ */
 class Application {
     std::unique_ptr<sdbus::IObject> application;
     std::vector<Service *> services;
+    BusContext &context;
     sdbus::IConnection &connection;
 
+    /* GattManager1 of the adapter registered with, kept, as destroying a
+     * proxy drops replies to its pending calls */
+    std::unique_ptr<sdbus::IProxy> gatt_manager;
+
   public:
-    Application(sdbus::IConnection &connection,
+    Application(BusContext &context,
                 const std::string &application_object_path);
 
     template <typename ServiceType, class... Args>
@@ -48,7 +59,22 @@ class Application {
     }
 
     sdbus::ObjectPath getObjectPath() const;
-    void registerWithGattManager(std::string adapter_path = "") const;
+
+    /**
+     * @brief Register with bluez, returns immediately, add all services
+     * before calling it, bluez reads them once, while registering
+     *
+     * @param adapter_path Empty for the first adapter capable of LE
+     *
+     * @return Future that is ready once bluez replies, `get()` throws
+     * sdbus::Error if bluez refused
+     *
+     * @note Call once, or again only after unregisterFromGattManager()
+     * completed
+     */
+    std::future<void> registerWithGattManager(std::string adapter_path = "");
+
+    std::future<void> unregisterFromGattManager();
 
     virtual void onInterfacesAdded(
         const sdbus::ObjectPath &object_path,
@@ -0,0 +1,149 @@
+/**
+ * @file bulk_transfer_client.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Central side of the bulk transfer service, pulls its data
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bulk_transfer_protocol.h"
+#include "bus_context.h"
+#include "characteristic.h"
+#include "crc32.h"
+#include "timer_queue.h"
+
+/**
+ * @brief Knobs to tune throughput with
+ */
+struct BulkTransferConfig {
+    /* Data bytes per notification, lowered to fit the acquired socket's MTU
+     * (MTU - 3 - 4 byte chunk header) */
+    u16 chunk_b = 244;
+    /* Chunks sent before waiting for an acknowledgement, acknowledged every
+     * half window */
+    u16 window = 16;
+    /* Asked for in AcquireNotify, bluez uses the link's MTU instead, only a
+     * local GATT application (eg. in the benchmark) takes it */
+    u16 mtu_b = 517;
+    /* No new chunk for this long, the rest (or the last of them) was lost,
+     * a START asks to resend it */
+    std::chrono::milliseconds stall_timeout_ms{1000};
+    /* STARTs sent for one stall, without a chunk arriving, before the
+     * download fails */
+    unsigned int max_resends = 3;
+};
+
+/**
+ * @brief Downloads the data of a BulkTransferService, see
+ * bulk_transfer_protocol.h for the protocol
+ *
+ * What was received survives a failed download, so calling download() again
+ * (eg. after reconnecting) resumes from there, if the data didn't change
+ *
+ * @note Needs the connection's event loop running (eg. a BusContext), for
+ * notifications and acknowledgement replies
+ */
+class BulkTransferClient {
+    BulkTransferConfig config;
+
+    mutable std::mutex mutex;
+    std::vector<u8> received;
+    /* Of `received`, updated as chunks arrive */
+    Crc32 received_crc;
+    bool has_info = false;
+    u32 expected_size_b = 0;
+    u32 expected_crc = 0;
+
+    /* Download in progress, null if none */
+    std::shared_ptr<std::promise<std::vector<u8>>> promise;
+    u16 chunk_b = 0;
+    size_t acked_offset_b = 0;
+    /* By this download, not counting what it resumed from */
+    size_t transferred_b = 0;
+    /* A START was sent to resend from here, so it isn't sent for every
+     * chunk after a gap */
+    size_t resend_offset_b = 0;
+    std::chrono::steady_clock::time_point started_at;
+    std::chrono::steady_clock::time_point finished_at;
+    bool is_subscribed = false;
+
+    /* Of the download in progress, for the stall check, which is of one
+     * download only */
+    unsigned int download_id = 0;
+    std::chrono::steady_clock::time_point last_chunk_at;
+    unsigned int resend_count = 0;
+
+    /* Last members, so notifications and replies stop before the rest is
+     * destroyed */
+    std::unique_ptr<CharacteristicProxy> control;
+    std::unique_ptr<CharacteristicProxy> data;
+    /* After the proxies, so it is stopped first, its task uses them */
+    std::unique_ptr<TimerQueue> timers;
+
+    void on_chunk(ByteView chunk);
+    void check_stall(unsigned int id);
+    void on_write_reply(const sdbus::Error *error);
+    void complete();
+    void fail(const sdbus::Error &error);
+
+  public:
+    /**
+     * @param data_path, control_path Object paths of the data and control
+     * characteristics
+     * @param destination bluez for a remote device, or the unique name of a
+     * local GATT application
+     */
+    BulkTransferClient(sdbus::IConnection &connection, std::string data_path,
+                       std::string control_path,
+                       std::string destination = "org.bluez",
+                       BulkTransferConfig config = BulkTransferConfig());
+
+    /**
+     * @brief Find the characteristics under `service_path` (eg.
+     * /org/bluez/hci0/dev_XX/service000c) by UUID, in the context's object
+     * tree
+     *
+     * @throw sdbus::Error org.bluez.Error.DoesNotExist if not found
+     */
+    BulkTransferClient(BusContext &context, const std::string &service_path,
+                       BulkTransferConfig config = BulkTransferConfig());
+
+    BulkTransferClient(const BulkTransferClient &) = delete;
+    BulkTransferClient &operator=(const BulkTransferClient &) = delete;
+
+    /**
+     * @brief Start (or resume) downloading, returns once the service is
+     * told to start sending
+     *
+     * @return The data, once all received and its CRC checked, `get()`
+     * throws sdbus::Error if it fails, stalls (see BulkTransferConfig), or
+     * is cancelled
+     *
+     * @note Blocks for the info read and START write, so don't call from the
+     * event loop thread
+     */
+    std::future<std::vector<u8>> download();
+
+    /**
+     * @brief Fail the download in progress, eg. when the device
+     * disconnected, what was received is kept to resume from
+     */
+    void cancel();
+
+    /**
+     * @brief Bytes received by the current (or last) download, since it
+     * started
+     */
+    BulkTransferStats getStats() const;
+};
@@ -0,0 +1,105 @@
+/**
+ * @file bulk_transfer_protocol.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief What BulkTransferService and BulkTransferClient say to each other
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "byte_view.h"
+#include "declarations.h"
+
+/**
+ * @brief Bytes moved by one transfer so far, and the time it took
+ */
+struct BulkTransferStats {
+    u64 transferred_b = 0;
+    std::chrono::steady_clock::duration elapsed{};
+
+    double getThroughputKBps() const {
+        auto elapsed_s = std::chrono::duration<double>(elapsed).count();
+        if (elapsed_s <= 0) {
+            return 0;
+        }
+        return transferred_b / 1024.0 / elapsed_s;
+    }
+};
+
+/**
+ * The client pulls the service's data:
+ *
+ * 1. Reads the control characteristic: size (u32) and CRC-32 (u32) of the
+ *    data
+ * 2. Subscribes to the data characteristic, and writes START (offset u32,
+ *    window u16, chunk size u16) to control
+ * 3. The service notifies chunks on data, offset (u32) followed by upto chunk
+ *    size bytes, keeping at most `window` chunks not yet acknowledged
+ * 4. The client writes ACK (offset u32), everything before offset received,
+ *    every half window, and at the end, then checks the CRC
+ *
+ * A lost chunk, or a transfer resumed after reconnecting, is a START from the
+ * first missing offset. All integers are little endian
+ */
+namespace bulk_transfer {
+const auto SERVICE_UUID = "5c3a0001-7e1b-4d3c-9a5f-1b2d3e4f5a6b";
+const auto DATA_UUID = "5c3a0002-7e1b-4d3c-9a5f-1b2d3e4f5a6b";
+const auto CONTROL_UUID = "5c3a0003-7e1b-4d3c-9a5f-1b2d3e4f5a6b";
+
+enum Opcode : u8 { START = 0x01, ACK = 0x02, STOP = 0x03 };
+
+const size_t INFO_B = 8;
+const size_t START_B = 9;
+const size_t ACK_B = 5;
+const size_t CHUNK_HEADER_B = 4;
+
+/* Opcode and handle of ATT Handle Value Notification, rest of the MTU is the
+ * chunk */
+const size_t ATT_NOTIFICATION_HEADER_B = 3;
+/* Longest attribute value ATT allows, so the longest notification */
+const size_t MAX_ATTRIBUTE_VALUE_B = 512;
+
+inline void putU16(u8 *bytes, u16 value) {
+    bytes[0] = u8(value);
+    bytes[1] = u8(value >> 8);
+}
+
+inline void putU32(u8 *bytes, u32 value) {
+    for (auto i = 0; i < 4; ++i) {
+        bytes[i] = u8(value >> (8 * i));
+    }
+}
+
+inline u16 getU16(const u8 *bytes) { return u16(bytes[0] | bytes[1] << 8); }
+
+inline u32 getU32(const u8 *bytes) {
+    auto value = u32(0);
+    for (auto i = 0; i < 4; ++i) {
+        value |= u32(bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline std::vector<u8> makeStart(u32 offset_b, u16 window, u16 chunk_b) {
+    auto message = std::vector<u8>(START_B);
+    message[0] = START;
+    putU32(&message[1], offset_b);
+    putU16(&message[5], window);
+    putU16(&message[7], chunk_b);
+    return message;
+}
+
+inline std::vector<u8> makeAck(u32 offset_b) {
+    auto message = std::vector<u8>(ACK_B);
+    message[0] = ACK;
+    putU32(&message[1], offset_b);
+    return message;
+}
+} // namespace bulk_transfer
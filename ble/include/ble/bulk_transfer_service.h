@@ -0,0 +1,109 @@
+/**
+ * @file bulk_transfer_service.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief GATT service a central pulls large data (eg. logs) from, in chunked
+ * notifications with windowed acknowledgements
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bulk_transfer_protocol.h"
+#include "characteristic.h"
+#include "service.h"
+
+/**
+ * @brief Serves the data set with setData() to a BulkTransferClient, see
+ * bulk_transfer_protocol.h for the protocol
+ *
+ * Add it to an application like any service:
+ *
+ *     app.addService<BulkTransferService>(0, bulk_transfer::SERVICE_UUID);
+ *
+ * One transfer at a time, a START restarts it from its offset
+ */
+class BulkTransferService : public Service {
+    /* Chunks are notified here */
+    struct DataCharacteristic : public Characteristic {
+        DataCharacteristic(sdbus::IConnection &connection,
+                           std::string service_path, unsigned int index,
+                           std::string UUID);
+
+        std::vector<u8> ReadValue(
+            std::map<std::string, sdbus::Variant> options) const override;
+        void
+        WriteValue(std::vector<u8> value,
+                   std::map<std::string, sdbus::Variant> options) override;
+    };
+
+    /* Read for the size and CRC, written for START/ACK/STOP */
+    struct ControlCharacteristic : public Characteristic {
+        BulkTransferService &service;
+
+        ControlCharacteristic(sdbus::IConnection &connection,
+                              std::string service_path, unsigned int index,
+                              std::string UUID, BulkTransferService *service);
+
+        std::vector<u8> ReadValue(
+            std::map<std::string, sdbus::Variant> options) const override;
+        void WriteValue(ByteView value, const GattOptions &options) override;
+        void
+        WriteValue(std::vector<u8> value,
+                   std::map<std::string, sdbus::Variant> options) override;
+    };
+
+    DataCharacteristic *data_characteristic;
+    ControlCharacteristic *control_characteristic;
+
+    mutable std::mutex mutex;
+    std::shared_ptr<const std::vector<u8>> data;
+    u32 data_crc;
+
+    /* Transfer in progress, `sending` is the data it started with, so
+     * setData() doesn't change it midway */
+    std::shared_ptr<const std::vector<u8>> sending;
+    size_t next_offset_b = 0;
+    size_t acked_offset_b = 0;
+    size_t start_offset_b = 0;
+    u16 window = 1;
+    u16 chunk_b = 20;
+    std::chrono::steady_clock::time_point started_at;
+    std::chrono::steady_clock::time_point finished_at;
+    bool is_finished = false;
+
+    std::vector<u8> get_info() const;
+    void on_control(ByteView message);
+    void pump();
+
+  public:
+    BulkTransferService(sdbus::IConnection &connection,
+                        std::string application_path, unsigned int index,
+                        std::string UUID);
+
+    /**
+     * @brief Data to serve, a transfer in progress keeps sending what it
+     * started with
+     */
+    void setData(std::vector<u8> new_data);
+
+    /**
+     * @brief Of the current (or last) transfer, bytes acknowledged since its
+     * START
+     */
+    BulkTransferStats getStats() const;
+
+    /* Object paths of the characteristics, for a client of this same
+     * application, bluez has its own paths for remote ones */
+    std::string getDataPath() const;
+    std::string getControlPath() const;
+};
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "adapter.h"
+#include "bdaddr.h"
 #include "sdbus-c++/Error.h"
 #include "sdbus-c++/IProxy.h"
 #include "sdbus-c++/Types.h"
@@ -24,9 +25,12 @@ using std::vector, std::string;
 /**
  * @brief Get the Available BLE Peripheral addresses
  *
- * @return vector<string> Array of bluetooth device addresses
+ * @param context Bus context to use, by default the shared system bus one
+ *
+ * @return vector<BdAddr> Array of bluetooth device addresses
  */
-vector<string> getAvailableBLEPeripherals();
+vector<BdAddr>
+getAvailableBLEPeripherals(BusContext &context = getDefaultBusContext());
 
 /**
  * @brief Start scanning for BLE devices
@@ -37,10 +41,12 @@ vector<string> getAvailableBLEPeripherals();
  * handler if needed) before calling getAvailableBLEPeripherals(), since new
  * devices may not be detected by bluez as soon as scanning started
  *
+ * @param context Bus context to use, by default the shared system bus one
+ *
  * @return true if successful in turning scan on
  * @return false if could not turn on scanning
  */
-bool startScanningForBLEDevices();
+bool startScanningForBLEDevices(BusContext &context = getDefaultBusContext());
 
 /**
  * @brief Get all Services object, for a specific device
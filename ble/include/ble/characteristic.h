@@ -10,13 +10,50 @@
  */
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include "byte_view.h"
 #include "declarations.h"
+#include "fd_link.h"
+#include "notification_engine.h"
 #include "sdbus-c++/sdbus-c++.h"
+#include "value_buffer.h"
+
+/**
+ * @brief Options bluez passes with ReadValue, WriteValue, AcquireWrite and
+ * AcquireNotify, decoded by Characteristic straight from the D-Bus message
+ *
+ * @references: gatt-api.txt -> GattCharacteristic1 <ReadValue(), WriteValue()>
+ */
+struct GattOptions {
+    /* Object path of the remote device */
+    std::string device;
+    /* Where the value read, or written, starts */
+    u16 offset_b = 0;
+    /* ATT MTU of the link, if bluez passed it */
+    std::optional<u16> mtu_b;
+    /* "BR/EDR" or "LE", empty if bluez didn't say */
+    std::string link;
+    /* Of a write, "command", "request" or "reliable" (prepared) */
+    std::string type;
+    /* A prepared write only asks if it may be queued, no value to take */
+    bool is_prepare_authorize = false;
+
+    /**
+     * @brief Back into the dictionary bluez sent, for the std::vector
+     * overloads. Absent options are left out
+     */
+    std::map<std::string, sdbus::Variant> toMap() const;
+};
 
 /**
  * @brief Characteristic interface
@@ -35,17 +72,96 @@
 class Characteristic {
     std::unique_ptr<sdbus::IObject> characteristic;
 
+    /* Sockets handed to bluez by AcquireWrite/AcquireNotify, null if not
+     * acquired */
+    mutable std::mutex acquired_mutex;
+    std::shared_ptr<FdLink> write_link;
+    std::shared_ptr<FdLink> notify_link;
+    /* By stop(), nothing can be acquired after */
+    bool is_stopped = false;
+
+    std::tuple<sdbus::UnixFd, u16> acquire_link(std::shared_ptr<FdLink> &link,
+                                                const char *property_name,
+                                                const GattOptions &options);
+    void release_link(std::shared_ptr<FdLink> &link,
+                      const char *property_name, int fd);
+
+    /* State of notify(), values not yet sent are flushed by
+     * NotificationEngine */
+    mutable std::mutex notify_mutex;
+    NotifyPolicy notify_policy;
+    std::deque<std::vector<u8>> pending_notifications;
+    /* Last value notified, returned by the "Value" property */
+    std::vector<u8> value;
+    TimerQueue::Clock::time_point last_notified_at;
+    bool is_notifying = false;
+    /* Only with the "notify" or "indicate" flag, set in the constructor */
+    bool has_notifying_property = false;
+    u64 dropped_notification_count = 0;
+
+    /* Values of long reads in progress, by device. bluez reads a value
+     * longer than the MTU a chunk at a time, with increasing "offset", every
+     * chunk is cut from the value read for the first one */
+    std::mutex read_mutex;
+    std::map<std::string, ValueBuffer> read_snapshots;
+
+    void read_chunk(const GattOptions &options, sdbus::MethodReply &reply);
+
+    /* Value each device wrote last, a write at an offset patches it, so
+     * WriteValue always gets a whole value. Pooled, and never changed once
+     * stored */
+    std::mutex write_mutex;
+    std::map<std::string, std::shared_ptr<const std::vector<u8>>>
+        written_values;
+
+    void write_value(ByteView value, const GattOptions &options);
+
+    friend class NotificationEngine;
+    /* Send what's due, returns when the rest will be due, if any */
+    std::optional<TimerQueue::Clock::time_point> flush_notifications();
+    void set_notifying(bool is_notifying);
+
     /**
      * @references:
      * 1. gatt-api.txt -> GattCharacteristic1 <Confirm(), Flags>
+     * 2. gatt-api.txt -> AcquireWrite, AcquireNotify, WriteAcquired,
+     * NotifyAcquired
      */
 
   public:
     /* ReadValue and WriteValue functions must be implemented by the class that
-     * implements this Characteristic interface*/
+     * implements this Characteristic interface
+     *
+     * ReadValue should return the whole value, whatever the "offset" option.
+     * For a value longer than one ATT packet, it is called once, for the
+     * first chunk, the rest are served from that value. Unless bluez passes
+     * no "device" or "mtu", then it is called again for every chunk */
     virtual std::vector<u8>
     ReadValue(std::map<std::string, sdbus::Variant> options = {}) const = 0;
 
+    /**
+     * @brief Same as ReadValue, but the value is shared, not copied, and the
+     * options come decoded
+     *
+     * By default wraps what ReadValue returns. Override this one instead to
+     * hand the same ValueBuffer to every client (eg. keep the last value
+     * set), the reply is serialized straight from it
+     */
+    virtual ValueBuffer ReadValueBuffer(const GattOptions &options) const;
+
+    /**
+     * @brief Called once per written value, with the whole value, at offset
+     * 0. bluez joins the prepared (long) writes of one Execute Write, and a
+     * write at an offset is applied to the value the device wrote last.
+     * Without "device", one at an offset fails with InvalidOffset
+     *
+     * By default copies the value to the vector overload. Override this one
+     * instead to take the value without a copy, `value` is valid only till
+     * this returns. It is read from the D-Bus message into a pooled buffer,
+     * so no allocation either
+     */
+    virtual void WriteValue(ByteView value, const GattOptions &options);
+
     virtual void
     WriteValue(std::vector<u8> value,
                std::map<std::string, sdbus::Variant> options = {}) = 0;
@@ -54,6 +170,13 @@ class Characteristic {
     virtual void StartNotify(){};
     virtual void StopNotify(){};
 
+    /**
+     * @note AcquireWrite is implemented if `flags` contain
+     * "write-without-response", and AcquireNotify if they contain "notify".
+     * Writes received on the acquired socket are passed to WriteValue (with
+     * the options of AcquireWrite, type "command"), on a thread shared by all
+     * acquired sockets
+     */
     Characteristic(sdbus::IConnection &connection,
                    std::string service_object_path, unsigned int index,
                    std::string UUID,
@@ -61,8 +184,53 @@ class Characteristic {
 
     std::string getObjectPath() const;
 
-    virtual ~Characteristic() { /*Nothing to do*/
-    }
+    /**
+     * @brief Close the acquired sockets, waiting for a WriteValue running on
+     * their thread, and stop flushing notifications, so nothing calls into
+     * the derived class any more
+     *
+     * Service calls it before deleting its characteristics. A characteristic
+     * destroyed some other way must call it first thing in its destructor,
+     * the base destructor is too late, the derived part is gone by then
+     */
+    void stop();
+
+    /**
+     * @brief Send a notification over the socket acquired by AcquireNotify
+     *
+     * @return false if notifications have not been acquired (then the value
+     * has to be sent with a PropertiesChanged on "Value"), or the socket is
+     * not accepting it
+     */
+    bool sendAcquiredNotification(const std::vector<u8> &value);
+
+    bool isWriteAcquired() const;
+    bool isNotifyAcquired() const;
+
+    /**
+     * @brief Notify subscribers of a new value, over the acquired socket if
+     * any, else with PropertiesChanged on "Value"
+     *
+     * Doesn't block, the value is sent later by NotificationEngine, as per
+     * the NotifyPolicy. If nobody is subscribed, only "Value" is updated
+     */
+    void notify(std::vector<u8> value);
+
+    void setNotifyPolicy(NotifyPolicy policy);
+
+    /**
+     * @brief Whether someone subscribed with StartNotify, or acquired the
+     * notify socket
+     */
+    bool isNotifying() const;
+
+    /**
+     * @brief Values dropped because the queue was full (NotifyPolicy::QUEUE),
+     * or the acquired socket was full
+     */
+    u64 getDroppedNotificationCount() const;
+
+    virtual ~Characteristic();
 };
 
 /**
@@ -79,9 +247,20 @@ class CharacteristicProxy {
     /*No support for descripters for now*/
   private:
     std::unique_ptr<sdbus::IProxy> _proxy;
+    /* Socket from AcquireNotify, after subscribe(), destroyed (closed)
+     * before the proxy */
+    std::shared_ptr<FdLink> notify_link;
 
   public:
-    CharacteristicProxy(sdbus::IConnection &connection, std::string path);
+    /**
+     * @param connection Connection to the system bus
+     * @param path Object path of the remote characteristic
+     * @param destination Bus name exporting the characteristic, bluez for
+     * characteristics of remote devices, or eg. the unique name of a local
+     * GATT application (used by the benchmarks)
+     */
+    CharacteristicProxy(sdbus::IConnection &connection, std::string path,
+                        std::string destination = "org.bluez");
 
     /* ReadValue and WriteValue functions provided by the characteristic */
     std::vector<u8>
@@ -90,5 +269,61 @@ class CharacteristicProxy {
     void WriteValue(std::vector<u8> value,
                     std::map<std::string, sdbus::Variant> options = {});
 
+    /* `error` is null on success */
+    using ReadCallback =
+        std::function<void(const sdbus::Error *error, std::vector<u8> value)>;
+    using WriteCallback = std::function<void(const sdbus::Error *error)>;
+
+    /**
+     * @brief Non-blocking versions of ReadValue/WriteValue, any number of
+     * them can be in flight on one connection
+     *
+     * The callback is called on the thread running the connection's event
+     * loop (so the event loop must be running, eg. use a BusContext), and
+     * must not block it. It is not called if this proxy is destroyed first
+     */
+    void
+    ReadValueAsync(ReadCallback callback,
+                   std::map<std::string, sdbus::Variant> options = {}) const;
+
+    void WriteValueAsync(std::vector<u8> value, WriteCallback callback,
+                         std::map<std::string, sdbus::Variant> options = {});
+
+    /**
+     * @brief Same as above, but the result (or sdbus::Error) is in a future
+     *
+     * @note Don't wait on the future from the event loop thread, it would
+     * never be ready
+     */
+    std::future<std::vector<u8>>
+    ReadValueAsync(std::map<std::string, sdbus::Variant> options = {}) const;
+
+    std::future<void>
+    WriteValueAsync(std::vector<u8> value,
+                    std::map<std::string, sdbus::Variant> options = {});
+
+    using NotifyCallback = std::function<void(ByteView value)>;
+
+    /**
+     * @brief Receive the characteristic's notifications, over a socket from
+     * AcquireNotify if the characteristic has one, else with StartNotify and
+     * PropertiesChanged on "Value"
+     *
+     * The callback runs on the socket poller thread, or the connection's
+     * event loop thread, `value` is valid only till it returns. Call only
+     * once per proxy, notifications stop when the proxy is destroyed
+     *
+     * @param options Passed to AcquireNotify, bluez ignores them for remote
+     * characteristics, a local GATT application takes "mtu" from them
+     */
+    void subscribe(NotifyCallback callback,
+                   std::map<std::string, sdbus::Variant> options = {});
+
+    /**
+     * @brief MTU of the socket from AcquireNotify, 0 if not acquired,
+     * notifications carry upto MTU - 3 bytes
+     */
+    u16 getNotifyMtu() const;
+
     std::string getPath() const;
 };
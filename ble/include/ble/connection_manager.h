@@ -0,0 +1,165 @@
+/**
+ * @file connection_manager.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Connecting to many devices at once, with retries, and tracking
+ * which devices are connected
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bdaddr.h"
+#include "bus_context.h"
+#include "timer_queue.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+/**
+ * @brief How ConnectionManager retries a failed Connect
+ */
+struct ConnectPolicy {
+    /* Including the first one */
+    unsigned int max_attempts = 4;
+
+    /* Backoff before the Nth retry is initial_backoff_ms * 2^(N-1), capped
+     * at max_backoff_ms, and then a random time from half of it to all of it
+     * is waited, so devices that failed together don't retry together */
+    std::chrono::milliseconds initial_backoff_ms{250};
+    std::chrono::milliseconds max_backoff_ms{8000};
+
+    /* Of one Connect call, bluez itself gives up on LE devices after some
+     * seconds */
+    std::chrono::milliseconds timeout_ms{10000};
+};
+
+enum class ConnectionState { DISCONNECTED, CONNECTING, CONNECTED };
+
+/**
+ * @brief Connects devices with async Connect calls, at most
+ * `max_connects_per_adapter` in flight per adapter, retrying failures with
+ * exponential backoff
+ *
+ * Connection state of every device is followed from Device1.Connected, as
+ * seen in the context's object tree, so getState() is current even for
+ * devices connected or disconnected by someone else
+ *
+ * @note Completion callbacks run on the context's event loop thread (or the
+ * calling thread, if the device is already connected), and must not block
+ */
+class ConnectionManager {
+  public:
+    /* `error` is nullptr if connected */
+    using Callback =
+        std::function<void(BdAddr address, const sdbus::Error *error)>;
+
+  private:
+    struct Request {
+        std::string device_path;
+        std::string adapter_path;
+        BdAddr address;
+        Callback callback;
+        unsigned int attempt_count = 0;
+        TimerQueue::TimerId retry_id = 0;
+
+        /* Kept for the retries, destroying a proxy drops its replies */
+        std::unique_ptr<sdbus::IProxy> proxy;
+    };
+
+    struct AdapterQueue {
+        std::deque<std::shared_ptr<Request>> waiting;
+        unsigned int active_count = 0;
+    };
+
+    BusContext &context;
+    unsigned int max_connects_per_adapter;
+    ConnectPolicy policy;
+    BluezObjectTree::ListenerId listener_id = 0;
+
+    struct Activity;
+    std::shared_ptr<Activity> activity;
+
+    std::mutex mutex;
+    bool is_stopping = false;
+    std::map<std::string, AdapterQueue> adapters;
+    /* Requests waiting for their retry, by timer */
+    std::map<TimerQueue::TimerId, std::shared_ptr<Request>> backing_off;
+    /* Requests whose Connect call has no reply yet */
+    std::set<std::shared_ptr<Request>> in_flight;
+    std::map<std::string, ConnectionState> states;
+    std::minstd_rand random;
+
+    /* Last member, so retries are cancelled before the rest is destroyed */
+    TimerQueue retries;
+
+    std::vector<std::shared_ptr<Request>>
+    take_startable(AdapterQueue &adapter);
+    void issue(const std::shared_ptr<Request> &request);
+    void on_reply(const std::shared_ptr<Request> &request,
+                  const sdbus::Error *error);
+    void requeue(const std::shared_ptr<Request> &request);
+    void complete(const std::shared_ptr<Request> &request,
+                  const sdbus::Error *error);
+    void cancel(const std::shared_ptr<Request> &request);
+    TimerQueue::Clock::duration get_backoff(unsigned int attempt_count);
+    void on_change(const BluezObjectTree::Change &change);
+
+  public:
+    /**
+     * @param max_connects_per_adapter Connect calls in flight at the same
+     * time on one adapter
+     */
+    explicit ConnectionManager(BusContext &context = getDefaultBusContext(),
+                               unsigned int max_connects_per_adapter = 4,
+                               ConnectPolicy policy = ConnectPolicy());
+
+    ConnectionManager(const ConnectionManager &) = delete;
+    ConnectionManager &operator=(const ConnectionManager &) = delete;
+
+    /**
+     * @brief Fails every request not yet completed with
+     * org.bluez.Error.Failed, dropping Connect calls in flight instead of
+     * waiting for their replies
+     *
+     * Waits only for callbacks running on other threads, so the manager can
+     * also be destroyed on the event loop thread, or from a callback
+     */
+    ~ConnectionManager();
+
+    /**
+     * @brief Connect to a device, returns immediately, `callback` is called
+     * once, when connected or out of attempts
+     *
+     * Errors that won't go away on retrying, like an unknown device, are not
+     * retried
+     */
+    void connect(BdAddr address, Callback callback,
+                 const std::string &adapter_path = "/org/bluez/hci0");
+
+    /**
+     * @brief Block till every connect() so far has completed
+     *
+     * @note Not from a callback or the event loop thread, the replies it
+     * waits for would never come
+     */
+    void waitUntilIdle();
+
+    ConnectionState
+    getState(BdAddr address,
+             const std::string &adapter_path = "/org/bluez/hci0");
+
+    std::vector<BdAddr>
+    getConnectedDevices(const std::string &adapter_path = "/org/bluez/hci0");
+};
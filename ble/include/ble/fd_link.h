@@ -0,0 +1,101 @@
+/**
+ * @file fd_link.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Socket shared with bluez for AcquireWrite/AcquireNotify, so
+ * characteristic values travel over the socket instead of D-Bus messages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "declarations.h"
+
+class FdPoller;
+
+/**
+ * @brief Our end of a SOCK_SEQPACKET socket pair, the other end of which is
+ * handed to bluez
+ *
+ * Reads happen on a thread shared by all links (an epoll loop), each packet
+ * read is passed to the read callback. Sends are non-blocking, if the socket
+ * is full they are queued and flushed by the same epoll loop
+ *
+ * @references:
+ * 1. gatt-api.txt -> AcquireWrite, AcquireNotify
+ */
+class FdLink {
+  public:
+    using ReadCallback = std::function<void(const u8 *data, size_t size_b)>;
+    using CloseCallback = std::function<void()>;
+
+  private:
+    int fd;
+    u16 mtu_b;
+    ReadCallback on_read;
+    CloseCallback on_close;
+    std::atomic<bool> is_open{true};
+
+    /* One packet can't be bigger than mtu, so one buffer for all reads */
+    std::vector<u8> read_buffer;
+
+    /* Also held to close the fd, send() checks `is_open` under it */
+    std::mutex write_mutex;
+    std::deque<std::vector<u8>> pending_writes;
+
+    void close_fd();
+
+    FdLink(int fd, u16 mtu_b, ReadCallback on_read, CloseCallback on_close);
+
+    /* Called by FdPoller, on its thread */
+    friend class FdPoller;
+    void handle_readable();
+    void handle_writable();
+    void handle_hangup();
+
+  public:
+    /**
+     * @brief Start polling `fd`, takes ownership of it
+     *
+     * @param fd Non-blocking SOCK_SEQPACKET socket
+     * @param mtu_b Largest packet that can be read or sent
+     * @param on_read Called on the poller thread for every packet read
+     * @param on_close Called on the poller thread if the other end closes,
+     * not called for close()
+     */
+    static std::shared_ptr<FdLink> open(int fd, u16 mtu_b, ReadCallback on_read,
+                                        CloseCallback on_close = {});
+
+    FdLink(const FdLink &) = delete;
+    FdLink &operator=(const FdLink &) = delete;
+
+    ~FdLink();
+
+    /**
+     * @brief Send one packet, without blocking
+     *
+     * @return false if the link is closed, the packet is bigger than mtu, or
+     * too many packets are already queued
+     */
+    bool send(const u8 *data, size_t size_b);
+
+    /**
+     * @brief Stop polling and close the socket, waits for a running read
+     * callback (unless called from it)
+     */
+    void close();
+
+    bool isOpen() const;
+    int getFd() const;
+    u16 getMtu() const;
+};
@@ -0,0 +1,86 @@
+/**
+ * @file notification_engine.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Rate limiting and batching of characteristic notifications
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "timer_queue.h"
+
+class Characteristic;
+
+/**
+ * @brief How Characteristic::notify() coalesces values, when they come faster
+ * than they are sent
+ */
+struct NotifyPolicy {
+    enum class Mode {
+        /* Only the latest value is kept, older unsent values are replaced */
+        LATEST,
+        /* Every value is sent, upto `max_queue_depth` unsent values, after
+         * which the oldest is dropped */
+        QUEUE
+    };
+
+    Mode mode = Mode::LATEST;
+
+    /* Minimum time between two notifications, 0 to send as soon as possible
+     * (values notified before the flush still get coalesced) */
+    std::chrono::milliseconds min_interval_ms{0};
+
+    size_t max_queue_depth = 16;
+};
+
+/**
+ * @brief Flushes pending notifications of all characteristics, from one
+ * thread
+ *
+ * All characteristics due at the same time are flushed in the same pass,
+ * instead of one wakeup (and one thread) per characteristic
+ */
+class NotificationEngine {
+    using Clock = TimerQueue::Clock;
+
+    std::mutex mutex;
+    std::condition_variable flush_done;
+
+    /* Characteristics with pending values, and when they are due */
+    std::map<Characteristic *, Clock::time_point> pending;
+    /* Characteristics being flushed right now */
+    std::set<Characteristic *> flushing;
+
+    /* Deadline of the earliest flush scheduled, max() if none */
+    Clock::time_point scheduled_at = Clock::time_point::max();
+
+    /* Last member, so its thread is stopped before the rest is destroyed */
+    TimerQueue timers;
+
+    void flush();
+
+  public:
+    static NotificationEngine &getInstance();
+
+    /**
+     * @brief Flush `characteristic` at `due_at`, or earlier if it is already
+     * pending for an earlier time
+     */
+    void markPending(Characteristic *characteristic, Clock::time_point due_at);
+
+    /**
+     * @brief Forget `characteristic`, waits if it is being flushed (unless
+     * called from the flush itself)
+     */
+    void remove(Characteristic *characteristic);
+};
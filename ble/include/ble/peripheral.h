@@ -11,7 +11,9 @@
 #pragma once
 
 #include "advertisement.h"
+#include "advertisement_scheduler.h"
 #include "application.h"
+#include "bulk_transfer_service.h"
 #include "characteristic.h"
 #include "declarations.h"
 #include "service.h"
@@ -0,0 +1,79 @@
+/**
+ * @file read_scheduler.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Reading characteristics from many devices at once, instead of
+ * one read after other
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bus_context.h"
+#include "declarations.h"
+#include "timer_queue.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+/**
+ * @brief One characteristic to read, identified by its UUID on a device
+ */
+struct ReadItem {
+    /* eg. "/org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX" */
+    std::string device_path;
+    std::string characteristic_uuid;
+};
+
+struct ReadResult {
+    ReadItem item;
+    std::vector<u8> value;
+
+    /* Empty if the read succeeded */
+    std::optional<sdbus::Error> error;
+
+    /* From issuing the ReadValue till its reply, excludes connecting */
+    std::chrono::steady_clock::duration latency{};
+};
+
+/**
+ * @brief Reads a batch of (device, characteristic) items, with a bounded
+ * number of devices in progress per adapter
+ *
+ * Items are grouped by device, so every device is connected once, all its
+ * reads are in flight together, and then the next device of that adapter
+ * takes its place. Devices that were not connected before are disconnected
+ * after their reads, to free the controller's connection slots
+ *
+ * @note Uses the context's object tree to find characteristics, so bluez must
+ * have resolved the device's services (ServicesResolved) by the time Connect
+ * replies, which it does for LE devices
+ */
+class ReadScheduler {
+    BusContext &context;
+    unsigned int max_devices_per_adapter;
+    /* Destroys finished sweeps off the event loop thread */
+    std::unique_ptr<TimerQueue> timers;
+
+  public:
+    /**
+     * @param max_devices_per_adapter Devices being connected to or read from,
+     * at the same time on one adapter. Controllers commonly support upto 5-10
+     * LE connections
+     */
+    explicit ReadScheduler(BusContext &context = getDefaultBusContext(),
+                           unsigned int max_devices_per_adapter = 4);
+
+    /**
+     * @brief Read all `items`, blocks till every item has a result
+     *
+     * @return Results in same order as `items`
+     */
+    std::vector<ReadResult> run(const std::vector<ReadItem> &items);
+};
@@ -0,0 +1,67 @@
+/**
+ * @file scan_event.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Fixed size scan record, for passing scan results between threads
+ * through a BoundedRing
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstddef>
+
+#include "bdaddr.h"
+#include "bounded_ring.h"
+#include "declarations.h"
+
+enum class ScanEventKind : u8 { FOUND, UPDATED, LOST };
+
+/* Payload of a legacy advertising PDU, longer data is truncated */
+const size_t SCAN_EVENT_DATA_MAX_B = 31;
+
+/**
+ * @brief One scan result, with everything inline, so it can be copied into
+ * a preallocated slot without allocating
+ *
+ * Only the first manufacturer data and service data entries are kept, which
+ * is all nearly every advertisement has
+ *
+ * @note Filling one from the D-Bus properties still copies the data out of
+ * its sdbus variants, only the event itself is allocation free
+ */
+struct ScanEvent {
+    enum Flags : u8 {
+        HAS_RSSI = 1 << 0,
+        HAS_TX_POWER = 1 << 1,
+        HAS_MANUFACTURER_DATA = 1 << 2,
+        HAS_SERVICE_DATA = 1 << 3,
+        /* Some data was longer than SCAN_EVENT_DATA_MAX_B, or there was more
+         * than one entry */
+        TRUNCATED = 1 << 4,
+    };
+
+    /* steady_clock, when the event loop thread got the signal */
+    u64 timestamp_ns;
+
+    ScanEventKind kind;
+    u8 flags;
+
+    BdAddr address;
+
+    i16 rssi_dbm;
+    i16 tx_power_dbm;
+
+    u16 company_id;
+    u8 manufacturer_data_size_b;
+    u8 manufacturer_data[SCAN_EVENT_DATA_MAX_B];
+
+    /* 128 bit UUID, most significant byte first */
+    u8 service_uuid[16];
+    u8 service_data_size_b;
+    u8 service_data[SCAN_EVENT_DATA_MAX_B];
+};
+
+using ScanEventRing = BoundedRing<ScanEvent>;
@@ -0,0 +1,148 @@
+/**
+ * @file scan_session.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Discovery that reports devices as bluez sees them, instead of
+ * polling for a list of addresses
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bdaddr.h"
+#include "bus_context.h"
+#include "declarations.h"
+#include "scan_event.h"
+
+/**
+ * @brief What a scan knows about one device, from its Device1 properties
+ */
+struct ScanRecord {
+    std::string device_path;
+    BdAddr address;
+    std::optional<std::string> name;
+    std::optional<i16> rssi_dbm;
+    std::optional<i16> tx_power_dbm;
+
+    /* Company ID -> data */
+    std::map<u16, std::vector<u8>> manufacturer_data;
+    /* Service UUID -> data */
+    std::map<std::string, std::vector<u8>> service_data;
+    std::vector<std::string> uuids;
+};
+
+/**
+ * @brief Discovery filter, passed to bluez's SetDiscoveryFilter
+ */
+struct ScanFilter {
+    /* "auto", "bredr" or "le" */
+    std::string transport = "le";
+    /* Only report devices with RSSI at least this */
+    std::optional<i16> rssi_dbm;
+    /* Only report devices advertising any of these service UUIDs */
+    std::vector<std::string> uuids;
+};
+
+/**
+ * @brief One discovery session on an adapter, reporting found, updated and
+ * lost devices as the InterfacesAdded/PropertiesChanged/InterfacesRemoved
+ * signals arrive
+ *
+ * Only devices actually seen in this session are reported, ie. added by
+ * bluez, or with new advertising data (RSSI etc.), not ones bluez just
+ * remembers. Updates are only reported if something in the record changed
+ *
+ * Events can go to a callback, or into a ScanEventRing, for consumers on
+ * other threads that must never hold up the event loop
+ *
+ * @note Callbacks run on the context's event loop thread, and must not block
+ * or call into the context's object tree. bluez keeps one discovery per
+ * D-Bus client, so two sessions on same adapter and same context share it
+ *
+ * @references:
+ * 1. adapter-api.txt -> StartDiscovery, StopDiscovery, SetDiscoveryFilter
+ */
+class ScanSession {
+  public:
+    using Event = ScanEventKind;
+    using Callback = std::function<void(Event event, const ScanRecord &record)>;
+
+  private:
+    BusContext &context;
+    std::string adapter_path;
+    Callback callback;
+    ScanEventRing *ring = nullptr;
+
+    std::mutex mutex;
+    bool is_active = false;
+    BluezObjectTree::ListenerId listener_id = 0;
+
+    /* Devices seen in this session, by object path. `record` is only
+     * filled if there is a callback */
+    struct SeenDevice {
+        ScanEvent event;
+        ScanRecord record;
+    };
+    std::map<std::string, SeenDevice> seen;
+
+    void on_change(const BluezObjectTree::Change &change);
+
+  public:
+    /**
+     * @param adapter_path Adapter to scan on, empty for the first adapter
+     * capable of LE
+     */
+    explicit ScanSession(Callback callback,
+                         BusContext &context = getDefaultBusContext(),
+                         std::string adapter_path = "");
+
+    /**
+     * @brief Push events into `ring` instead, which must outlive the session
+     *
+     * Consumers read the ring with tryPop(), when it is full events are
+     * dropped as per its OverflowPolicy, and counted in getDroppedCount()
+     */
+    explicit ScanSession(ScanEventRing &ring,
+                         BusContext &context = getDefaultBusContext(),
+                         std::string adapter_path = "");
+
+    ScanSession(const ScanSession &) = delete;
+    ScanSession &operator=(const ScanSession &) = delete;
+
+    /**
+     * @brief Stops discovery, if active
+     */
+    ~ScanSession();
+
+    /**
+     * @brief Set discovery filter and start discovery
+     *
+     * @throws sdbus::Error if bluez refuses, `org.bluez.Error.InProgress`
+     * (someone else on this connection is discovering) is not an error
+     */
+    void start(const ScanFilter &filter = ScanFilter());
+
+    /**
+     * @brief Stop discovery, no callback is running or called once this
+     * returns (so don't call it from the callback)
+     */
+    void stop();
+
+    bool isActive();
+
+    /**
+     * @brief Devices seen since start(), empty if events go to a ring
+     */
+    std::vector<ScanRecord> getSeenDevices();
+
+    const std::string &getAdapterPath() const;
+};
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <thread>
 
@@ -9,159 +12,343 @@
 
 #include "sdbus-c++/sdbus-c++.h"
 
-using std::cout, std::cerr, std::endl;
+using std::cout, std::cerr, std::endl, std::string, std::vector;
 
-void Advertisement::turnOnAdvertising() {
-    // Register object, an object needs to be unregistered before registering
-    // again, hence turnOnAdvertising must not be simultaneously called twice,
-    // though calling it after a turnOffAdvertising is safe
-    ad->finishRegistration();
-    /**
-     * @references:
-     * 1. adapter-api.txt -> Discoverable[=true]
-     * 2. advertising-api.txt -> LEAdvertisement1, LEAdvertisementManager1
-     */
-
-    // This is NEEDED, since after we call RegisterAdvertisement, bluez in
-    // return calls `GetAll` method on the passed advertisement object, so we
-    // need a event loop to run asynchronously to reply, WHILE WE ARE WAITING
-    // for bluez's reply which in turn requires our application to reply to it
-    connection.enterEventLoopAsync();
-
-    sdbus::createProxy(connection, "org.bluez", adapter_object_path)
-        ->callMethod("RegisterAdvertisement")
-        .onInterface("org.bluez.LEAdvertisingManager1")
+namespace {
+const auto ADVERTISING_MANAGER_IFACE = "org.bluez.LEAdvertisingManager1";
+// reference: bluez-5.63/doc/advertising-api.txt
+const auto AD_IFACE = "org.bluez.LEAdvertisement1";
+
+/* Length and type bytes of every AD structure */
+const auto AD_HEADER_B = 2u;
+/* Flags AD structure, bluez adds it to connectable and discoverable
+ * advertisements, counted always */
+const auto FLAGS_B = 3u;
+const auto TX_POWER_B = 3u;
+const auto APPEARANCE_B = 4u;
+const auto COMPANY_ID_B = 2u;
+
+const auto BLUETOOTH_BASE_UUID_SUFFIX = "-0000-1000-8000-00805f9b34fb";
+
+/* Characters of a UUID string, and bytes over the air, of 16, 32 and 128
+ * bit UUIDs */
+const auto UUID16_CHARS = 4u;
+const auto UUID32_CHARS = 8u;
+const auto UUID128_CHARS = 36u;
+const auto UUID16_B = 2u;
+const auto UUID32_B = 4u;
+const auto UUID128_B = 16u;
+
+/* Bytes a UUID takes over the air, 16 and 32 bit UUIDs are sent short */
+size_t get_uuid_size_b(const string &uuid) {
+    if (uuid.size() == UUID16_CHARS) {
+        return UUID16_B;
+    }
+    if (uuid.size() == UUID32_CHARS) {
+        return UUID32_B;
+    }
+    if (uuid.size() != UUID128_CHARS) {
+        return UUID128_B;
+    }
+
+    /* On the Bluetooth base UUID, the first 8 characters are the 32 bit
+     * UUID, and a 16 bit one if they start with "0000" */
+    auto suffix = uuid.substr(UUID32_CHARS);
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (suffix != BLUETOOTH_BASE_UUID_SUFFIX) {
+        return UUID128_B;
+    }
+    if (uuid.compare(0, UUID16_CHARS, "0000") == 0) {
+        return UUID16_B;
+    } else {
+        return UUID32_B;
+    }
+}
+
+/* UUIDs of same size go in one AD structure */
+size_t get_uuid_list_size_b(const vector<string> &uuids) {
+    auto count_by_size = std::map<size_t, size_t>();
+    for (const auto &uuid : uuids) {
+        ++count_by_size[get_uuid_size_b(uuid)];
+    }
+
+    auto size = size_t(0);
+    for (const auto &entry : count_by_size) {
+        size += AD_HEADER_B + entry.first * entry.second;
+    }
+    return size;
+}
+
+bool contains(const vector<string> &values, const string &value) {
+    return std::find(values.begin(), values.end(), value) != values.end();
+}
+} // namespace
+
+size_t AdvertisingData::getPayloadSize() const {
+    auto size = size_t(FLAGS_B);
+    size += get_uuid_list_size_b(service_uuids);
+    size += get_uuid_list_size_b(solicit_uuids);
+
+    for (const auto &entry : manufacturer_data) {
+        size += AD_HEADER_B + COMPANY_ID_B + entry.second.size();
+    }
+    for (const auto &entry : service_data) {
+        size += AD_HEADER_B + get_uuid_size_b(entry.first) +
+                entry.second.size();
+    }
+
+    if (!local_name.empty()) {
+        size += AD_HEADER_B + local_name.size();
+    } else if (contains(includes, "local-name")) {
+        size += AD_HEADER_B;
+    }
+    if (appearance || contains(includes, "appearance")) {
+        size += APPEARANCE_B;
+    }
+    if (contains(includes, "tx-power")) {
+        size += TX_POWER_B;
+    }
+    return size;
+}
+
+/**
+ * @references:
+ * 1. adapter-api.txt -> Discoverable[=true]
+ * 2. advertising-api.txt -> LEAdvertisement1, LEAdvertisementManager1
+ */
+std::future<void> Advertisement::turnOnAdvertising() {
+    auto is_stale = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stale = is_export_stale;
+        is_export_stale = false;
+    }
+    if (is_stale) {
+        /* bluez is not using it, not registered */
+        export_object();
+    }
+
+    /* std::function needs a copyable callable, promise isn't */
+    auto promise = std::make_shared<std::promise<void>>();
+
+    /* After we call RegisterAdvertisement, bluez in return calls `GetAll` on
+     * the advertisement object, before replying. The context's event loop
+     * thread answers that, while the reply is awaited by nobody */
+    advertising_manager->callMethodAsync("RegisterAdvertisement")
+        .onInterface(ADVERTISING_MANAGER_IFACE)
         .withArguments(sdbus::ObjectPath(ad->getObjectPath()),
-                       std::map<std::string, sdbus::Variant>());
-
-    cout << "Successfully registered advertisement: " << ad->getObjectPath()
-         << endl;
-
-    auto bluez_root_obj = sdbus::createProxy(connection, "org.bluez", "/");
-    bluez_root_obj->uponSignal("InterfaceAdded")
-        .onInterface("org.freedesktop.DBus.ObjectManager")
-        .call([this](const sdbus::ObjectPath &object_path,
-                     const std::map<std::string,
-                                    std::map<std::string, sdbus::Variant>>
-                         interfaces) {
-            cout << "New object: " << object_path << endl;
-            auto dev_interface = interfaces.find("org.bluez.Device1");
-            if (dev_interface != interfaces.cend()) {
-                auto iter_connected = dev_interface->second.find("Connected");
-
-                if (iter_connected != dev_interface->second.cend()) {
-                    auto is_connected = iter_connected->second.get<bool>();
-                    cout << "Connected: " << std::boolalpha << is_connected
-                         << endl;
-
-                    if (is_connected) {
-                        // Once we are connected (only then eventLoop will be
-                        // exited), unregister the advertisement
-                        turnOffAdvertising();
-                    }
-                }
-
-                /* This will end the blocking wait at end of the function */
-                connection.leaveEventLoop();
+                       std::map<std::string, sdbus::Variant>())
+        .uponReplyInvoke([this, promise](const sdbus::Error *error) {
+            if (error) {
+                promise->set_exception(std::make_exception_ptr(*error));
+                return;
             }
-        });
 
-    // TODO: Call turnOnAdvertising when a 'previously connected device
-    // disconnects'
-    bluez_root_obj->registerSignalHandler(
-        "org.freedesktop.DBus.Properties", "PropertiesChanged",
-        [](sdbus::Signal &s) { cout << "called" << s.getPath() << endl; });
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                is_registered = true;
+            }
+#ifdef VERBOSE_DEBUG
+            cout << "Successfully registered advertisement: "
+                 << ad->getObjectPath() << endl;
+#endif
+            promise->set_value();
+        });
 
-    // Leave previous async loop, and do a Blocking wait afterwards
-    connection.leaveEventLoop();
-    // Blocking wait
-    connection.enterEventLoop();
+    return promise->get_future();
 }
 
 /**
- * @brief Unregisters advertisement
- *
- * @param advertisement_object_path Path of registered advertisement
- * @param adapter_object_path Path to adapter on which the advertisement is
- * registered with
+ * @brief Unregisters advertisement, from the adapter it was registered with
  */
-void Advertisement::turnOffAdvertising() {
-    sdbus::createProxy(connection, "org.bluez", adapter_object_path)
-        ->callMethod("UnregisterAdvertisement")
-        .onInterface("org.bluez.LEAdvertisingManager1")
-        .withArguments(sdbus::ObjectPath(ad->getObjectPath()));
-    ad->unregister();
+std::future<void> Advertisement::turnOffAdvertising() {
+    auto promise = std::make_shared<std::promise<void>>();
+    advertising_manager->callMethodAsync("UnregisterAdvertisement")
+        .onInterface(ADVERTISING_MANAGER_IFACE)
+        .withArguments(sdbus::ObjectPath(ad->getObjectPath()))
+        .uponReplyInvoke([this, promise](const sdbus::Error *error) {
+            if (error) {
+                promise->set_exception(std::make_exception_ptr(*error));
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                is_registered = false;
+            }
+            promise->set_value();
+        });
+
+    return promise->get_future();
 }
 
 /**
- * @brief Construct a new Advertisement object, and register it with bluez
+ * @brief Construct a new Advertisement object, and export it on the context's
+ * connection, turnOnAdvertising registers it with bluez
  *
- * @param connection Connection to the system bus
+ * @param context Bus context to export on, by default the shared system bus
+ * one
  */
-Advertisement::Advertisement(sdbus::IConnection &connection,
-                             const std::string &object_path)
-    : connection(connection) {
-    adapter_object_path = get_advertising_capable_adapter_path();
+Advertisement::Advertisement(BusContext &context,
+                             const std::string &object_path,
+                             AdvertisingPdu pdu)
+    : context(context), object_path(object_path), pdu(pdu) {
+    adapter_object_path = get_advertising_capable_adapter_path(context);
 
-    auto is_adapter_powered_on = isAdapterPoweredOn(adapter_object_path);
+    auto is_adapter_powered_on =
+        isAdapterPoweredOn(adapter_object_path, context);
     if (!is_adapter_powered_on) {
         // TODO
         try {
-            tryPoweringOnAdapter(adapter_object_path);
+            tryPoweringOnAdapter(adapter_object_path, context);
         } catch (std::exception &e) {
             std::cerr << "ERR: Could not power on adapter, try manually: "
                       << e.what() << endl;
-            std::cerr << "Failed registering advertisement" << endl;
-            return;
         }
     }
 
-    // reference: bluez-5.63/doc/advertising-api.txt
-    const auto AD_INTERFACE_NAME = "org.bluez.LEAdvertisement1";
-    ad = sdbus::createObject(connection, object_path);
+    advertising_manager = context.createBluezProxy(adapter_object_path);
+
+    data.local_name = "A BLE G";
+    data.includes = {"tx-power"};
+    export_object();
+}
+
+/* Not while registered, the old object is unexported, and a new one with the
+ * currently set optional properties takes its path */
+void Advertisement::export_object() {
+    ad.reset();
+    ad = sdbus::createObject(context.getConnection(), object_path);
 
     ad->registerMethod("Release")
-        .onInterface(AD_INTERFACE_NAME)
-        .implementedAs([]() { /*No task*/ })
+        .onInterface(AD_IFACE)
+        .implementedAs([this]() {
+            /* bluez dropped the advertisement itself, eg. adapter removed */
+            std::lock_guard<std::mutex> lock(mutex);
+            is_registered = false;
+        })
         .withNoReply();
 
-    ad->registerProperty("Type")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return "peripheral"; });
-
+    /* Getters only copy, the variants were built when set. The destructor
+     * unexports the object first, so getters can't be called after */
+    ad->registerProperty("Type").onInterface(AD_IFACE).withGetter([this]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return type;
+    });
     ad->registerProperty("ServiceUUIDs")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return std::vector<std::string>(); });
-
+        .onInterface(AD_IFACE)
+        .withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return data.service_uuids;
+        });
     ad->registerProperty("ManufacturerData")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return std::map<std::string, sdbus::Variant>(); });
-
+        .onInterface(AD_IFACE)
+        .withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return manufacturer_data_value;
+        });
     ad->registerProperty("SolicitUUIDs")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return std::vector<std::string>(); });
-
+        .onInterface(AD_IFACE)
+        .withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return data.solicit_uuids;
+        });
     ad->registerProperty("ServiceData")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return std::map<std::string, sdbus::Variant>(); });
-
-    ad->registerProperty("Includes")
-        .onInterface(AD_INTERFACE_NAME)
-        .withGetter([]() { return std::vector<std::string>({"tx-power"}); });
-
+        .onInterface(AD_IFACE)
+        .withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return service_data_value;
+        });
+    ad->registerProperty("Includes").onInterface(AD_IFACE).withGetter([this]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return data.includes;
+    });
     ad->registerProperty("LocalName")
-        .onInterface(AD_INTERFACE_NAME)
+        .onInterface(AD_IFACE)
         .withGetter([this]() {
-            /* it intentionally references advertised_name variable, so any
-             * change is visible here too, SEG FAULT is handled because,
-             * in case, this object is deleted, it also unregisters this object
-             * so this getter must not be called then*/
-            return this->advertised_name;
+            std::lock_guard<std::mutex> lock(mutex);
+            return data.local_name;
         });
 
-    // This ad object won't be registered now itself,
-    // turnOnAdvertising should be called, it is responsible for registering
-    // this object with DBus and with AdvertisementManager1
+    exported_properties = {"Type",         "ServiceUUIDs", "ManufacturerData",
+                           "SolicitUUIDs", "ServiceData",  "Includes",
+                           "LocalName"};
+
+    /* Optional ones are exported only if set, bluez treats a present
+     * property as set */
+    std::lock_guard<std::mutex> lock(mutex);
+    if (data.appearance) {
+        ad->registerProperty("Appearance")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return data.appearance.value_or(0);
+            });
+        exported_properties.insert("Appearance");
+    }
+    if (is_discoverable) {
+        ad->registerProperty("Discoverable")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return is_discoverable.value_or(false);
+            });
+        exported_properties.insert("Discoverable");
+    }
+    if (tx_power_dbm) {
+        ad->registerProperty("TxPower")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return tx_power_dbm.value_or(0);
+            });
+        exported_properties.insert("TxPower");
+    }
+    if (duration_s) {
+        ad->registerProperty("Duration")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return duration_s.value_or(0);
+            });
+        exported_properties.insert("Duration");
+    }
+    if (timeout_s) {
+        ad->registerProperty("Timeout")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return timeout_s.value_or(0);
+            });
+        exported_properties.insert("Timeout");
+    }
+    if (min_interval_ms) {
+        ad->registerProperty("MinInterval")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return min_interval_ms.value_or(0);
+            });
+        exported_properties.insert("MinInterval");
+    }
+    if (max_interval_ms) {
+        ad->registerProperty("MaxInterval")
+            .onInterface(AD_IFACE)
+            .withGetter([this]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return max_interval_ms.value_or(0);
+            });
+        exported_properties.insert("MaxInterval");
+    }
+    if (pdu == AdvertisingPdu::EXTENDED) {
+        /* Having a secondary channel makes bluez use extended advertising */
+        ad->registerProperty("SecondaryChannel")
+            .onInterface(AD_IFACE)
+            .withGetter([]() { return std::string("1M"); });
+    }
+
+    ad->finishRegistration();
 
 #ifdef VERBOSE_DEBUG
     std::cout << "Created advertisement at path: " << ad->getObjectPath()
@@ -169,8 +356,207 @@ Advertisement::Advertisement(sdbus::IConnection &connection,
 #endif
 }
 
-void Advertisement::setAdvertisedName(const std::string &new_name) {
-    this->advertised_name = new_name;
+/* Validates, then swaps in `new_data` and its variants, and signals the
+ * changed properties */
+void Advertisement::set_data(const AdvertisingData &new_data,
+                             const vector<string> &changed_properties) {
+    auto size_b = new_data.getPayloadSize();
+    if (size_b > getPayloadBudget()) {
+        throw std::length_error("Advertising data needs " +
+                                std::to_string(size_b) + " bytes, only " +
+                                std::to_string(getPayloadBudget()) +
+                                " fit in the advertising PDU");
+    }
+
+    auto manufacturer_data = std::map<u16, sdbus::Variant>();
+    for (const auto &entry : new_data.manufacturer_data) {
+        manufacturer_data.emplace(entry.first, sdbus::Variant(entry.second));
+    }
+    auto service_data = std::map<string, sdbus::Variant>();
+    for (const auto &entry : new_data.service_data) {
+        service_data.emplace(entry.first, sdbus::Variant(entry.second));
+    }
+
+    auto signalled = vector<string>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (new_data.appearance.has_value() != data.appearance.has_value()) {
+            if (is_registered) {
+                throw std::logic_error(
+                    "Appearance can't be set or cleared while advertising");
+            }
+            is_export_stale = true;
+        }
+
+        data = new_data;
+        manufacturer_data_value = std::move(manufacturer_data);
+        service_data_value = std::move(service_data);
+
+        for (const auto &name : changed_properties) {
+            if (exported_properties.count(name)) {
+                signalled.push_back(name);
+            }
+        }
+    }
+
+    /* Outside the lock, the getters are called right here */
+    if (!signalled.empty()) {
+        ad->emitPropertiesChangedSignal(AD_IFACE, signalled);
+    }
+}
+
+template <typename T>
+void Advertisement::set_optional(std::optional<T> &field,
+                                 std::optional<T> value,
+                                 const string &property_name) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (field.has_value() != value.has_value()) {
+            if (is_registered) {
+                throw std::logic_error(
+                    property_name +
+                    " can't be set or cleared while advertising");
+            }
+            field = value;
+            is_export_stale = true;
+            return;
+        }
+
+        field = value;
+        if (!exported_properties.count(property_name)) {
+            return;
+        }
+    }
+
+    ad->emitPropertiesChangedSignal(AD_IFACE, {property_name});
+}
+
+Advertisement &Advertisement::setData(const AdvertisingData &new_data) {
+    set_data(new_data, {"ServiceUUIDs", "SolicitUUIDs", "ManufacturerData",
+                        "ServiceData", "LocalName", "Appearance", "Includes"});
+    return *this;
+}
+
+Advertisement &Advertisement::setAdvertisedName(const std::string &new_name) {
+    auto new_data = getData();
+    new_data.local_name = new_name;
+    set_data(new_data, {"LocalName"});
+    return *this;
+}
+
+Advertisement &Advertisement::setServiceUuids(vector<string> uuids) {
+    auto new_data = getData();
+    new_data.service_uuids = std::move(uuids);
+    set_data(new_data, {"ServiceUUIDs"});
+    return *this;
+}
+
+Advertisement &Advertisement::setSolicitUuids(vector<string> uuids) {
+    auto new_data = getData();
+    new_data.solicit_uuids = std::move(uuids);
+    set_data(new_data, {"SolicitUUIDs"});
+    return *this;
+}
+
+Advertisement &Advertisement::setManufacturerData(
+    std::map<u16, vector<u8>> manufacturer_data) {
+    auto new_data = getData();
+    new_data.manufacturer_data = std::move(manufacturer_data);
+    set_data(new_data, {"ManufacturerData"});
+    return *this;
+}
+
+Advertisement &Advertisement::setManufacturerData(u16 company_id,
+                                                  vector<u8> value) {
+    auto new_data = getData();
+    new_data.manufacturer_data[company_id] = std::move(value);
+    set_data(new_data, {"ManufacturerData"});
+    return *this;
+}
+
+Advertisement &
+Advertisement::setServiceData(std::map<string, vector<u8>> service_data) {
+    auto new_data = getData();
+    new_data.service_data = std::move(service_data);
+    set_data(new_data, {"ServiceData"});
+    return *this;
+}
+
+Advertisement &Advertisement::setIncludes(vector<string> includes) {
+    auto new_data = getData();
+    new_data.includes = std::move(includes);
+    set_data(new_data, {"Includes"});
+    return *this;
+}
+
+Advertisement &Advertisement::setAppearance(std::optional<u16> appearance) {
+    auto new_data = getData();
+    new_data.appearance = appearance;
+    set_data(new_data, {"Appearance"});
+    return *this;
+}
+
+Advertisement &Advertisement::setType(const std::string &new_type) {
+    if (new_type != "peripheral" && new_type != "broadcast") {
+        throw std::invalid_argument("Advertisement type must be "
+                                    "\"peripheral\" or \"broadcast\", not " +
+                                    new_type);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_registered) {
+        throw std::logic_error("Type can't be changed while advertising");
+    }
+    type = new_type;
+    return *this;
+}
+
+Advertisement &
+Advertisement::setDiscoverable(std::optional<bool> discoverable) {
+    set_optional(is_discoverable, discoverable, "Discoverable");
+    return *this;
+}
+
+Advertisement &Advertisement::setTxPower(std::optional<i16> tx_power_dbm) {
+    set_optional(this->tx_power_dbm, tx_power_dbm, "TxPower");
+    return *this;
+}
+
+Advertisement &Advertisement::setDuration(std::optional<u16> duration_s) {
+    set_optional(this->duration_s, duration_s, "Duration");
+    return *this;
+}
+
+Advertisement &Advertisement::setTimeout(std::optional<u16> timeout_s) {
+    set_optional(this->timeout_s, timeout_s, "Timeout");
+    return *this;
+}
+
+Advertisement &Advertisement::setInterval(std::optional<u32> min_interval_ms,
+                                          std::optional<u32> max_interval_ms) {
+    if (min_interval_ms && max_interval_ms &&
+        *min_interval_ms > *max_interval_ms) {
+        throw std::invalid_argument(
+            "Minimum advertising interval is more than the maximum");
+    }
+
+    set_optional(this->min_interval_ms, min_interval_ms, "MinInterval");
+    set_optional(this->max_interval_ms, max_interval_ms, "MaxInterval");
+    return *this;
+}
+
+AdvertisingData Advertisement::getData() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return data;
+}
+
+size_t Advertisement::getPayloadBudget() const {
+    return getAdvertisingDataMaxSize(pdu);
+}
+
+bool Advertisement::isAdvertising() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return is_registered;
 }
 
 /**
@@ -178,5 +564,18 @@ void Advertisement::setAdvertisedName(const std::string &new_name) {
  *
  */
 Advertisement::~Advertisement() {
-    turnOffAdvertising();
+    if (isAdvertising()) {
+        try {
+            turnOffAdvertising().get();
+        } catch (sdbus::Error &e) {
+            std::cerr << "ERROR [UnregisterAdvertisement]: " << e.what()
+                      << endl;
+        }
+    }
+
+    /* First, they are declared before the fields getters and reply handlers
+     * use. Unexporting waits for a running getter, and destroying the proxy
+     * drops replies still pending */
+    ad.reset();
+    advertising_manager.reset();
 }
@@ -0,0 +1,375 @@
+/**
+ * @file advertisement_scheduler.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of AdvertisementScheduler
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "adapter.h"
+#include "advertisement_scheduler.h"
+
+using std::cerr, std::endl, std::string, std::vector;
+
+namespace {
+const auto ADVERTISING_MANAGER_IFACE = "org.bluez.LEAdvertisingManager1";
+
+/* Checked when added, so a set can't fail on air every slice */
+void check_fits(const AdvertisingData &data, AdvertisingPdu pdu) {
+    auto size_b = data.getPayloadSize();
+    if (size_b > getAdvertisingDataMaxSize(pdu)) {
+        throw std::length_error(
+            "Advertising set needs " + std::to_string(size_b) +
+            " bytes, only " + std::to_string(getAdvertisingDataMaxSize(pdu)) +
+            " fit in the advertising PDU");
+    }
+}
+} // namespace
+
+AdvertisementScheduler::AdvertisementScheduler(
+    BusContext &context, std::chrono::milliseconds time_slice_ms,
+    unsigned int max_instances, AdvertisingPdu pdu,
+    const string &object_path_prefix)
+    : context(context), time_slice_ms(time_slice_ms),
+      max_instances(max_instances), pdu(pdu),
+      object_path_prefix(object_path_prefix) {}
+
+AdvertisementScheduler::~AdvertisementScheduler() { stop(); }
+
+AdvertisementScheduler::SetId
+AdvertisementScheduler::addSet(AdvertisingData data) {
+    check_fits(data, pdu);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto set_id = next_set_id++;
+    sets[set_id].data = std::move(data);
+    return set_id;
+}
+
+void AdvertisementScheduler::updateSet(SetId set_id, AdvertisingData data) {
+    check_fits(data, pdu);
+
+    auto is_on_air = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &set = sets.at(set_id);
+        set.data = std::move(data);
+        ++set.version;
+        for (const auto &slot : slots) {
+            is_on_air |= slot.set_id == set_id;
+        }
+    }
+
+    if (is_on_air) {
+        schedule_apply();
+    }
+}
+
+void AdvertisementScheduler::removeSet(SetId set_id) {
+    auto is_on_air = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &slot : slots) {
+            if (slot.set_id == set_id) {
+                /* Off right away, so the removed data isn't advertised till
+                 * the next slice */
+                take_off_air(slot, Clock::now());
+                is_on_air = true;
+            }
+        }
+        sets.erase(set_id);
+    }
+
+    if (is_on_air) {
+        schedule_apply();
+    }
+}
+
+size_t AdvertisementScheduler::start() {
+    auto adapter_path = get_advertising_capable_adapter_path(context);
+    /* Instances left, not counting ones already registered (by anyone) */
+    auto available = context.createBluezProxy(adapter_path)
+                         ->getProperty("SupportedInstances")
+                         .onInterface(ADVERTISING_MANAGER_IFACE)
+                         .get<u8>();
+    auto instance_count = size_t(available);
+    if (max_instances) {
+        instance_count = std::min(instance_count, size_t(max_instances));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_running) {
+        return slots.size();
+    }
+    if (instance_count == 0) {
+        return 0;
+    }
+
+    /* Not touched by the timer thread while stopped, stop() waited for it */
+    slots.clear();
+    for (auto i = 0u; i < instance_count; ++i) {
+        auto slot = Slot();
+        slot.advertisement = std::make_unique<Advertisement>(
+            context, object_path_prefix + std::to_string(i), pdu);
+        slots.push_back(std::move(slot));
+    }
+    is_running = true;
+    tick_id = timer.scheduleAfter(std::chrono::milliseconds(0),
+                                  [this]() { rotate(); });
+    return instance_count;
+}
+
+void AdvertisementScheduler::stop() {
+    auto id = TimerQueue::TimerId();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_running) {
+            return;
+        }
+        is_running = false;
+        id = tick_id;
+    }
+
+    /* Not under our lock, it waits for a running rotate(), which takes it */
+    timer.cancel(id);
+
+    /* On the timer thread, after whatever it is doing, so nothing else
+     * touches the instances meanwhile, or after */
+    auto turn_off_all = [this]() {
+        auto advertisements = vector<Advertisement *>();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto now = Clock::now();
+            for (auto &slot : slots) {
+                take_off_air(slot, now);
+                slot.shown_set_id.reset();
+                advertisements.push_back(slot.advertisement.get());
+            }
+        }
+        for (auto *advertisement : advertisements) {
+            turn_off(*advertisement);
+        }
+    };
+    if (timer.isTimerThread()) {
+        turn_off_all();
+        return;
+    }
+    auto done = std::promise<void>();
+    timer.scheduleAfter(std::chrono::milliseconds(0), [&turn_off_all, &done]() {
+        turn_off_all();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+/* On the timer thread, picks the next sets, and puts them on air */
+void AdvertisementScheduler::rotate() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_running) {
+            return;
+        }
+
+        /* Sets for this slice, continuing in order of id, wrapping around */
+        auto chosen = std::set<SetId>();
+        auto count = std::min(slots.size(), sets.size());
+        auto next = sets.lower_bound(next_rotation_id);
+        while (chosen.size() < count) {
+            if (next == sets.end()) {
+                next = sets.begin();
+            }
+            chosen.insert(next->first);
+            ++next;
+        }
+        next_rotation_id = 0;
+        if (next != sets.end()) {
+            next_rotation_id = next->first;
+        }
+
+        /* A set chosen again stays on its instance, untouched */
+        auto now = Clock::now();
+        auto free_slots = vector<Slot *>();
+        for (auto &slot : slots) {
+            if (slot.set_id && chosen.erase(*slot.set_id)) {
+                continue;
+            }
+            take_off_air(slot, now);
+            free_slots.push_back(&slot);
+        }
+
+        /* Never more left than free, at most as many chosen as instances,
+         * instances left without a set are turned off */
+        auto free_slot = free_slots.begin();
+        for (auto set_id : chosen) {
+            (*free_slot)->set_id = set_id;
+            ++free_slot;
+        }
+    }
+
+    apply();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_running) {
+        tick_id = timer.scheduleAfter(time_slice_ms, [this]() { rotate(); });
+    }
+}
+
+void AdvertisementScheduler::schedule_apply() {
+    timer.scheduleAfter(std::chrono::milliseconds(0), [this]() { apply(); });
+}
+
+/* On the timer thread, gets every instance showing the set (and version) it
+ * should. The changes are worked out under the lock, and made without it, as
+ * they block for bluez replying */
+void AdvertisementScheduler::apply() {
+    auto changes = vector<Change>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_running) {
+            return;
+        }
+        for (auto &slot : slots) {
+            if (!slot.set_id) {
+                if (slot.shown_set_id ||
+                    slot.advertisement->isAdvertising()) {
+                    changes.push_back(Change{&slot, {}, 0, {}, false});
+                }
+                continue;
+            }
+            const auto &set = sets.at(*slot.set_id);
+            if (slot.shown_set_id != slot.set_id ||
+                slot.shown_version != set.version) {
+                changes.push_back(
+                    Change{&slot, slot.set_id, set.version, set.data, false});
+            }
+        }
+    }
+
+    for (auto &change : changes) {
+        auto &advertisement = *change.slot->advertisement;
+        if (!change.set_id) {
+            turn_off(advertisement);
+            continue;
+        }
+        change.is_shown = show(advertisement, change.data);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = Clock::now();
+    for (auto &change : changes) {
+        auto &slot = *change.slot;
+        if (!change.is_shown) {
+            /* Turned off, or failed and left off this slice */
+            slot.shown_set_id.reset();
+            if (change.set_id && slot.set_id == change.set_id) {
+                take_off_air(slot, now);
+            }
+            continue;
+        }
+        slot.shown_set_id = change.set_id;
+        slot.shown_version = change.version;
+
+        /* Still meant to be there, not moved or removed meanwhile */
+        auto set = sets.find(*change.set_id);
+        if (slot.set_id != change.set_id || set == sets.end()) {
+            continue;
+        }
+        if (!set->second.is_on_air) {
+            set->second.is_on_air = true;
+            set->second.on_air_since = now;
+        }
+    }
+}
+
+/* Blocks for bluez replying, on the timer thread, without the lock */
+bool AdvertisementScheduler::show(Advertisement &advertisement,
+                                  const AdvertisingData &data) {
+    try {
+        auto was_advertising = advertisement.isAdvertising();
+        if (was_advertising &&
+            data.appearance.has_value() !=
+                advertisement.getData().appearance.has_value()) {
+            advertisement.turnOffAdvertising().get();
+        }
+        advertisement.setData(data);
+        if (!advertisement.isAdvertising()) {
+            /* First slice, or bluez released it */
+            advertisement.turnOnAdvertising().get();
+        }
+    } catch (std::exception &e) {
+        cerr << "WARN: Advertising instance left off this slice: " << e.what()
+             << endl;
+        turn_off(advertisement);
+        return false;
+    }
+    return true;
+}
+
+/* Called with the lock held, only the accounting, the instance keeps
+ * advertising till apply() gives it other data or turns it off */
+void AdvertisementScheduler::take_off_air(Slot &slot, Clock::time_point now) {
+    if (!slot.set_id) {
+        return;
+    }
+
+    auto set = sets.find(*slot.set_id);
+    slot.set_id.reset();
+    if (set == sets.end() || !set->second.is_on_air) {
+        return;
+    }
+    set->second.air_time += now - set->second.on_air_since;
+    set->second.is_on_air = false;
+}
+
+/* Blocks for bluez replying, on the timer thread, without the lock */
+void AdvertisementScheduler::turn_off(Advertisement &advertisement) {
+    if (!advertisement.isAdvertising()) {
+        return;
+    }
+
+    try {
+        advertisement.turnOffAdvertising().get();
+    } catch (sdbus::Error &e) {
+        cerr << "ERROR [UnregisterAdvertisement]: " << e.what() << endl;
+    }
+}
+
+AdvertisementScheduler::Clock::duration
+AdvertisementScheduler::getAirTime(SetId set_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto &set = sets.at(set_id);
+    if (!set.is_on_air) {
+        return set.air_time;
+    }
+    return set.air_time + (Clock::now() - set.on_air_since);
+}
+
+std::map<AdvertisementScheduler::SetId, AdvertisementScheduler::Clock::duration>
+AdvertisementScheduler::getAirTimes() {
+    auto air_times = std::map<SetId, Clock::duration>();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = Clock::now();
+    for (const auto &set : sets) {
+        auto air_time = set.second.air_time;
+        if (set.second.is_on_air) {
+            air_time += now - set.second.on_air_since;
+        }
+        air_times[set.first] = air_time;
+    }
+    return air_times;
+}
+
+size_t AdvertisementScheduler::getInstanceCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
@@ -1,4 +1,6 @@
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <type_traits>
 
@@ -10,9 +12,9 @@
 
 using std::string;
 
-Application::Application(sdbus::IConnection &connection,
+Application::Application(BusContext &context,
                          const string &application_object_path)
-    : connection(connection) {
+    : context(context), connection(context.getConnection()) {
 
     application = sdbus::createObject(connection, application_object_path);
     application->addObjectManager();
@@ -29,30 +31,57 @@ sdbus::ObjectPath Application::getObjectPath() const {
     return application->getObjectPath();
 }
 
-void Application::registerWithGattManager(std::string adapter_path) const {
+namespace {
+const auto GATT_MANAGER_IFACE_NAME = "org.bluez.GattManager1";
+
+/* std::function needs a copyable callable, promise isn't */
+std::function<void(const sdbus::Error *)>
+set_promise_on_reply(std::shared_ptr<std::promise<void>> promise) {
+    return [promise](const sdbus::Error *error) {
+        if (error) {
+            promise->set_exception(std::make_exception_ptr(*error));
+        } else {
+            promise->set_value();
+        }
+    };
+}
+} // namespace
+
+std::future<void> Application::registerWithGattManager(string adapter_path) {
     if (adapter_path.empty()) {
-        adapter_path = get_advertising_capable_adapter_path();
+        adapter_path = get_advertising_capable_adapter_path(context);
     }
 
     /**
      * Similar to the case with registering advertisements
-     * Once we call RegisterApplication, we wait for bluez reply
-     * BUT, bluez called GetManagedObjects on us, and wait for our reply...
-     * but we are waiting... then who replies ?
-     * That's why we start the event loop in other thread, that will handle
+     * Once we call RegisterApplication, bluez calls GetManagedObjects on us,
+     * and only replies after we do. The context's event loop thread answers
+     * it, so nothing waits here, the caller waits on the future, if at all
      **/
-    connection.enterEventLoopAsync();
+    gatt_manager = context.createBluezProxy(adapter_path);
 
-    const auto GATT_MANAGER_IFACE_NAME = "org.bluez.GattManager1";
-    sdbus::createProxy(connection, "org.bluez", adapter_path)
-        ->callMethod("RegisterApplication")
+    auto promise = std::make_shared<std::promise<void>>();
+    gatt_manager->callMethodAsync("RegisterApplication")
         .onInterface(GATT_MANAGER_IFACE_NAME)
         .withArguments(sdbus::ObjectPath(application->getObjectPath()),
-                       std::map<std::string, sdbus::Variant>());
+                       std::map<std::string, sdbus::Variant>())
+        .uponReplyInvoke(set_promise_on_reply(promise));
+
+    return promise->get_future();
+}
+
+std::future<void> Application::unregisterFromGattManager() {
+    auto promise = std::make_shared<std::promise<void>>();
+    if (!gatt_manager) {
+        promise->set_exception(std::make_exception_ptr(sdbus::Error(
+            "org.bluez.Error.DoesNotExist", "Application not registered")));
+        return promise->get_future();
+    }
+
+    gatt_manager->callMethodAsync("UnregisterApplication")
+        .onInterface(GATT_MANAGER_IFACE_NAME)
+        .withArguments(sdbus::ObjectPath(application->getObjectPath()))
+        .uponReplyInvoke(set_promise_on_reply(promise));
 
-    /* TODO: @adig check if above function not returning early, if so we maybe
-     * stopping the event loop, and bluez will keep infinitly waiting for reply
-     */
-    /* Clean up, async event loop not needed by us */
-    connection.leaveEventLoop();
+    return promise->get_future();
 }
@@ -0,0 +1,324 @@
+/**
+ * @file bulk_transfer_client.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of BulkTransferClient
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "bulk_transfer_client.h"
+
+using std::string, std::vector;
+using namespace bulk_transfer;
+
+namespace {
+const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
+
+string find_characteristic(BluezObjectTree &tree, const string &service_path,
+                           const string &UUID) {
+    auto found = string();
+    tree.forEachObjectWithInterface(
+        CHARACTERISTIC_IFACE,
+        [&](const sdbus::ObjectPath &object_path,
+            const BluezObjectTree::Properties &properties) {
+            auto uuid = properties.find("UUID");
+            auto is_under = object_path.rfind(service_path + "/", 0) == 0;
+            if (found.empty() && is_under && uuid != properties.end() &&
+                uuid->second.get<string>() == UUID) {
+                found = object_path;
+            }
+        });
+
+    if (found.empty()) {
+        throw sdbus::Error("org.bluez.Error.DoesNotExist",
+                           "No characteristic " + UUID + " in " +
+                               service_path);
+    }
+    return found;
+}
+} // namespace
+
+BulkTransferClient::BulkTransferClient(sdbus::IConnection &connection,
+                                       string data_path, string control_path,
+                                       string destination,
+                                       BulkTransferConfig config)
+    : config(config),
+      control(std::make_unique<CharacteristicProxy>(connection, control_path,
+                                                    destination)),
+      data(std::make_unique<CharacteristicProxy>(connection, data_path,
+                                                 destination)),
+      timers(std::make_unique<TimerQueue>()) {}
+
+BulkTransferClient::BulkTransferClient(BusContext &context,
+                                       const string &service_path,
+                                       BulkTransferConfig config)
+    : BulkTransferClient(
+          context.getConnection(),
+          find_characteristic(context.getObjectTree(), service_path,
+                              DATA_UUID),
+          find_characteristic(context.getObjectTree(), service_path,
+                              CONTROL_UUID),
+          "org.bluez", config) {}
+
+std::future<vector<u8>> BulkTransferClient::download() {
+    auto info = control->ReadValue();
+    if (info.size() != INFO_B) {
+        throw sdbus::Error("org.bluez.Error.Failed",
+                           "Transfer info is not 8 bytes");
+    }
+    auto size_b = getU32(&info[0]);
+    auto crc = getU32(&info[4]);
+
+    /* Once, a proxy can subscribe only once, and notifications outside a
+     * download are dropped in on_chunk() */
+    auto is_first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_first = !is_subscribed;
+        is_subscribed = true;
+    }
+    if (is_first) {
+        data->subscribe([this](ByteView chunk) { on_chunk(chunk); },
+                        {{"mtu", sdbus::Variant(config.mtu_b)}});
+    }
+
+    auto new_chunk_b = std::max<u16>(config.chunk_b, 1);
+    const auto chunk_overhead_b = ATT_NOTIFICATION_HEADER_B + CHUNK_HEADER_B;
+    if (auto mtu_b = data->getNotifyMtu(); mtu_b > chunk_overhead_b) {
+        new_chunk_b = std::min<u16>(new_chunk_b, mtu_b - chunk_overhead_b);
+    }
+    auto window = std::max<u16>(config.window, 1);
+
+    auto new_promise = std::make_shared<std::promise<vector<u8>>>();
+    auto future = new_promise->get_future();
+    auto offset_b = size_t(0);
+    auto id = 0u;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (promise) {
+            throw sdbus::Error("org.bluez.Error.InProgress",
+                               "Already downloading");
+        }
+        /* Resume only what is still the same data */
+        if (!has_info || size_b != expected_size_b || crc != expected_crc) {
+            received.clear();
+            received_crc = Crc32();
+        }
+        has_info = true;
+        expected_size_b = size_b;
+        expected_crc = crc;
+        received.reserve(size_b);
+
+        promise = new_promise;
+        chunk_b = new_chunk_b;
+        offset_b = acked_offset_b = resend_offset_b = received.size();
+        transferred_b = 0;
+        started_at = finished_at = std::chrono::steady_clock::now();
+        id = ++download_id;
+        last_chunk_at = started_at;
+        resend_count = 0;
+    }
+
+    if (offset_b == size_b) {
+        complete();
+        return future;
+    }
+
+    try {
+        control->WriteValue(makeStart(u32(offset_b), window, new_chunk_b));
+    } catch (const sdbus::Error &error) {
+        fail(error);
+        return future;
+    }
+
+    timers->scheduleAfter(config.stall_timeout_ms,
+                          [this, id]() { check_stall(id); });
+    return future;
+}
+
+/* A lost chunk is noticed by the next one, but if the last ones are lost,
+ * none comes, the service waits for an ACK, and we for the chunks. So if
+ * nothing arrived for a while, ask for the rest again */
+void BulkTransferClient::check_stall(unsigned int id) {
+    auto message = vector<u8>();
+    auto next_check = config.stall_timeout_ms;
+    auto is_stalled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        /* Done, or another download started meanwhile */
+        if (!promise || id != download_id) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto idle = now - last_chunk_at;
+        if (idle < config.stall_timeout_ms) {
+            next_check = std::chrono::duration_cast<std::chrono::milliseconds>(
+                config.stall_timeout_ms - idle);
+        } else if (resend_count < config.max_resends) {
+            ++resend_count;
+            last_chunk_at = now;
+            resend_offset_b = received.size();
+            message = makeStart(u32(received.size()),
+                                std::max<u16>(config.window, 1), chunk_b);
+        } else {
+            is_stalled = true;
+        }
+    }
+
+    if (is_stalled) {
+        fail(sdbus::Error("org.bluez.Error.Failed",
+                          "No data after " +
+                              std::to_string(config.max_resends) +
+                              " requests to resend"));
+        return;
+    }
+    if (!message.empty()) {
+        control->WriteValueAsync(std::move(message),
+                                 [this](const sdbus::Error *error) {
+                                     on_write_reply(error);
+                                 });
+    }
+    timers->scheduleAfter(next_check, [this, id]() { check_stall(id); });
+}
+
+/* On the socket poller, or event loop, thread, chunks arrive in order */
+void BulkTransferClient::on_chunk(ByteView chunk) {
+    if (chunk.size() < CHUNK_HEADER_B) {
+        return;
+    }
+    auto offset_b = size_t(getU32(chunk.data()));
+    auto payload = chunk.subview(CHUNK_HEADER_B);
+
+    auto message = vector<u8>();
+    auto is_done = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!promise) {
+            return;
+        }
+
+        if (offset_b != received.size()) {
+            /* Behind is a duplicate, from before a restart. Ahead, one was
+             * lost, ask once to resend from it */
+            if (offset_b < received.size() ||
+                resend_offset_b == received.size()) {
+                return;
+            }
+            resend_offset_b = received.size();
+            message = makeStart(u32(received.size()),
+                                std::max<u16>(config.window, 1), chunk_b);
+        } else {
+            auto size_b =
+                std::min(payload.size(), expected_size_b - received.size());
+            payload = payload.subview(0, size_b);
+            received.insert(received.end(), payload.begin(), payload.end());
+            received_crc.update(payload);
+            transferred_b += size_b;
+            last_chunk_at = std::chrono::steady_clock::now();
+            resend_count = 0;
+
+            auto ack_every_b =
+                size_t(std::max(config.window / 2, 1)) * chunk_b;
+            is_done = received.size() == expected_size_b;
+            if (is_done || received.size() - acked_offset_b >= ack_every_b) {
+                acked_offset_b = received.size();
+                message = makeAck(u32(acked_offset_b));
+            }
+        }
+    }
+
+    /* Not waited for, the window keeps the service sending meanwhile */
+    if (!message.empty()) {
+        control->WriteValueAsync(std::move(message),
+                                 [this](const sdbus::Error *error) {
+                                     on_write_reply(error);
+                                 });
+    }
+    if (is_done) {
+        complete();
+    }
+}
+
+void BulkTransferClient::on_write_reply(const sdbus::Error *error) {
+    if (error) {
+        fail(*error);
+    }
+}
+
+void BulkTransferClient::complete() {
+    auto done = std::shared_ptr<std::promise<vector<u8>>>();
+    auto value = vector<u8>();
+    auto is_valid = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = std::move(promise);
+        if (!done) {
+            return;
+        }
+        finished_at = std::chrono::steady_clock::now();
+        is_valid = received_crc.get() == expected_crc;
+        /* Either way, the next download starts over */
+        value = std::move(received);
+        received.clear();
+        received_crc = Crc32();
+        has_info = false;
+    }
+
+    if (is_valid) {
+        done->set_value(std::move(value));
+    } else {
+        done->set_exception(std::make_exception_ptr(
+            sdbus::Error("org.bluez.Error.Failed", "CRC mismatch")));
+    }
+}
+
+void BulkTransferClient::fail(const sdbus::Error &error) {
+    auto failed = std::shared_ptr<std::promise<vector<u8>>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = std::move(promise);
+        if (!failed) {
+            return;
+        }
+        finished_at = std::chrono::steady_clock::now();
+    }
+    failed->set_exception(std::make_exception_ptr(error));
+}
+
+void BulkTransferClient::cancel() {
+    auto has_download = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        has_download = bool(promise);
+    }
+    if (!has_download) {
+        return;
+    }
+
+    fail(sdbus::Error("org.bluez.Error.Failed", "Download cancelled"));
+    /* Best effort, the device may well be gone */
+    control->WriteValueAsync({STOP}, [](const sdbus::Error *) {});
+}
+
+BulkTransferStats BulkTransferClient::getStats() const {
+    auto stats = BulkTransferStats();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (started_at == std::chrono::steady_clock::time_point()) {
+        return stats;
+    }
+    stats.transferred_b = transferred_b;
+    auto ended_at = finished_at;
+    if (promise) {
+        ended_at = std::chrono::steady_clock::now();
+    }
+    stats.elapsed = ended_at - started_at;
+    return stats;
+}
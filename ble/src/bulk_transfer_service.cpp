@@ -0,0 +1,216 @@
+/**
+ * @file bulk_transfer_service.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of BulkTransferService
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "bulk_transfer_service.h"
+#include "crc32.h"
+
+using std::string, std::vector;
+using namespace bulk_transfer;
+
+namespace {
+/* A chunk is one notification, which can't be longer than an attribute */
+const size_t MAX_CHUNK_B = MAX_ATTRIBUTE_VALUE_B - CHUNK_HEADER_B;
+} // namespace
+
+BulkTransferService::DataCharacteristic::DataCharacteristic(
+    sdbus::IConnection &connection, string service_path, unsigned int index,
+    string UUID)
+    : Characteristic(connection, service_path, index, UUID, {"notify"}) {}
+
+vector<u8> BulkTransferService::DataCharacteristic::ReadValue(
+    std::map<string, sdbus::Variant> options) const {
+    return {};
+}
+
+/* Not writable, flags have no "write" */
+void BulkTransferService::DataCharacteristic::WriteValue(
+    vector<u8> value, std::map<string, sdbus::Variant> options) {
+    throw sdbus::Error("org.bluez.Error.NotSupported",
+                       "Data characteristic is not writable");
+}
+
+BulkTransferService::ControlCharacteristic::ControlCharacteristic(
+    sdbus::IConnection &connection, string service_path, unsigned int index,
+    string UUID, BulkTransferService *service)
+    : Characteristic(connection, service_path, index, UUID, {"read", "write"}),
+      service(*service) {}
+
+vector<u8> BulkTransferService::ControlCharacteristic::ReadValue(
+    std::map<string, sdbus::Variant> options) const {
+    return service.get_info();
+}
+
+void BulkTransferService::ControlCharacteristic::WriteValue(
+    ByteView value, const GattOptions &options) {
+    service.on_control(value);
+}
+
+void BulkTransferService::ControlCharacteristic::WriteValue(
+    vector<u8> value, std::map<string, sdbus::Variant> options) {
+    service.on_control(ByteView(value));
+}
+
+BulkTransferService::BulkTransferService(sdbus::IConnection &connection,
+                                         string application_path,
+                                         unsigned int index, string UUID)
+    : Service(connection, application_path, index, UUID),
+      data(std::make_shared<const vector<u8>>()), data_crc(Crc32().get()) {
+    data_characteristic =
+        &addCharacteristic<DataCharacteristic>(0, DATA_UUID);
+    control_characteristic =
+        &addCharacteristic<ControlCharacteristic>(1, CONTROL_UUID, this);
+}
+
+void BulkTransferService::setData(vector<u8> new_data) {
+    auto crc = Crc32::compute(new_data);
+    auto shared = std::make_shared<const vector<u8>>(std::move(new_data));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    data = std::move(shared);
+    data_crc = crc;
+}
+
+vector<u8> BulkTransferService::get_info() const {
+    auto info = vector<u8>(INFO_B);
+    std::lock_guard<std::mutex> lock(mutex);
+    putU32(&info[0], u32(data->size()));
+    putU32(&info[4], data_crc);
+    return info;
+}
+
+/* On the event loop thread, so one message at a time */
+void BulkTransferService::on_control(ByteView message) {
+    if (message.empty()) {
+        throw sdbus::Error("org.bluez.Error.InvalidValueLength",
+                           "Empty control message");
+    }
+
+    switch (message[0]) {
+    case START: {
+        if (message.size() != START_B) {
+            throw sdbus::Error("org.bluez.Error.InvalidValueLength",
+                               "START is 9 bytes");
+        }
+        auto offset_b = getU32(&message.data()[1]);
+        auto new_window = getU16(&message.data()[5]);
+        auto new_chunk_b = getU16(&message.data()[7]);
+        if (new_window == 0 || new_chunk_b == 0 || new_chunk_b > MAX_CHUNK_B) {
+            throw sdbus::Error("org.bluez.Error.InvalidArguments",
+                               "Window and chunk size must be 1 to 508");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (offset_b > data->size()) {
+                throw sdbus::Error("org.bluez.Error.InvalidOffset",
+                                   "Offset is past the end of the data");
+            }
+            sending = data;
+            next_offset_b = acked_offset_b = start_offset_b = offset_b;
+            window = new_window;
+            chunk_b = new_chunk_b;
+            started_at = std::chrono::steady_clock::now();
+            is_finished = offset_b == sending->size();
+            finished_at = started_at;
+        }
+
+        /* At most a window is unacknowledged, so none is ever dropped */
+        data_characteristic->setNotifyPolicy(
+            {NotifyPolicy::Mode::QUEUE, std::chrono::milliseconds(0),
+             new_window});
+        break;
+    }
+    case ACK: {
+        if (message.size() != ACK_B) {
+            throw sdbus::Error("org.bluez.Error.InvalidValueLength",
+                               "ACK is 5 bytes");
+        }
+        auto offset_b = getU32(&message.data()[1]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        /* Stale, from before a restart */
+        if (!sending || offset_b < acked_offset_b || offset_b > next_offset_b) {
+            return;
+        }
+        acked_offset_b = offset_b;
+        if (acked_offset_b == sending->size() && !is_finished) {
+            is_finished = true;
+            finished_at = std::chrono::steady_clock::now();
+        }
+        break;
+    }
+    case STOP: {
+        std::lock_guard<std::mutex> lock(mutex);
+        sending.reset();
+        return;
+    }
+    default:
+        throw sdbus::Error("org.bluez.Error.NotSupported",
+                           "Unknown control opcode");
+    }
+
+    pump();
+}
+
+/* Notify chunks till a window is unacknowledged */
+void BulkTransferService::pump() {
+    auto chunks = vector<vector<u8>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!sending) {
+            return;
+        }
+
+        auto window_end_b = acked_offset_b + size_t(window) * chunk_b;
+        while (next_offset_b < sending->size() &&
+               next_offset_b < window_end_b) {
+            auto size_b =
+                std::min(size_t(chunk_b), sending->size() - next_offset_b);
+            auto chunk = vector<u8>(CHUNK_HEADER_B + size_b);
+            putU32(chunk.data(), u32(next_offset_b));
+            auto begin = sending->begin() + next_offset_b;
+            std::copy(begin, begin + size_b, chunk.begin() + CHUNK_HEADER_B);
+            chunks.push_back(std::move(chunk));
+            next_offset_b += size_b;
+        }
+    }
+
+    /* Doesn't block, sent in order by NotificationEngine */
+    for (auto &chunk : chunks) {
+        data_characteristic->notify(std::move(chunk));
+    }
+}
+
+BulkTransferStats BulkTransferService::getStats() const {
+    auto stats = BulkTransferStats();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (started_at == std::chrono::steady_clock::time_point()) {
+        return stats;
+    }
+    stats.transferred_b = acked_offset_b - start_offset_b;
+    auto ended_at = finished_at;
+    if (!is_finished) {
+        ended_at = std::chrono::steady_clock::now();
+    }
+    stats.elapsed = ended_at - started_at;
+    return stats;
+}
+
+string BulkTransferService::getDataPath() const {
+    return data_characteristic->getObjectPath();
+}
+
+string BulkTransferService::getControlPath() const {
+    return control_characteristic->getObjectPath();
+}
@@ -3,29 +3,26 @@
 /**
  * @brief Get the Available BLE Peripheral addresses
  *
- * @return vector<string> Array of bluetooth device addresses
+ * @param context Bus context to use, by default the shared system bus one
+ *
+ * @return vector<BdAddr> Array of bluetooth device addresses
  */
-vector<string> getAvailableBLEPeripherals() {
+vector<BdAddr> getAvailableBLEPeripherals(BusContext &context) {
     /* TODO- This may return non-ble devices with ObjectManager, despite
      * starting the scan for LE transport only, handle it
      */
-    auto result =
-        std::map<sdbus::ObjectPath,
-                 std::map<string, std::map<string, sdbus::Variant>>>();
-    auto adapter = sdbus::createProxy("org.bluez", "/");
-    adapter->callMethod("GetManagedObjects")
-        .onInterface("org.freedesktop.DBus.ObjectManager")
-        .storeResultsTo(result);
-
-    vector<string> addresses;
-    for (auto &p : result) {
-        if (p.first.find("/org/bluez/hci0/dev_") == 0 &&
-            p.first.length() ==
-                sizeof("/org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX") - 1) {
-            addresses.push_back(
-                p.second["org.bluez.Device1"]["Address"].get<string>());
-        }
-    }
+    vector<BdAddr> addresses;
+    context.getObjectTree().forEachObjectWithInterface(
+        "org.bluez.Device1",
+        [&addresses](const sdbus::ObjectPath &object_path,
+                     const BluezObjectTree::Properties &) {
+            /* Address is in the path itself, no need to read the property */
+            auto address =
+                BdAddr::fromObjectPath(object_path, "/org/bluez/hci0");
+            if (address) {
+                addresses.push_back(*address);
+            }
+        });
 
     return addresses;
 }
@@ -39,13 +36,15 @@ vector<string> getAvailableBLEPeripherals() {
  * handler if needed) before calling getAvailableBLEPeripherals(), since new
  * devices may not be detected by bluez as soon as scanning started
  *
+ * @param context Bus context to use, by default the shared system bus one
+ *
  * @return true if successful in turning scan on
  * @return false if could not turn on scanning
  */
-bool startScanningForBLEDevices() {
-    auto adapter_path = get_advertising_capable_adapter_path();
+bool startScanningForBLEDevices(BusContext &context) {
+    auto adapter_path = get_advertising_capable_adapter_path(context);
 
-    auto adapter = sdbus::createProxy("org.bluez", adapter_path);
+    auto adapter = context.createBluezProxy(adapter_path);
 
     const auto ADAPTER_INTERFACE = "org.bluez.Adapter1";
     try {
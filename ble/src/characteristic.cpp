@@ -10,9 +10,16 @@
  *
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <limits>
 #include <regex>
 #include <string>
+#include <sys/socket.h>
+#include <utility>
 #include <vector>
 
 #include "characteristic.h"
@@ -21,6 +28,80 @@
 
 using std::vector, std::string, std::cerr, std::endl;
 
+namespace {
+const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
+
+/* Minimum ATT MTU, used if bluez doesn't pass "mtu" in options */
+const u16 DEFAULT_ATT_MTU_B = 23;
+/* Opcode byte of ATT Read/Read Blob response, rest of the MTU is value */
+const u16 ATT_READ_RESPONSE_HEADER_B = 1;
+/* Longest attribute value ATT allows */
+const size_t MAX_ATTRIBUTE_VALUE_B = 512;
+
+/* The variant the message is at, into `value` if it holds `signature`, else
+ * skipped, like an option we don't know */
+template <typename T>
+void read_variant(sdbus::Message &msg, const char *signature, T &value) {
+    /* Both fit in the strings' own storage, no allocation */
+    auto type = string();
+    auto contents = string();
+    msg.peekType(type, contents);
+    if (contents != signature) {
+        auto skipped = sdbus::Variant();
+        msg >> skipped;
+        return;
+    }
+    msg.enterVariant(signature);
+    msg >> value;
+    msg.exitVariant();
+}
+
+/* Reads the a{sv} of options at the message's position, without making the
+ * map (a node, a key and a variant per option) */
+GattOptions decode_options(sdbus::Message &msg) {
+    auto options = GattOptions();
+    if (!msg.enterContainer("{sv}")) {
+        msg.clearFlags();
+        return options;
+    }
+    auto key = string();
+    while (msg.enterDictEntry("sv")) {
+        msg >> key;
+        if (key == "device") {
+            auto device = sdbus::ObjectPath();
+            read_variant(msg, "o", device);
+            options.device = std::move(device);
+        } else if (key == "offset") {
+            read_variant(msg, "q", options.offset_b);
+        } else if (key == "mtu") {
+            auto mtu_b = u16(0);
+            read_variant(msg, "q", mtu_b);
+            if (mtu_b != 0) {
+                options.mtu_b = mtu_b;
+            }
+        } else if (key == "link") {
+            read_variant(msg, "s", options.link);
+        } else if (key == "type") {
+            read_variant(msg, "s", options.type);
+        } else if (key == "prepare-authorize") {
+            read_variant(msg, "b", options.is_prepare_authorize);
+        } else {
+            auto skipped = sdbus::Variant();
+            msg >> skipped;
+        }
+        msg.exitDictEntry();
+    }
+    /* Failing to enter another entry is how the end is found */
+    msg.clearFlags();
+    msg.exitContainer();
+    return options;
+}
+
+bool has_flag(const vector<string> &flags, const string &flag) {
+    return std::find(flags.begin(), flags.end(), flag) != flags.end();
+}
+} // namespace
+
 Characteristic::Characteristic(sdbus::IConnection &connection,
                                string service_object_path, unsigned int index,
                                string UUID, vector<string> flags) {
@@ -38,35 +119,50 @@ Characteristic::Characteristic(sdbus::IConnection &connection,
 
     auto path = service_object_path + "/char" + std::to_string(index);
 
-    const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
     characteristic = sdbus::createObject(connection, path);
 
     /*Methods according to bluez/docs/gatt-api.txt*/
-    characteristic->registerMethod("ReadValue")
-        .onInterface(CHARACTERISTIC_IFACE)
-        .withInputParamNames("options")
-        .withOutputParamNames("value")
-        .implementedAs([this](std::map<string, sdbus::Variant> options) {
-            return this->ReadValue(options);
+    /* Methods taking options handle the message themselves, the typed
+     * handlers would copy the value out of the reply, and into the
+     * arguments, and build a map of the options */
+    characteristic->registerMethod(
+        CHARACTERISTIC_IFACE, "ReadValue", "a{sv}", "ay",
+        [this](sdbus::MethodCall call) {
+            auto options = decode_options(call);
+            auto reply = call.createReply();
+            read_chunk(options, reply);
+            reply.send();
         });
 
-    characteristic->registerMethod("WriteValue")
-        .onInterface(CHARACTERISTIC_IFACE)
-        .withInputParamNames("value", "options")
-        .implementedAs(
-            [this](vector<u8> value, std::map<string, sdbus::Variant> options) {
-                return this->WriteValue(value, options);
-            })
-        .withNoReply();
+    auto no_reply = sdbus::Flags();
+    no_reply.set(sdbus::Flags::METHOD_NO_REPLY);
+    characteristic->registerMethod(
+        CHARACTERISTIC_IFACE, "WriteValue", "aya{sv}", "",
+        [this](sdbus::MethodCall call) {
+            /* The one copy, from the message into a pooled vector, that
+             * keeps its capacity, the handler gets a view of it */
+            auto value = ValueBufferPool::getDefault().acquire();
+            call >> *value;
+            auto options = decode_options(call);
+            write_value(ByteView(*value), options);
+            call.createReply().send();
+        },
+        no_reply);
 
     characteristic->registerMethod("StartNotify")
         .onInterface(CHARACTERISTIC_IFACE)
-        .implementedAs([this]() { return this->StartNotify(); })
+        .implementedAs([this]() {
+            set_notifying(true);
+            return this->StartNotify();
+        })
         .withNoReply();
 
     characteristic->registerMethod("StopNotify")
         .onInterface(CHARACTERISTIC_IFACE)
-        .implementedAs([this]() { return this->StopNotify(); })
+        .implementedAs([this]() {
+            set_notifying(false);
+            return this->StopNotify();
+        })
         .withNoReply();
 
     /*Properties according to bluez/docs/gatt-api.txt*/
@@ -87,7 +183,52 @@ Characteristic::Characteristic(sdbus::IConnection &connection,
             return std::vector<sdbus::ObjectPath>();
         });
 
-    /* Ignoring 'optional' properties such as `WriteAcquired` etc. */
+    characteristic->registerProperty("Value")
+        .onInterface(CHARACTERISTIC_IFACE)
+        .withGetter([this]() {
+            std::lock_guard<std::mutex> lock(notify_mutex);
+            return value;
+        });
+
+    has_notifying_property =
+        has_flag(flags, "notify") || has_flag(flags, "indicate");
+    if (has_notifying_property) {
+        characteristic->registerProperty("Notifying")
+            .onInterface(CHARACTERISTIC_IFACE)
+            .withGetter([this]() { return isNotifying(); });
+    }
+
+    if (has_flag(flags, "write-without-response")) {
+        characteristic->registerMethod(
+            CHARACTERISTIC_IFACE, "AcquireWrite", "a{sv}", "hq",
+            [this](sdbus::MethodCall call) {
+                auto [fd, mtu_b] = acquire_link(write_link, "WriteAcquired",
+                                                decode_options(call));
+                auto reply = call.createReply();
+                reply << fd << mtu_b;
+                reply.send();
+            });
+
+        characteristic->registerProperty("WriteAcquired")
+            .onInterface(CHARACTERISTIC_IFACE)
+            .withGetter([this]() { return isWriteAcquired(); });
+    }
+
+    if (has_flag(flags, "notify")) {
+        characteristic->registerMethod(
+            CHARACTERISTIC_IFACE, "AcquireNotify", "a{sv}", "hq",
+            [this](sdbus::MethodCall call) {
+                auto [fd, mtu_b] = acquire_link(notify_link, "NotifyAcquired",
+                                                decode_options(call));
+                auto reply = call.createReply();
+                reply << fd << mtu_b;
+                reply.send();
+            });
+
+        characteristic->registerProperty("NotifyAcquired")
+            .onInterface(CHARACTERISTIC_IFACE)
+            .withGetter([this]() { return isNotifyAcquired(); });
+    }
 
     characteristic->registerProperty("Flags")
         .onInterface(CHARACTERISTIC_IFACE)
@@ -101,20 +242,271 @@ Characteristic::Characteristic(sdbus::IConnection &connection,
 #endif
 }
 
+Characteristic::~Characteristic() { stop(); }
+
+void Characteristic::stop() {
+    NotificationEngine::getInstance().remove(this);
+
+    auto links = std::vector<std::shared_ptr<FdLink>>();
+    {
+        /* Not closed under the lock, as a running close callback takes it */
+        std::lock_guard<std::mutex> lock(acquired_mutex);
+        is_stopped = true;
+        links = {std::move(write_link), std::move(notify_link)};
+    }
+
+    /* Waits for a WriteValue running on the poller thread */
+    for (auto &link : links) {
+        if (link) {
+            link->close();
+        }
+    }
+}
+
+/* The first chunk (offset 0) reads the value, and keeps it for the device if
+ * it doesn't fit in one response, till the last chunk is served, or the
+ * device starts another read. Without "device" nothing is kept, callers
+ * can't be told apart */
+void Characteristic::read_chunk(const GattOptions &read_options,
+                                sdbus::MethodReply &reply) {
+    /* Without "mtu" (older bluez), the rest of the value is returned, bluez
+     * cuts the response to MTU - 1 itself, and the next offset is read anew */
+    auto max_chunk_b = std::numeric_limits<size_t>::max();
+    if (read_options.mtu_b &&
+        *read_options.mtu_b > ATT_READ_RESPONSE_HEADER_B) {
+        max_chunk_b = *read_options.mtu_b - ATT_READ_RESPONSE_HEADER_B;
+    }
+
+    auto snapshot = std::optional<ValueBuffer>();
+    if (read_options.offset_b != 0 && !read_options.device.empty()) {
+        std::lock_guard<std::mutex> lock(read_mutex);
+        auto found = read_snapshots.find(read_options.device);
+        if (found != read_snapshots.end()) {
+            snapshot = found->second;
+        }
+    }
+
+    if (!snapshot) {
+        snapshot = ReadValueBuffer(read_options);
+        /* Common case, fits in one response, serialized as is */
+        if (read_options.offset_b == 0 && snapshot->size() < max_chunk_b) {
+            reply << snapshot->get();
+            return;
+        }
+    }
+
+    if (read_options.offset_b > snapshot->size()) {
+        std::lock_guard<std::mutex> lock(read_mutex);
+        read_snapshots.erase(read_options.device);
+        throw sdbus::Error("org.bluez.Error.InvalidOffset",
+                           "Offset is past the end of the value");
+    }
+
+    auto chunk_b =
+        std::min(snapshot->size() - read_options.offset_b, max_chunk_b);
+    /* A full chunk is followed by another read, even if it ended exactly at
+     * the end of the value, the client can't tell */
+    auto is_last = chunk_b < max_chunk_b;
+    {
+        std::lock_guard<std::mutex> lock(read_mutex);
+        if (!is_last && !read_options.device.empty()) {
+            read_snapshots[read_options.device] = *snapshot;
+        } else if (read_options.offset_b != 0) {
+            read_snapshots.erase(read_options.device);
+        }
+    }
+
+    /* sdbus serializes only vectors, the chunk's one is pooled */
+    auto chunk_begin = snapshot->data() + read_options.offset_b;
+    auto chunk = ValueBufferPool::getDefault().acquire();
+    chunk->assign(chunk_begin, chunk_begin + chunk_b);
+    reply << *chunk;
+}
+
+/* bluez joins the Prepare Writes of one Execute Write into one call, at
+ * their first offset. A call at an offset (a Write Request at one, or a
+ * later Execute Write) patches the value the device wrote last, and the
+ * handler gets the whole value, at offset 0 */
+void Characteristic::write_value(ByteView value,
+                                 const GattOptions &write_options) {
+    if (write_options.is_prepare_authorize) {
+        /* Only asks if the prepared write may be queued, the value comes
+         * again on execute */
+        return;
+    }
+    if (write_options.device.empty()) {
+        if (write_options.offset_b != 0) {
+            throw sdbus::Error("org.bluez.Error.InvalidOffset",
+                               "Write at an offset without \"device\"");
+        }
+        WriteValue(value, write_options);
+        return;
+    }
+    if (write_options.offset_b + value.size() > MAX_ATTRIBUTE_VALUE_B) {
+        throw sdbus::Error("org.bluez.Error.InvalidValueLength",
+                           "Value is longer than 512 bytes");
+    }
+
+    auto whole = ValueBufferPool::getDefault().acquire();
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        if (write_options.offset_b != 0) {
+            auto last = written_values.find(write_options.device);
+            if (last == written_values.end() ||
+                write_options.offset_b > last->second->size()) {
+                throw sdbus::Error("org.bluez.Error.InvalidOffset",
+                                   "Offset is past the end of the value");
+            }
+            whole->assign(last->second->begin(),
+                          last->second->begin() + write_options.offset_b);
+        }
+        whole->insert(whole->end(), value.begin(), value.end());
+        written_values[write_options.device] = whole;
+    }
+
+    if (write_options.offset_b == 0) {
+        WriteValue(ByteView(*whole), write_options);
+        return;
+    }
+    auto whole_options = write_options;
+    whole_options.offset_b = 0;
+    WriteValue(ByteView(*whole), whole_options);
+}
+
+ValueBuffer Characteristic::ReadValueBuffer(const GattOptions &options) const {
+    return ValueBuffer(ReadValue(options.toMap()));
+}
+
+void Characteristic::WriteValue(ByteView value, const GattOptions &options) {
+    WriteValue(value.toVector(), options.toMap());
+}
+
+std::map<string, sdbus::Variant> GattOptions::toMap() const {
+    auto options = std::map<string, sdbus::Variant>();
+    if (!device.empty()) {
+        options["device"] = sdbus::ObjectPath(device);
+    }
+    if (offset_b != 0) {
+        options["offset"] = offset_b;
+    }
+    if (mtu_b) {
+        options["mtu"] = *mtu_b;
+    }
+    if (!link.empty()) {
+        options["link"] = link;
+    }
+    if (!type.empty()) {
+        options["type"] = type;
+    }
+    if (is_prepare_authorize) {
+        options["prepare-authorize"] = is_prepare_authorize;
+    }
+    return options;
+}
+
 std::string Characteristic::getObjectPath() const {
     return characteristic->getObjectPath();
 }
 
+std::tuple<sdbus::UnixFd, u16>
+Characteristic::acquire_link(std::shared_ptr<FdLink> &link,
+                             const char *property_name,
+                             const GattOptions &options) {
+    auto mtu_b = options.mtu_b.value_or(DEFAULT_ATT_MTU_B);
+
+    auto remote_fd = sdbus::UnixFd();
+    {
+        std::lock_guard<std::mutex> lock(acquired_mutex);
+        if (is_stopped) {
+            throw sdbus::Error("org.bluez.Error.NotPermitted",
+                               "Characteristic is stopped");
+        }
+        if (link && link->isOpen()) {
+            throw sdbus::Error("org.bluez.Error.NotPermitted",
+                               string(property_name) + " already");
+        }
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       0, fds) == -1) {
+            throw sdbus::Error("org.bluez.Error.Failed",
+                               string("socketpair: ") + std::strerror(errno));
+        }
+
+        auto on_read = FdLink::ReadCallback();
+        if (&link == &write_link) {
+            /* Every write on the socket is a Write Command from the device
+             * that acquired it */
+            auto write_options = options;
+            write_options.type = "command";
+            on_read = [this, write_options](const u8 *data, size_t size_b) {
+                WriteValue(ByteView(data, size_b), write_options);
+            };
+        }
+
+        /* bluez closes its end when the remote unsubscribes or disconnects */
+        auto fd = fds[0];
+        link = FdLink::open(fd, mtu_b, std::move(on_read),
+                            [this, &link, property_name, fd]() {
+                                release_link(link, property_name, fd);
+                            });
+
+        /* Our end is polled by FdLink, the other end goes to bluez */
+        remote_fd = sdbus::UnixFd(fds[1], sdbus::adopt_fd);
+    }
+
+    /* Outside the lock, as emitting calls the getter */
+    characteristic->emitPropertiesChangedSignal(CHARACTERISTIC_IFACE,
+                                                {property_name});
+    return {std::move(remote_fd), mtu_b};
+}
+
+void Characteristic::release_link(std::shared_ptr<FdLink> &link,
+                                  const char *property_name, int fd) {
+    {
+        std::lock_guard<std::mutex> lock(acquired_mutex);
+        /* Might have been acquired again already */
+        if (!link || link->getFd() != fd) {
+            return;
+        }
+        link.reset();
+    }
+
+    characteristic->emitPropertiesChangedSignal(CHARACTERISTIC_IFACE,
+                                                {property_name});
+}
+
+bool Characteristic::sendAcquiredNotification(const vector<u8> &value) {
+    auto link = std::shared_ptr<FdLink>();
+    {
+        std::lock_guard<std::mutex> lock(acquired_mutex);
+        link = notify_link;
+    }
+
+    return link && link->send(value.data(), value.size());
+}
+
+bool Characteristic::isWriteAcquired() const {
+    std::lock_guard<std::mutex> lock(acquired_mutex);
+    return write_link && write_link->isOpen();
+}
+
+bool Characteristic::isNotifyAcquired() const {
+    std::lock_guard<std::mutex> lock(acquired_mutex);
+    return notify_link && notify_link->isOpen();
+}
+
 CharacteristicProxy::CharacteristicProxy(sdbus::IConnection &connection,
-                                         std::string path)
-    : _proxy(sdbus::createProxy(connection, "org.bluez", path)) {}
+                                         std::string path,
+                                         std::string destination)
+    : _proxy(sdbus::createProxy(connection, std::move(destination),
+                                std::move(path))) {}
 
 /* ReadValue and WriteValue functions provided by the characteristic */
 std::vector<u8> CharacteristicProxy::ReadValue(
     std::map<std::string, sdbus::Variant> options) const {
     // TODO: Verify this destination will surely be having this characteristic
     auto result = vector<u8>();
-    const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
     this->_proxy->callMethod("ReadValue")
         .onInterface(CHARACTERISTIC_IFACE)
         .withArguments(options)
@@ -126,12 +518,221 @@ std::vector<u8> CharacteristicProxy::ReadValue(
 void CharacteristicProxy::WriteValue(
     std::vector<u8> value, std::map<std::string, sdbus::Variant> options) {
     // TODO: Verify this destination will surely be having this characteristic
-    const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
-    this->_proxy->callMethod("ReadValue")
+    this->_proxy->callMethod("WriteValue")
         .onInterface(CHARACTERISTIC_IFACE)
         .withArguments(value, options);
 }
 
+void CharacteristicProxy::ReadValueAsync(
+    ReadCallback callback,
+    std::map<std::string, sdbus::Variant> options) const {
+    this->_proxy->callMethodAsync("ReadValue")
+        .onInterface(CHARACTERISTIC_IFACE)
+        .withArguments(options)
+        .uponReplyInvoke(
+            [callback = std::move(callback)](const sdbus::Error *error,
+                                             std::vector<u8> value) {
+                callback(error, std::move(value));
+            });
+}
+
+void CharacteristicProxy::WriteValueAsync(
+    std::vector<u8> value, WriteCallback callback,
+    std::map<std::string, sdbus::Variant> options) {
+    this->_proxy->callMethodAsync("WriteValue")
+        .onInterface(CHARACTERISTIC_IFACE)
+        .withArguments(value, options)
+        .uponReplyInvoke(
+            [callback = std::move(callback)](const sdbus::Error *error) {
+                callback(error);
+            });
+}
+
+std::future<std::vector<u8>> CharacteristicProxy::ReadValueAsync(
+    std::map<std::string, sdbus::Variant> options) const {
+    /* std::function needs a copyable callable, promise isn't */
+    auto promise = std::make_shared<std::promise<std::vector<u8>>>();
+    ReadValueAsync(
+        [promise](const sdbus::Error *error, std::vector<u8> value) {
+            if (error) {
+                promise->set_exception(std::make_exception_ptr(*error));
+            } else {
+                promise->set_value(std::move(value));
+            }
+        },
+        std::move(options));
+
+    return promise->get_future();
+}
+
+std::future<void> CharacteristicProxy::WriteValueAsync(
+    std::vector<u8> value, std::map<std::string, sdbus::Variant> options) {
+    auto promise = std::make_shared<std::promise<void>>();
+    WriteValueAsync(
+        std::move(value),
+        [promise](const sdbus::Error *error) {
+            if (error) {
+                promise->set_exception(std::make_exception_ptr(*error));
+            } else {
+                promise->set_value();
+            }
+        },
+        std::move(options));
+
+    return promise->get_future();
+}
+
+void CharacteristicProxy::subscribe(
+    NotifyCallback callback, std::map<std::string, sdbus::Variant> options) {
+    try {
+        auto fd = sdbus::UnixFd();
+        auto mtu_b = u16();
+        _proxy->callMethod("AcquireNotify")
+            .onInterface(CHARACTERISTIC_IFACE)
+            .withArguments(options)
+            .storeResultsTo(fd, mtu_b);
+
+        /* FdLink reads without blocking */
+        auto raw_fd = fd.release();
+        (void)fcntl(raw_fd, F_SETFL, fcntl(raw_fd, F_GETFL) | O_NONBLOCK);
+        notify_link = FdLink::open(
+            raw_fd, mtu_b, [callback](const u8 *data, size_t size_b) {
+                callback(ByteView(data, size_b));
+            });
+        return;
+    } catch (sdbus::Error &e) {
+#ifdef VERBOSE_DEBUG
+        cerr << "AcquireNotify failed, using StartNotify: " << e.what()
+             << endl;
+#endif
+    }
+
+    _proxy->uponSignal("PropertiesChanged")
+        .onInterface("org.freedesktop.DBus.Properties")
+        .call([callback](const std::string &interface,
+                         const std::map<std::string, sdbus::Variant> &changed,
+                         const std::vector<std::string> &) {
+            auto value = changed.find("Value");
+            if (interface != CHARACTERISTIC_IFACE || value == changed.end()) {
+                return;
+            }
+            auto bytes = value->second.get<vector<u8>>();
+            callback(ByteView(bytes));
+        });
+    _proxy->finishRegistration();
+
+    _proxy->callMethod("StartNotify").onInterface(CHARACTERISTIC_IFACE);
+}
+
+u16 CharacteristicProxy::getNotifyMtu() const {
+    if (!notify_link) {
+        return 0;
+    }
+    return notify_link->getMtu();
+}
+
 std::string CharacteristicProxy::getPath() const {
     return _proxy->getObjectPath();
 }
+
+void Characteristic::set_notifying(bool is_notifying) {
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex);
+        this->is_notifying = is_notifying;
+        if (!is_notifying) {
+            pending_notifications.clear();
+        }
+    }
+
+    /* Not registered without "notify" or "indicate", sdbus-c++ would throw
+     * on an unknown property */
+    if (has_notifying_property) {
+        characteristic->emitPropertiesChangedSignal(CHARACTERISTIC_IFACE,
+                                                    {"Notifying"});
+    }
+}
+
+void Characteristic::notify(vector<u8> value) {
+    auto is_acquired = isNotifyAcquired();
+    auto due_at = TimerQueue::Clock::time_point();
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex);
+        if (!is_notifying && !is_acquired) {
+            this->value = std::move(value);
+            return;
+        }
+
+        if (notify_policy.mode == NotifyPolicy::Mode::LATEST) {
+            pending_notifications.clear();
+        } else if (pending_notifications.size() >=
+                   notify_policy.max_queue_depth) {
+            pending_notifications.pop_front();
+            ++dropped_notification_count;
+        }
+        pending_notifications.push_back(std::move(value));
+
+        due_at = std::max(TimerQueue::Clock::now(),
+                          last_notified_at + notify_policy.min_interval_ms);
+    }
+
+    NotificationEngine::getInstance().markPending(this, due_at);
+}
+
+std::optional<TimerQueue::Clock::time_point>
+Characteristic::flush_notifications() {
+    auto values = std::deque<vector<u8>>();
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex);
+        if (notify_policy.min_interval_ms.count() == 0) {
+            values.swap(pending_notifications);
+        } else if (!pending_notifications.empty()) {
+            values.push_back(std::move(pending_notifications.front()));
+            pending_notifications.pop_front();
+        }
+        last_notified_at = TimerQueue::Clock::now();
+    }
+
+    auto is_acquired = isNotifyAcquired();
+    for (auto &notification : values) {
+        auto is_dropped =
+            is_acquired && !sendAcquiredNotification(notification);
+        {
+            std::lock_guard<std::mutex> lock(notify_mutex);
+            value = std::move(notification);
+            dropped_notification_count += is_dropped;
+        }
+
+        if (!is_acquired) {
+            /* Outside the lock, as emitting calls the getter */
+            characteristic->emitPropertiesChangedSignal(CHARACTERISTIC_IFACE,
+                                                        {"Value"});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(notify_mutex);
+    if (pending_notifications.empty()) {
+        return std::nullopt;
+    }
+    return last_notified_at + notify_policy.min_interval_ms;
+}
+
+void Characteristic::setNotifyPolicy(NotifyPolicy policy) {
+    std::lock_guard<std::mutex> lock(notify_mutex);
+    notify_policy = policy;
+}
+
+bool Characteristic::isNotifying() const {
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex);
+        if (is_notifying) {
+            return true;
+        }
+    }
+
+    return isNotifyAcquired();
+}
+
+u64 Characteristic::getDroppedNotificationCount() const {
+    std::lock_guard<std::mutex> lock(notify_mutex);
+    return dropped_notification_count;
+}
@@ -0,0 +1,403 @@
+/**
+ * @file connection_manager.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of ConnectionManager
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+#include "connection_manager.h"
+
+using std::string, std::vector;
+
+namespace {
+const auto DEVICE_IFACE = "org.bluez.Device1";
+
+/* Errors that would be same on every attempt */
+const vector<string> PERMANENT_ERRORS = {
+    "org.bluez.Error.DoesNotExist", "org.bluez.Error.InvalidArguments",
+    "org.bluez.Error.NotSupported", "org.freedesktop.DBus.Error.UnknownObject",
+    "org.freedesktop.DBus.Error.UnknownMethod"};
+
+bool is_retryable(const sdbus::Error &error) {
+    return std::find(PERMANENT_ERRORS.begin(), PERMANENT_ERRORS.end(),
+                     error.getName()) == PERMANENT_ERRORS.end();
+}
+} // namespace
+
+/* Shared with replies and callbacks in progress, which may destroy the
+ * manager, so they only touch this once it may be gone */
+struct ConnectionManager::Activity {
+    std::mutex mutex;
+    std::condition_variable changed;
+    /* Requests not yet completed, waiting, in flight or backing off */
+    size_t outstanding_count = 0;
+    /* A thread per issue, reply or callback running now */
+    std::multiset<std::thread::id> busy_threads;
+
+    void enter() {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy_threads.insert(std::this_thread::get_id());
+    }
+
+    void leave() {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy_threads.erase(busy_threads.find(std::this_thread::get_id()));
+        changed.notify_all();
+    }
+};
+
+ConnectionManager::ConnectionManager(BusContext &context,
+                                     unsigned int max_connects_per_adapter,
+                                     ConnectPolicy policy)
+    : context(context),
+      max_connects_per_adapter(std::max(1u, max_connects_per_adapter)),
+      policy(policy), activity(std::make_shared<Activity>()),
+      random(std::random_device()()) {
+    /* Listen before seeding, same as DeviceNameIndex, a device changed in
+     * between is just updated twice */
+    auto &tree = context.getObjectTree();
+    listener_id = tree.addListener(
+        DEVICE_IFACE,
+        [this](const BluezObjectTree::Change &change) { on_change(change); });
+
+    tree.forEachObjectWithInterface(
+        DEVICE_IFACE, [this](const sdbus::ObjectPath &object_path,
+                             const BluezObjectTree::Properties &properties) {
+            auto connected = properties.find("Connected");
+            auto is_connected = connected != properties.end() &&
+                                connected->second.get<bool>();
+
+            auto state = ConnectionState::DISCONNECTED;
+            if (is_connected) {
+                state = ConnectionState::CONNECTED;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            states[object_path] = state;
+        });
+}
+
+ConnectionManager::~ConnectionManager() {
+    auto cancelled = vector<std::shared_ptr<Request>>();
+    auto retrying = std::map<TimerQueue::TimerId, std::shared_ptr<Request>>();
+    auto calls = std::set<std::shared_ptr<Request>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+        for (auto &adapter : adapters) {
+            cancelled.insert(cancelled.end(), adapter.second.waiting.begin(),
+                             adapter.second.waiting.end());
+            adapter.second.waiting.clear();
+        }
+        retrying.swap(backing_off);
+        calls.swap(in_flight);
+    }
+
+    for (const auto &request : retrying) {
+        /* If the timer is already running, requeue() sees is_stopping and
+         * cancels it itself */
+        if (retries.cancel(request.first)) {
+            cancelled.push_back(request.second);
+        }
+    }
+
+    /* Issues, replies and callbacks on other threads finish, not the ones on
+     * this thread, the manager may be destroyed from a callback */
+    {
+        auto this_thread = std::this_thread::get_id();
+        auto &busy_threads = activity->busy_threads;
+        std::unique_lock<std::mutex> lock(activity->mutex);
+        activity->changed.wait(lock, [&]() {
+            return std::all_of(
+                busy_threads.begin(), busy_threads.end(),
+                [&](std::thread::id id) { return id == this_thread; });
+        });
+    }
+
+    /* Not waited for, the reply may only ever come on this thread.
+     * Destroying the proxy drops it, and a late one finds the request gone
+     * from `in_flight` */
+    for (const auto &request : calls) {
+        request->proxy.reset();
+        cancelled.push_back(request);
+    }
+    for (const auto &request : cancelled) {
+        cancel(request);
+    }
+
+    /* Not under our lock, a running listener holds the tree's lock and waits
+     * for ours */
+    context.getObjectTree().removeListener(listener_id);
+}
+
+void ConnectionManager::connect(BdAddr address, Callback callback,
+                                const string &adapter_path) {
+    auto request = std::make_shared<Request>();
+    request->device_path = address.toObjectPath(adapter_path);
+    request->adapter_path = adapter_path;
+    request->address = address;
+    request->callback = std::move(callback);
+    request->proxy = context.createBluezProxy(request->device_path);
+    {
+        std::lock_guard<std::mutex> lock(activity->mutex);
+        ++activity->outstanding_count;
+    }
+
+    auto startable = vector<std::shared_ptr<Request>>();
+    auto is_connected = false;
+    auto is_cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto state = states.find(request->device_path);
+        is_connected = state != states.end() &&
+                       state->second == ConnectionState::CONNECTED;
+        is_cancelled = is_stopping;
+        if (!is_connected && !is_cancelled) {
+            states[request->device_path] = ConnectionState::CONNECTING;
+            auto &adapter = adapters[adapter_path];
+            adapter.waiting.push_back(request);
+            startable = take_startable(adapter);
+        }
+    }
+
+    if (is_connected) {
+        complete(request, nullptr);
+        return;
+    }
+    if (is_cancelled) {
+        cancel(request);
+        return;
+    }
+
+    for (const auto &next : startable) {
+        issue(next);
+    }
+}
+
+/* Called with the lock held, the returned requests are issued after
+ * unlocking */
+vector<std::shared_ptr<ConnectionManager::Request>>
+ConnectionManager::take_startable(AdapterQueue &adapter) {
+    auto startable = vector<std::shared_ptr<Request>>();
+    while (adapter.active_count < max_connects_per_adapter &&
+           !adapter.waiting.empty()) {
+        startable.push_back(std::move(adapter.waiting.front()));
+        adapter.waiting.pop_front();
+        ++adapter.active_count;
+    }
+    return startable;
+}
+
+void ConnectionManager::issue(const std::shared_ptr<Request> &request) {
+    auto is_cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        /* The destructor has taken the calls in flight already */
+        is_cancelled = is_stopping;
+        if (!is_cancelled) {
+            in_flight.insert(request);
+            activity->enter();
+        }
+    }
+
+    if (is_cancelled) {
+        cancel(request);
+        return;
+    }
+
+    ++request->attempt_count;
+    request->proxy->callMethodAsync("Connect")
+        .onInterface(DEVICE_IFACE)
+        .withTimeout(policy.timeout_ms)
+        .uponReplyInvoke([this, request](const sdbus::Error *error) {
+            on_reply(request, error);
+        });
+    activity->leave();
+}
+
+void ConnectionManager::on_reply(const std::shared_ptr<Request> &request,
+                                 const sdbus::Error *error) {
+    if (error && error->getName() == "org.bluez.Error.AlreadyConnected") {
+        error = nullptr;
+    }
+
+    /* A copy, the callback may destroy the manager */
+    auto activity = this->activity;
+    auto startable = vector<std::shared_ptr<Request>>();
+    auto will_retry = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        /* Cancelled by the destructor */
+        if (in_flight.erase(request) == 0) {
+            return;
+        }
+        activity->enter();
+
+        auto &adapter = adapters[request->adapter_path];
+        --adapter.active_count;
+        startable = take_startable(adapter);
+
+        will_retry = error && !is_stopping && is_retryable(*error) &&
+                     request->attempt_count < policy.max_attempts;
+        if (will_retry) {
+            /* The task can't run before it is in `backing_off`, it needs our
+             * lock first */
+            request->retry_id =
+                retries.scheduleAfter(get_backoff(request->attempt_count),
+                                      [this, request]() { requeue(request); });
+            backing_off.emplace(request->retry_id, request);
+        }
+    }
+
+    for (const auto &next : startable) {
+        issue(next);
+    }
+
+    if (!will_retry) {
+        complete(request, error);
+    }
+    activity->leave();
+}
+
+/* On the timer thread, put a request back in its adapter's queue after its
+ * backoff */
+void ConnectionManager::requeue(const std::shared_ptr<Request> &request) {
+    auto startable = vector<std::shared_ptr<Request>>();
+    auto is_cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        backing_off.erase(request->retry_id);
+        is_cancelled = is_stopping;
+        if (!is_cancelled) {
+            auto &adapter = adapters[request->adapter_path];
+            adapter.waiting.push_back(request);
+            startable = take_startable(adapter);
+        }
+    }
+
+    if (is_cancelled) {
+        cancel(request);
+        return;
+    }
+
+    for (const auto &next : startable) {
+        issue(next);
+    }
+}
+
+void ConnectionManager::complete(const std::shared_ptr<Request> &request,
+                                 const sdbus::Error *error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &state = states[request->device_path];
+        /* Device1.Connected may already have told the real state */
+        if (state == ConnectionState::CONNECTING && error) {
+            state = ConnectionState::DISCONNECTED;
+        } else if (state == ConnectionState::CONNECTING) {
+            state = ConnectionState::CONNECTED;
+        }
+    }
+
+    /* A copy, nothing of the manager is touched after the callback, which
+     * may destroy it */
+    auto activity = this->activity;
+    activity->enter();
+    if (request->callback) {
+        request->callback(request->address, error);
+    }
+
+    /* Counted down after the callback, so waitUntilIdle() also waits for
+     * callbacks to return */
+    {
+        std::lock_guard<std::mutex> lock(activity->mutex);
+        --activity->outstanding_count;
+    }
+    activity->leave();
+}
+
+void ConnectionManager::cancel(const std::shared_ptr<Request> &request) {
+    auto error =
+        sdbus::Error("org.bluez.Error.Failed", "Connection manager destroyed");
+    complete(request, &error);
+}
+
+/* Called with the lock held, for `random` */
+TimerQueue::Clock::duration
+ConnectionManager::get_backoff(unsigned int attempt_count) {
+    auto backoff = policy.initial_backoff_ms;
+    for (auto i = 1u; i < attempt_count && backoff < policy.max_backoff_ms;
+         ++i) {
+        backoff *= 2;
+    }
+    backoff = std::min(backoff, policy.max_backoff_ms);
+
+    auto jitter = std::uniform_int_distribution<long>(
+        long(backoff.count()) / 2, long(backoff.count()));
+    return std::chrono::milliseconds(jitter(random));
+}
+
+void ConnectionManager::on_change(const BluezObjectTree::Change &change) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (change.kind == BluezObjectTree::Change::Kind::REMOVED) {
+        states.erase(change.object_path);
+        return;
+    }
+
+    if (std::find(change.changed.begin(), change.changed.end(), "Connected") ==
+        change.changed.end()) {
+        return;
+    }
+
+    auto connected = change.properties.find("Connected");
+    auto is_connected = connected != change.properties.end() &&
+                        connected->second.get<bool>();
+    auto &state = states[change.object_path];
+    if (is_connected) {
+        state = ConnectionState::CONNECTED;
+    } else if (state != ConnectionState::CONNECTING) {
+        /* A Connect in flight still decides, the device may have been
+         * connected and dropped in between attempts */
+        state = ConnectionState::DISCONNECTED;
+    }
+}
+
+void ConnectionManager::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(activity->mutex);
+    activity->changed.wait(
+        lock, [this]() { return activity->outstanding_count == 0; });
+}
+
+ConnectionState ConnectionManager::getState(BdAddr address,
+                                            const string &adapter_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto state = states.find(address.toObjectPath(adapter_path));
+    if (state == states.end()) {
+        return ConnectionState::DISCONNECTED;
+    }
+    return state->second;
+}
+
+vector<BdAddr>
+ConnectionManager::getConnectedDevices(const string &adapter_path) {
+    auto connected = vector<BdAddr>();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &state : states) {
+        if (state.second != ConnectionState::CONNECTED) {
+            continue;
+        }
+        auto address = BdAddr::fromObjectPath(state.first, adapter_path);
+        if (address) {
+            connected.push_back(*address);
+        }
+    }
+    return connected;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file fd_link.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of FdLink, and the epoll loop polling all links
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "fd_link.h"
+
+namespace {
+const auto MAX_EVENTS_PER_WAIT = 16;
+
+/* Packets queued while the socket is full, beyond this send() fails, so a
+ * stuck reader on bluez side can't make us grow without bound */
+const size_t MAX_PENDING_WRITES = 64;
+} // namespace
+
+/**
+ * @brief One thread running epoll_wait over every open FdLink
+ */
+class FdPoller {
+    int epoll_fd = -1;
+    int wakeup_fd = -1;
+    std::thread thread;
+    std::atomic<bool> is_running{true};
+
+    std::mutex mutex;
+    std::condition_variable dispatch_done;
+    std::map<int, std::weak_ptr<FdLink>> links;
+    /* fd whose callbacks are running now, -1 if none */
+    int dispatching_fd = -1;
+
+    void dispatch(const epoll_event &event) {
+        auto link = std::shared_ptr<FdLink>();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = links.find(event.data.fd);
+            if (it == links.end()) {
+                return;
+            }
+            link = it->second.lock();
+            if (!link) {
+                return;
+            }
+            dispatching_fd = event.data.fd;
+        }
+
+        if (event.events & EPOLLIN) {
+            link->handle_readable();
+        }
+        if ((event.events & EPOLLOUT) && link->isOpen()) {
+            link->handle_writable();
+        }
+        if ((event.events & (EPOLLHUP | EPOLLERR)) && link->isOpen()) {
+            link->handle_hangup();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            dispatching_fd = -1;
+        }
+        dispatch_done.notify_all();
+
+        /* If this was the last reference, ~FdLink runs here, on this thread,
+         * which remove() knows not to wait for */
+    }
+
+    void run() {
+        epoll_event events[MAX_EVENTS_PER_WAIT];
+        while (is_running) {
+            auto count = epoll_wait(epoll_fd, events, MAX_EVENTS_PER_WAIT, -1);
+            if (count == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "ERROR [epoll_wait]: " << std::strerror(errno)
+                          << std::endl;
+                return;
+            }
+
+            for (auto i = 0; i < count; ++i) {
+                if (events[i].data.fd == wakeup_fd) {
+                    eventfd_t value;
+                    (void)eventfd_read(wakeup_fd, &value);
+                    continue;
+                }
+                dispatch(events[i]);
+            }
+        }
+    }
+
+  public:
+    FdPoller() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd == -1 || wakeup_fd == -1) {
+            throw std::runtime_error(std::string("FdPoller: ") +
+                                     std::strerror(errno));
+        }
+
+        auto event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.fd = wakeup_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event) == -1) {
+            throw std::runtime_error(std::string("FdPoller: ") +
+                                     std::strerror(errno));
+        }
+
+        thread = std::thread([this]() { run(); });
+    }
+
+    ~FdPoller() {
+        is_running = false;
+        (void)eventfd_write(wakeup_fd, 1);
+        thread.join();
+        (void)::close(wakeup_fd);
+        (void)::close(epoll_fd);
+    }
+
+    static FdPoller &getInstance() {
+        static auto poller = FdPoller();
+        return poller;
+    }
+
+    void add(const std::shared_ptr<FdLink> &link) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            links[link->fd] = link;
+        }
+
+        auto event = epoll_event();
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = link->fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, link->fd, &event) == -1) {
+            throw std::runtime_error(std::string("FdPoller: ") +
+                                     std::strerror(errno));
+        }
+    }
+
+    /* Poll for EPOLLOUT only while there are queued writes, else epoll
+     * would wake us up all the time, since the socket is mostly writable */
+    void setWriteInterest(int fd, bool is_interested) {
+        auto event = epoll_event();
+        event.events = EPOLLIN | EPOLLRDHUP;
+        if (is_interested) {
+            event.events |= EPOLLOUT;
+        }
+        event.data.fd = fd;
+        (void)epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    void remove(int fd) {
+        (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        links.erase(fd);
+        if (std::this_thread::get_id() != thread.get_id()) {
+            dispatch_done.wait(lock,
+                               [this, fd]() { return dispatching_fd != fd; });
+        }
+    }
+};
+
+FdLink::FdLink(int fd, u16 mtu_b, ReadCallback on_read, CloseCallback on_close)
+    : fd(fd), mtu_b(mtu_b), on_read(std::move(on_read)),
+      on_close(std::move(on_close)), read_buffer(mtu_b) {}
+
+std::shared_ptr<FdLink> FdLink::open(int fd, u16 mtu_b, ReadCallback on_read,
+                                     CloseCallback on_close) {
+    auto link = std::shared_ptr<FdLink>(
+        new FdLink(fd, mtu_b, std::move(on_read), std::move(on_close)));
+    FdPoller::getInstance().add(link);
+
+    return link;
+}
+
+FdLink::~FdLink() { close(); }
+
+void FdLink::handle_readable() {
+    while (is_open) {
+        auto read_b = recv(fd, read_buffer.data(), read_buffer.size(),
+                           MSG_DONTWAIT);
+        if (read_b > 0) {
+            if (on_read) {
+                on_read(read_buffer.data(), size_t(read_b));
+            }
+            continue;
+        }
+
+        if (read_b == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+
+        /* 0 means bluez closed its end, eg. the remote disconnected */
+        handle_hangup();
+        return;
+    }
+}
+
+void FdLink::handle_writable() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!is_open) {
+        return;
+    }
+    while (!pending_writes.empty()) {
+        const auto &packet = pending_writes.front();
+        auto sent_b = ::send(fd, packet.data(), packet.size(),
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent_b == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            /* The hangup will be reported by epoll too */
+            pending_writes.clear();
+            break;
+        }
+        pending_writes.pop_front();
+    }
+
+    FdPoller::getInstance().setWriteInterest(fd, false);
+}
+
+void FdLink::handle_hangup() {
+    if (!is_open.exchange(false)) {
+        return;
+    }
+
+    FdPoller::getInstance().remove(fd);
+    close_fd();
+
+    if (on_close) {
+        on_close();
+    }
+}
+
+bool FdLink::send(const u8 *data, size_t size_b) {
+    if (size_b > mtu_b) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!is_open) {
+        return false;
+    }
+
+    if (pending_writes.empty()) {
+        /* SOCK_SEQPACKET, so it's all sent, or nothing */
+        auto sent_b = ::send(fd, data, size_b, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent_b != -1) {
+            return true;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+    }
+
+    if (pending_writes.size() >= MAX_PENDING_WRITES) {
+        return false;
+    }
+
+    pending_writes.emplace_back(data, data + size_b);
+    FdPoller::getInstance().setWriteInterest(fd, true);
+    return true;
+}
+
+void FdLink::close() {
+    if (!is_open.exchange(false)) {
+        return;
+    }
+
+    FdPoller::getInstance().remove(fd);
+    close_fd();
+}
+
+/* Under the lock send() holds, so once it saw the link open, the fd stays
+ * open (and isn't reused) till it's done */
+void FdLink::close_fd() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    (void)::close(fd);
+    pending_writes.clear();
+}
+
+bool FdLink::isOpen() const { return is_open; }
+
+int FdLink::getFd() const { return fd; }
+
+u16 FdLink::getMtu() const { return mtu_b; }
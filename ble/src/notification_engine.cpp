@@ -0,0 +1,99 @@
+/**
+ * @file notification_engine.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of NotificationEngine
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <optional>
+#include <vector>
+
+#include "characteristic.h"
+#include "notification_engine.h"
+
+NotificationEngine &NotificationEngine::getInstance() {
+    static auto engine = NotificationEngine();
+    return engine;
+}
+
+void NotificationEngine::markPending(Characteristic *characteristic,
+                                     Clock::time_point due_at) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pending.find(characteristic);
+    if (it != pending.end() && it->second <= due_at) {
+        return;
+    }
+    pending[characteristic] = due_at;
+
+    /* A flush already scheduled earlier will reschedule for this one */
+    if (due_at < scheduled_at) {
+        scheduled_at = due_at;
+        timers.scheduleAt(due_at, [this]() { flush(); });
+    }
+}
+
+void NotificationEngine::flush() {
+    auto due = std::vector<Characteristic *>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = Clock::now();
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second <= now) {
+                due.push_back(it->first);
+                flushing.insert(it->first);
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /* Outside the lock, as notify() from a user thread takes it */
+    auto next_due =
+        std::vector<std::pair<Characteristic *, Clock::time_point>>();
+    for (auto characteristic : due) {
+        auto due_at = characteristic->flush_notifications();
+        if (due_at) {
+            next_due.emplace_back(characteristic, *due_at);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto characteristic : due) {
+            flushing.erase(characteristic);
+        }
+        for (const auto &[characteristic, due_at] : next_due) {
+            auto it = pending.find(characteristic);
+            if (it == pending.end() || due_at < it->second) {
+                pending[characteristic] = due_at;
+            }
+        }
+
+        scheduled_at = Clock::time_point::max();
+        for (const auto &entry : pending) {
+            if (entry.second < scheduled_at) {
+                scheduled_at = entry.second;
+            }
+        }
+        if (scheduled_at != Clock::time_point::max()) {
+            timers.scheduleAt(scheduled_at, [this]() { flush(); });
+        }
+    }
+    flush_done.notify_all();
+}
+
+void NotificationEngine::remove(Characteristic *characteristic) {
+    std::unique_lock<std::mutex> lock(mutex);
+    /* Wait first, as the flush marks it pending again if it has more */
+    if (!timers.isTimerThread()) {
+        flush_done.wait(lock, [this, characteristic]() {
+            return flushing.count(characteristic) == 0;
+        });
+    }
+    pending.erase(characteristic);
+}
@@ -0,0 +1,265 @@
+/**
+ * @file read_scheduler.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of ReadScheduler
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "characteristic.h"
+#include "read_scheduler.h"
+
+using std::string, std::vector;
+
+namespace {
+const auto DEVICE_IFACE = "org.bluez.Device1";
+const auto CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
+
+using Clock = std::chrono::steady_clock;
+
+/* "/org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX" -> "/org/bluez/hci0" */
+string get_adapter_path(const string &device_path) {
+    return device_path.substr(0, device_path.rfind('/'));
+}
+
+/* bluez reports UUIDs in lower case, callers may not */
+string to_lower(string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+    return text;
+}
+
+struct DeviceWork {
+    string device_path;
+    vector<size_t> item_indices;
+
+    bool was_connected = false;
+    bool is_connected_by_us = false;
+    size_t pending_reads = 0;
+
+    /* Kept till the sweep is destroyed, as destroying a proxy drops its
+     * replies */
+    std::unique_ptr<sdbus::IProxy> device_proxy;
+    vector<std::unique_ptr<CharacteristicProxy>> characteristics;
+};
+
+struct AdapterQueue {
+    std::deque<DeviceWork *> waiting;
+    unsigned int active_count = 0;
+};
+
+/**
+ * @brief State of one ReadScheduler::run(), callbacks run on the event loop
+ * thread and everything is guarded by `mutex`
+ *
+ * Outlives run(), the last reply handler is still running in its proxy when
+ * run() wakes up. It is destroyed on ReadScheduler's timer thread
+ */
+class Sweep {
+    BusContext &context;
+    unsigned int max_devices_per_adapter;
+
+    std::mutex mutex;
+    std::condition_variable done;
+
+    vector<ReadResult> results;
+    /* After `mutex`, so destroying the proxies, which waits for a handler
+     * still running, comes first */
+    std::deque<DeviceWork> devices;
+    std::map<string, AdapterQueue> adapters;
+    size_t remaining_devices = 0;
+
+    void fail_items(const DeviceWork &work, const sdbus::Error &error) {
+        for (auto index : work.item_indices) {
+            results[index].error = error;
+        }
+    }
+
+    void start_next(AdapterQueue &adapter) {
+        while (adapter.active_count < max_devices_per_adapter &&
+               !adapter.waiting.empty()) {
+            auto work = adapter.waiting.front();
+            adapter.waiting.pop_front();
+            ++adapter.active_count;
+            start_device(*work);
+        }
+    }
+
+    void start_device(DeviceWork &work) {
+        auto connected = context.getObjectTree().getProperty(
+            sdbus::ObjectPath(work.device_path), DEVICE_IFACE, "Connected");
+        work.was_connected = connected && connected->get<bool>();
+        if (work.was_connected) {
+            issue_reads(work);
+            return;
+        }
+
+        work.device_proxy = context.createBluezProxy(work.device_path);
+        work.device_proxy->callMethodAsync("Connect")
+            .onInterface(DEVICE_IFACE)
+            .uponReplyInvoke([this, &work](const sdbus::Error *error) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error) {
+                    fail_items(work, *error);
+                    finish_device(work);
+                    return;
+                }
+
+                work.is_connected_by_us = true;
+                issue_reads(work);
+            });
+    }
+
+    void issue_reads(DeviceWork &work) {
+        /* GATT objects of the device, announced before Connect replied, so
+         * already in the object tree */
+        auto uuid_to_path = std::map<string, sdbus::ObjectPath>();
+        auto prefix = work.device_path + "/";
+        context.getObjectTree().forEachObjectWithInterface(
+            CHARACTERISTIC_IFACE,
+            [&uuid_to_path, &prefix](const sdbus::ObjectPath &path,
+                                     const BluezObjectTree::Properties
+                                         &properties) {
+                auto uuid = properties.find("UUID");
+                if (path.compare(0, prefix.size(), prefix) == 0 &&
+                    uuid != properties.end()) {
+                    uuid_to_path.emplace(to_lower(uuid->second.get<string>()),
+                                         path);
+                }
+            });
+
+        for (auto index : work.item_indices) {
+            const auto &uuid = results[index].item.characteristic_uuid;
+            auto path = uuid_to_path.find(to_lower(uuid));
+            if (path == uuid_to_path.end()) {
+                results[index].error =
+                    sdbus::Error("org.bluez.Error.DoesNotExist",
+                                 "No characteristic with UUID " + uuid);
+                continue;
+            }
+
+            work.characteristics.push_back(
+                std::make_unique<CharacteristicProxy>(context.getConnection(),
+                                                      path->second));
+            ++work.pending_reads;
+
+            auto started_at = Clock::now();
+            work.characteristics.back()->ReadValueAsync(
+                [this, &work, index, started_at](const sdbus::Error *error,
+                                                 vector<u8> value) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto &result = results[index];
+                    result.latency = Clock::now() - started_at;
+                    if (error) {
+                        result.error = *error;
+                    } else {
+                        result.value = std::move(value);
+                    }
+
+                    if (--work.pending_reads == 0) {
+                        finish_device(work);
+                    }
+                });
+        }
+
+        if (work.pending_reads == 0) {
+            finish_device(work);
+        }
+    }
+
+    void finish_device(DeviceWork &work) {
+        if (work.is_connected_by_us) {
+            /* Nothing to do if it fails, bluez disconnects idle devices
+             * eventually anyway */
+            work.device_proxy->callMethodAsync("Disconnect")
+                .onInterface(DEVICE_IFACE)
+                .uponReplyInvoke([](const sdbus::Error *) {});
+        }
+
+        auto &adapter = adapters[get_adapter_path(work.device_path)];
+        --adapter.active_count;
+        start_next(adapter);
+
+        /* Last, `work` may be destroyed once run() wakes up */
+        if (--remaining_devices == 0) {
+            done.notify_all();
+        }
+    }
+
+  public:
+    Sweep(BusContext &context, unsigned int max_devices_per_adapter,
+          const vector<ReadItem> &items)
+        : context(context), max_devices_per_adapter(max_devices_per_adapter) {
+        results.reserve(items.size());
+        for (const auto &item : items) {
+            results.push_back(ReadResult{item, {}, std::nullopt, {}});
+        }
+
+        auto device_indices = std::map<string, size_t>();
+        for (auto i = size_t(0); i < items.size(); ++i) {
+            auto inserted =
+                device_indices.emplace(items[i].device_path, devices.size());
+            if (inserted.second) {
+                auto work = DeviceWork();
+                work.device_path = items[i].device_path;
+                devices.push_back(std::move(work));
+            }
+            devices[inserted.first->second].item_indices.push_back(i);
+        }
+
+        for (auto &work : devices) {
+            adapters[get_adapter_path(work.device_path)].waiting.push_back(
+                &work);
+        }
+        remaining_devices = devices.size();
+    }
+
+    vector<ReadResult> run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (auto &adapter : adapters) {
+            start_next(adapter.second);
+        }
+
+        done.wait(lock, [this]() { return remaining_devices == 0; });
+        return std::move(results);
+    }
+};
+} // namespace
+
+ReadScheduler::ReadScheduler(BusContext &context,
+                             unsigned int max_devices_per_adapter)
+    : context(context),
+      max_devices_per_adapter(std::max(1u, max_devices_per_adapter)),
+      timers(std::make_unique<TimerQueue>()) {}
+
+vector<ReadResult> ReadScheduler::run(const vector<ReadItem> &items) {
+    /* Seeded here, as seeding from a reply callback, on the event loop
+     * thread, would wait for itself */
+    (void)context.getObjectTree();
+
+    auto sweep = std::make_shared<Sweep>(context, max_devices_per_adapter,
+                                         items);
+    auto results = sweep->run();
+
+    /* Not here, the event loop thread may still be in the handler of the
+     * last reply, and destroying its proxy on that thread would free it
+     * under the handler */
+    timers->scheduleAfter(std::chrono::milliseconds(0),
+                          [sweep = std::move(sweep)]() mutable {
+                              sweep.reset();
+                          });
+    return results;
+}
@@ -0,0 +1,378 @@
+/**
+ * @file scan_session.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of ScanSession
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "adapter.h"
+#include "scan_session.h"
+
+using std::string, std::vector;
+
+namespace {
+const auto ADAPTER_IFACE = "org.bluez.Adapter1";
+const auto DEVICE_IFACE = "org.bluez.Device1";
+
+/* Properties that change only when an advertisement is received, ie. the
+ * device is actually around, not just remembered by bluez */
+const vector<string> ADVERTISING_PROPERTIES = {"RSSI", "TxPower",
+                                               "ManufacturerData",
+                                               "ServiceData"};
+
+const unsigned int NIBBLE_BITS = 4;
+
+template <typename T>
+std::optional<T> get_property(const BluezObjectTree::Properties &properties,
+                              const string &name) {
+    auto property = properties.find(name);
+    if (property == properties.end()) {
+        return std::nullopt;
+    }
+    return property->second.get<T>();
+}
+
+ScanRecord make_record(const string &device_path, BdAddr address,
+                       const BluezObjectTree::Properties &properties) {
+    auto record = ScanRecord();
+    record.device_path = device_path;
+    record.address = address;
+    record.name = get_property<string>(properties, "Name");
+    record.rssi_dbm = get_property<i16>(properties, "RSSI");
+    record.tx_power_dbm = get_property<i16>(properties, "TxPower");
+    record.uuids =
+        get_property<vector<string>>(properties, "UUIDs").value_or(
+            vector<string>());
+
+    auto manufacturer_data =
+        get_property<std::map<u16, sdbus::Variant>>(properties,
+                                                    "ManufacturerData");
+    if (manufacturer_data) {
+        for (const auto &data : *manufacturer_data) {
+            record.manufacturer_data[data.first] =
+                data.second.get<vector<u8>>();
+        }
+    }
+
+    auto service_data = get_property<std::map<string, sdbus::Variant>>(
+        properties, "ServiceData");
+    if (service_data) {
+        for (const auto &data : *service_data) {
+            record.service_data[data.first] = data.second.get<vector<u8>>();
+        }
+    }
+
+    return record;
+}
+
+u64 get_steady_time_ns() {
+    return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count());
+}
+
+int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* Pack hex digits of `text` into `bytes`, skipping separators like '-' */
+void parse_hex(const string &text, u8 *bytes, size_t size_b) {
+    auto nibble_count = size_t(0);
+    std::memset(bytes, 0, size_b);
+    for (auto c : text) {
+        auto value = hex_digit_value(c);
+        if (value < 0) {
+            continue;
+        }
+        if (nibble_count == 2 * size_b) {
+            return;
+        }
+        /* High nibble first */
+        auto nibble = u8(value);
+        if (nibble_count % 2 == 0) {
+            nibble = u8(nibble << NIBBLE_BITS);
+        }
+        bytes[nibble_count / 2] |= nibble;
+        ++nibble_count;
+    }
+}
+
+/* Copy at most SCAN_EVENT_DATA_MAX_B bytes, returns whether all fit */
+bool copy_data(const vector<u8> &data, u8 *destination, u8 &size_b) {
+    size_b = u8(std::min(data.size(), SCAN_EVENT_DATA_MAX_B));
+    std::memcpy(destination, data.data(), size_b);
+    return data.size() <= SCAN_EVENT_DATA_MAX_B;
+}
+
+/* Everything but kind and timestamp. sdbus-c++ 1.1 has no view into a
+ * Variant, so each data property is copied out of it, a map and its first
+ * vector, and freed at return. Nothing of it is kept, the event is inline */
+void fill_event(ScanEvent &event, BdAddr address,
+                const BluezObjectTree::Properties &properties) {
+    event.address = address;
+
+    auto rssi_dbm = get_property<i16>(properties, "RSSI");
+    if (rssi_dbm) {
+        event.flags |= ScanEvent::HAS_RSSI;
+        event.rssi_dbm = *rssi_dbm;
+    }
+
+    auto tx_power_dbm = get_property<i16>(properties, "TxPower");
+    if (tx_power_dbm) {
+        event.flags |= ScanEvent::HAS_TX_POWER;
+        event.tx_power_dbm = *tx_power_dbm;
+    }
+
+    auto manufacturer_data =
+        get_property<std::map<u16, sdbus::Variant>>(properties,
+                                                    "ManufacturerData");
+    if (manufacturer_data && !manufacturer_data->empty()) {
+        const auto &first = *manufacturer_data->begin();
+        event.flags |= ScanEvent::HAS_MANUFACTURER_DATA;
+        event.company_id = first.first;
+        if (!copy_data(first.second.get<vector<u8>>(),
+                       event.manufacturer_data,
+                       event.manufacturer_data_size_b) ||
+            manufacturer_data->size() > 1) {
+            event.flags |= ScanEvent::TRUNCATED;
+        }
+    }
+
+    auto service_data = get_property<std::map<string, sdbus::Variant>>(
+        properties, "ServiceData");
+    if (service_data && !service_data->empty()) {
+        const auto &first = *service_data->begin();
+        event.flags |= ScanEvent::HAS_SERVICE_DATA;
+        parse_hex(first.first, event.service_uuid, sizeof(event.service_uuid));
+        if (!copy_data(first.second.get<vector<u8>>(), event.service_data,
+                       event.service_data_size_b) ||
+            service_data->size() > 1) {
+            event.flags |= ScanEvent::TRUNCATED;
+        }
+    }
+}
+
+bool is_same_event(const ScanEvent &a, const ScanEvent &b) {
+    return a.flags == b.flags && a.address == b.address &&
+           a.rssi_dbm == b.rssi_dbm && a.tx_power_dbm == b.tx_power_dbm &&
+           a.company_id == b.company_id &&
+           a.manufacturer_data_size_b == b.manufacturer_data_size_b &&
+           std::memcmp(a.manufacturer_data, b.manufacturer_data,
+                       a.manufacturer_data_size_b) == 0 &&
+           std::memcmp(a.service_uuid, b.service_uuid,
+                       sizeof(a.service_uuid)) == 0 &&
+           a.service_data_size_b == b.service_data_size_b &&
+           std::memcmp(a.service_data, b.service_data,
+                       a.service_data_size_b) == 0;
+}
+
+bool is_same_record(const ScanRecord &a, const ScanRecord &b) {
+    return a.address == b.address && a.name == b.name &&
+           a.rssi_dbm == b.rssi_dbm && a.tx_power_dbm == b.tx_power_dbm &&
+           a.manufacturer_data == b.manufacturer_data &&
+           a.service_data == b.service_data && a.uuids == b.uuids;
+}
+} // namespace
+
+ScanSession::ScanSession(Callback callback, BusContext &context,
+                         string adapter_path)
+    : context(context), adapter_path(std::move(adapter_path)),
+      callback(std::move(callback)) {
+    if (this->adapter_path.empty()) {
+        this->adapter_path = get_advertising_capable_adapter_path(context);
+    }
+}
+
+ScanSession::ScanSession(ScanEventRing &ring, BusContext &context,
+                         string adapter_path)
+    : ScanSession(Callback(), context, std::move(adapter_path)) {
+    this->ring = &ring;
+}
+
+ScanSession::~ScanSession() {
+    try {
+        stop();
+    } catch (sdbus::Error &e) {
+        std::cerr << "ERROR [StopDiscovery]: " << e.what() << std::endl;
+    }
+}
+
+void ScanSession::start(const ScanFilter &filter) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (is_active) {
+            return;
+        }
+        is_active = true;
+        seen.clear();
+    }
+
+    /* Listen before starting, so no device found in between is missed */
+    auto id = context.getObjectTree().addListener(
+        DEVICE_IFACE,
+        [this](const BluezObjectTree::Change &change) { on_change(change); });
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        listener_id = id;
+    }
+
+    auto discovery_filter = std::map<string, sdbus::Variant>(
+        {{"Transport", filter.transport}, {"DuplicateData", false}});
+    if (filter.rssi_dbm) {
+        discovery_filter.emplace("RSSI", *filter.rssi_dbm);
+    }
+    if (!filter.uuids.empty()) {
+        discovery_filter.emplace("UUIDs", filter.uuids);
+    }
+
+    auto adapter = context.createBluezProxy(adapter_path);
+    try {
+        adapter->callMethod("SetDiscoveryFilter")
+            .onInterface(ADAPTER_IFACE)
+            .withArguments(discovery_filter);
+
+        try {
+            adapter->callMethod("StartDiscovery").onInterface(ADAPTER_IFACE);
+        } catch (sdbus::Error &e) {
+            if (e.getName() != "org.bluez.Error.InProgress") {
+                throw;
+            }
+        }
+    } catch (sdbus::Error &) {
+        context.getObjectTree().removeListener(id);
+        std::lock_guard<std::mutex> lock(mutex);
+        is_active = false;
+        throw;
+    }
+}
+
+void ScanSession::stop() {
+    auto id = BluezObjectTree::ListenerId();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_active) {
+            return;
+        }
+        is_active = false;
+        id = listener_id;
+    }
+
+    /* Not under our lock, a running listener holds the tree's lock and waits
+     * for ours */
+    context.getObjectTree().removeListener(id);
+
+    context.createBluezProxy(adapter_path)
+        ->callMethod("StopDiscovery")
+        .onInterface(ADAPTER_IFACE);
+}
+
+void ScanSession::on_change(const BluezObjectTree::Change &change) {
+    /* Only devices of our adapter */
+    auto address = BdAddr::fromObjectPath(change.object_path, adapter_path);
+    if (!address) {
+        return;
+    }
+
+    /* Value initialized, so fields not in the properties are 0 */
+    auto event = ScanEvent();
+    event.timestamp_ns = get_steady_time_ns();
+    auto record = ScanRecord();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto known = seen.find(change.object_path);
+
+        if (change.kind == BluezObjectTree::Change::Kind::REMOVED) {
+            if (known == seen.end()) {
+                return;
+            }
+            event = known->second.event;
+            event.kind = Event::LOST;
+            record = std::move(known->second.record);
+            seen.erase(known);
+        } else {
+            fill_event(event, *address, change.properties);
+            if (callback) {
+                record = make_record(change.object_path, *address,
+                                     change.properties);
+            }
+
+            if (known != seen.end()) {
+                auto is_same = false;
+                if (callback) {
+                    is_same = is_same_record(known->second.record, record);
+                } else {
+                    is_same = is_same_event(known->second.event, event);
+                }
+                if (is_same) {
+                    return;
+                }
+                event.kind = Event::UPDATED;
+                known->second = {event, record};
+            } else {
+                auto is_advertising =
+                    change.kind == BluezObjectTree::Change::Kind::ADDED ||
+                    std::any_of(change.changed.begin(), change.changed.end(),
+                                [](const string &name) {
+                                    return std::find(
+                                               ADVERTISING_PROPERTIES.begin(),
+                                               ADVERTISING_PROPERTIES.end(),
+                                               name) !=
+                                           ADVERTISING_PROPERTIES.end();
+                                });
+                if (!is_advertising) {
+                    return;
+                }
+                event.kind = Event::FOUND;
+                seen[change.object_path] = {event, record};
+            }
+        }
+    }
+
+    if (ring) {
+        ring->push(event);
+    }
+    if (callback) {
+        callback(event.kind, record);
+    }
+}
+
+bool ScanSession::isActive() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return is_active;
+}
+
+vector<ScanRecord> ScanSession::getSeenDevices() {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto records = vector<ScanRecord>();
+    if (!callback) {
+        return records;
+    }
+
+    records.reserve(seen.size());
+    for (const auto &device : seen) {
+        records.push_back(device.second.record);
+    }
+
+    return records;
+}
+
+const string &ScanSession::getAdapterPath() const { return adapter_path; }
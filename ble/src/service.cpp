@@ -61,6 +61,8 @@ Service::Service(sdbus::IConnection &connection, string application_path,
 
 Service::~Service() {
     for (auto &ptr : characteristics) {
+        /* While the derived class is still whole */
+        ptr->stop();
         delete ptr;
     }
 }
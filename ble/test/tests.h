@@ -1,30 +1,35 @@
 /**
  * @file tests.h
  * @brief Not automated tests, just manually checking if it 'not' fails
- *
- * @bug Sometime it will stuck at "Can verify that the root object has been
-exported :) [Testcase] Will stop advertising after 1 seconds, for next tests to
-run Times up!
-"
- * This is probably due to a leaveEventLoop() signal getting un noticed in
-multi threading
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <alloca.h>
 #include <chrono>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <sys/socket.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 #include "common/adapter.h"
 #include "common/declarations.h"
+#include "common/value_buffer.h"
 
 #include "ble/advertisement.h"
+#include "ble/advertisement_scheduler.h"
+#include "ble/bulk_transfer_client.h"
+#include "ble/bulk_transfer_service.h"
 #include "ble/central.h"
 #include "ble/characteristic.h"
+#include "ble/connection_manager.h"
+#include "ble/fd_link.h"
 #include "ble/peripheral.h"
+#include "ble/scan_event.h"
 #include "ble/service.h"
 
 #include "sdbus-c++/sdbus-c++.h"
@@ -36,9 +41,9 @@ using std::cout, std::endl, std::vector, std::string, std::map;
 
 class MyApplication : public Application {
   public:
-    MyApplication(sdbus::IConnection &connection,
+    MyApplication(BusContext &context,
                   const std::string &application_object_path)
-        : Application(connection, application_object_path) {}
+        : Application(context, application_object_path) {}
 
     void onInterfacesAdded(
         const sdbus::ObjectPath &object_path,
@@ -104,9 +109,200 @@ class MyCorrectService : public Service {
     };
 };
 
-void test_register_application(sdbus::IConnection &conn) {
+/* Counts how often its value is generated */
+class LongValueService : public Service {
+  public:
+    LongValueService(sdbus::IConnection &connection,
+                     std::string application_path, unsigned int index,
+                     std::string UUID)
+        : Service(connection, application_path, index, UUID) {}
+
+    struct LongValueCharacteristic : public Characteristic {
+        mutable std::atomic<unsigned int> read_count{0};
+
+        LongValueCharacteristic(sdbus::IConnection &connection,
+                                std::string service_path, unsigned int index,
+                                std::string UUID)
+            : Characteristic(connection, service_path, index, UUID) {}
+
+        std::vector<u8> ReadValue(
+            std::map<std::string, sdbus::Variant> options) const override {
+            /* Different every time, so a torn read would show */
+            auto count = ++read_count;
+            return std::vector<u8>(512, u8(count));
+        }
+
+        void
+        WriteValue(std::vector<u8> value,
+                   std::map<std::string, sdbus::Variant> options) override {}
+    };
+
+    /* Takes written values as views, no vector */
+    struct LongWriteCharacteristic : public Characteristic {
+        std::atomic<unsigned int> write_count{0};
+        std::atomic<size_t> last_size_b{0};
+        std::atomic<u16> last_offset_b{0};
+        std::atomic<u16> last_mtu_b{0};
+
+        LongWriteCharacteristic(sdbus::IConnection &connection,
+                                std::string service_path, unsigned int index,
+                                std::string UUID)
+            : Characteristic(connection, service_path, index, UUID) {}
+
+        std::vector<u8> ReadValue(
+            std::map<std::string, sdbus::Variant> options) const override {
+            return {};
+        }
+
+        void WriteValue(ByteView value, const GattOptions &options) override {
+            ++write_count;
+            last_size_b = value.size();
+            last_offset_b = options.offset_b;
+            last_mtu_b = options.mtu_b.value_or(0);
+        }
+
+        /* Not called, the base calls the overload above */
+        void
+        WriteValue(std::vector<u8> value,
+                   std::map<std::string, sdbus::Variant> options) override {
+            WriteValue(ByteView(value), GattOptions());
+        }
+    };
+};
+
+void test_long_read() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto &context = getDefaultBusContext();
+    auto app = MyApplication(context, "/com/example/long");
+    auto &service = app.addService<LongValueService>(
+        0, "0000180a-0000-1000-8000-00805f9b34fb");
+    auto &characteristic =
+        service.addCharacteristic<LongValueService::LongValueCharacteristic>(
+            0, "00002a24-0000-1000-8000-00805f9b34fb");
+
+    /* Read as bluez does for an ATT client with the minimum MTU */
+    auto connection = sdbus::createSystemBusConnection();
+    auto proxy =
+        CharacteristicProxy(*connection, characteristic.getObjectPath(),
+                            context.getConnection().getUniqueName());
+    auto options = std::map<std::string, sdbus::Variant>(
+        {{"device", sdbus::ObjectPath("/org/bluez/hci0/dev_00_00_00_00_00_01")},
+         {"mtu", sdbus::Variant(u16(23))}});
+    auto value = vector<u8>();
+    while (true) {
+        options["offset"] = sdbus::Variant(u16(value.size()));
+        auto chunk = proxy.ReadValue(options);
+        value.insert(value.end(), chunk.begin(), chunk.end());
+        if (chunk.size() < 22) {
+            break;
+        }
+    }
+
+    auto is_torn = std::any_of(value.begin(), value.end(),
+                               [&value](u8 byte) { return byte != value[0]; });
+    cout << "Read " << value.size() << " bytes (512), value generated "
+         << characteristic.read_count << " times (1), torn: " << std::boolalpha
+         << is_torn << " (false)" << endl;
+
+    /* Older bluez passes no "mtu", and cuts the response itself, so the
+     * whole value is returned */
+    options.erase("mtu");
+    options["offset"] = sdbus::Variant(u16(0));
+    auto whole = proxy.ReadValue(options);
+    options["offset"] = sdbus::Variant(u16(100));
+    auto rest = proxy.ReadValue(options);
+    cout << "Without mtu, read " << whole.size() << " bytes (512), from "
+         << "offset 100 " << rest.size() << " bytes (412)" << endl;
+}
+
+void test_long_write() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto &context = getDefaultBusContext();
+    auto app = MyApplication(context, "/com/example/write");
+    auto &service = app.addService<LongValueService>(
+        0, "0000180a-0000-1000-8000-00805f9b34fb");
+    auto &characteristic =
+        service.addCharacteristic<LongValueService::LongWriteCharacteristic>(
+            0, "00002a25-0000-1000-8000-00805f9b34fb");
+
+    auto connection = sdbus::createSystemBusConnection();
+    auto proxy =
+        CharacteristicProxy(*connection, characteristic.getObjectPath(),
+                            context.getConnection().getUniqueName());
+    auto options = std::map<std::string, sdbus::Variant>(
+        {{"device", sdbus::ObjectPath("/org/bluez/hci0/dev_00_00_00_00_00_01")},
+         {"mtu", sdbus::Variant(u16(23))},
+         {"type", sdbus::Variant(std::string("reliable"))},
+         {"link", sdbus::Variant(std::string("LE"))},
+         /* Not known, skipped by the decoder */
+         {"x-unknown", sdbus::Variant(u32(7))}});
+
+    /* As bluez calls it, once per Execute Write, with the Prepare Writes
+     * joined. One of exactly one Prepare Write chunk (MTU 23) first, it
+     * must not be held back */
+    proxy.WriteValue(vector<u8>(18, 0x42), options);
+    auto chunk_write_count = characteristic.write_count.load();
+    proxy.WriteValue(vector<u8>(512, 0x42), options);
+
+    cout << "Handler called " << chunk_write_count
+         << " times after one chunk (1), " << characteristic.write_count
+         << " in all (2), last with " << characteristic.last_size_b
+         << " bytes (512), at offset " << characteristic.last_offset_b
+         << " (0), MTU " << characteristic.last_mtu_b << " (23)" << endl;
+
+    /* A write at an offset patches the value written last, the handler
+     * still gets all of it */
+    proxy.WriteValue(vector<u8>(100, 0x42), options);
+    options["offset"] = sdbus::Variant(u16(60));
+    proxy.WriteValue(vector<u8>(80, 0x43), options);
+    cout << "After a write at offset 60, handler got "
+         << characteristic.last_size_b << " bytes (140), at offset "
+         << characteristic.last_offset_b << " (0)" << endl;
+
+    /* Past the end of the value written last */
+    options["offset"] = sdbus::Variant(u16(200));
+    try {
+        proxy.WriteValue(vector<u8>(10, 0x44), options);
+        cout << "Write past the end accepted (expected InvalidOffset)"
+             << endl;
+    } catch (const sdbus::Error &e) {
+        cout << "Write past the end: " << e.getName()
+             << " (org.bluez.Error.InvalidOffset)" << endl;
+    }
+}
+
+void test_bulk_transfer() {
     cout << '\n' << __func__ << "\n========================" << endl;
-    auto myapp = new MyApplication(conn, "/com/example");
+    auto &context = getDefaultBusContext();
+    auto app = MyApplication(context, "/com/example/bulk");
+    auto &service = app.addService<BulkTransferService>(
+        0, bulk_transfer::SERVICE_UUID);
+
+    auto data = vector<u8>(100 * 1024);
+    for (auto i = size_t(0); i < data.size(); ++i) {
+        data[i] = u8(i * 31 + i / 256);
+    }
+    service.setData(data);
+
+    /* Own event loop, for notifications and acknowledgement replies */
+    auto client_context = BusContext(sdbus::createSystemBusConnection());
+    auto client = BulkTransferClient(
+        client_context.getConnection(), service.getDataPath(),
+        service.getControlPath(), context.getConnection().getUniqueName());
+
+    try {
+        auto received = client.download().get();
+        cout << "Received " << received.size() << " bytes (102400), same: "
+             << std::boolalpha << (received == data) << " (true), at "
+             << client.getStats().getThroughputKBps() << " KB/s" << endl;
+    } catch (const sdbus::Error &e) {
+        std::cerr << "Download failed: " << e.what() << endl;
+    }
+}
+
+void test_register_application() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto myapp = new MyApplication(getDefaultBusContext(), "/com/example");
 
     /* This service will intentionally fail to compile */
     // auto &service1 = myapp.addService<MyFailingService>("9RFE87NNS");
@@ -127,28 +323,95 @@ void test_register_application(sdbus::IConnection &conn) {
 
     cout << "Created application at path: " << myapp->getObjectPath() << endl;
 
-    // conn.enterEventLoop();
-    myapp->registerWithGattManager();
+    try {
+        myapp->registerWithGattManager().get();
+        cout << "Registered application: " << myapp->getObjectPath()
+             << " with GattManager" << endl;
+    } catch (sdbus::Error &e) {
+        std::cerr << "ERROR [RegisterApplication]: " << e.what() << endl;
+    }
+}
+
+void test_start_advertising() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    // ~/bluez-5.63/doc/advertising-api.txt
+    auto advertisement = Advertisement();
+    advertisement.setAdvertisedName("Naya naam")
+        .setServiceUuids({"180d"})
+        .setManufacturerData(0xffff, {0x00})
+        .setAppearance(0x0340);
+
+    /* Both registrations are in flight together */
+    auto second_advertisement =
+        Advertisement(getDefaultBusContext(), "/ble/ad1");
+    auto first = advertisement.turnOnAdvertising();
+    auto second = second_advertisement.turnOnAdvertising();
+    try {
+        first.get();
+        second.get();
+    } catch (sdbus::Error &e) {
+        std::cerr << "ERROR [RegisterAdvertisement]: " << e.what() << endl;
+    }
+
+    std::cout << "[Testcase] Will stop advertising after 6 seconds, for "
+                 "next tests to run, manufacturer data counts up every second"
+              << endl;
+    for (u8 i = 1; i <= 6; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        advertisement.setManufacturerData(0xffff, {i});
+    }
+}
+
+void test_advertisement_scheduler() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    /* 2 instances for 5 sets, so every set should get about 2/5th of the
+     * time */
+    auto scheduler = AdvertisementScheduler(
+        getDefaultBusContext(), std::chrono::milliseconds(500), 2);
+    for (u8 i = 0; i < 5; ++i) {
+        auto data = AdvertisingData();
+        data.local_name = "Set " + std::to_string(i);
+        data.manufacturer_data[0xffff] = {i};
+        scheduler.addSet(data);
+    }
 
-    cout << "Registered application: " << myapp->getObjectPath()
-         << " with GattManager" << endl;
+    try {
+        cout << "Instances: " << scheduler.start() << endl;
+    } catch (sdbus::Error &e) {
+        std::cerr << "ERROR [SupportedInstances]: " << e.what() << endl;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+    scheduler.stop();
+
+    for (const auto &air_time : scheduler.getAirTimes()) {
+        cout << "Set " << air_time.first << ": "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    air_time.second)
+                    .count()
+             << "ms" << endl;
+    }
 }
 
-void test_start_advertising(sdbus::IConnection &conn) {
+void test_advertising_payload() {
     cout << '\n' << __func__ << "\n========================" << endl;
-    std::thread([&conn]() {
-        std::cout << "[Testcase] Will stop advertising after 6 seconds, for "
-                     "next tests to run"
-                  << endl;
-        std::this_thread::sleep_for(std::chrono::seconds(6));
-        cout << "Changing name" << endl;
-        conn.leaveEventLoop();
-    }).detach();
+    auto data = AdvertisingData();
+    /* Flags only */
+    cout << "Empty: " << data.getPayloadSize() << " (3)" << endl;
+
+    /* 16 bit UUIDs share one AD structure, 128 bit one another */
+    data.service_uuids = {"180d", "0000180f-0000-1000-8000-00805F9B34FB",
+                          "12345678-1234-5678-1234-56789abcdef0"};
+    data.manufacturer_data[0xffff] = {1, 2, 3};
+    data.local_name = "abc";
+    data.includes = {"tx-power"};
+    cout << "Filled: " << data.getPayloadSize() << " (3 + 6 + 18 + 7 + 5 + 3)"
+         << endl;
 
-    // ~/bluez-5.63/doc/advertising-api.txt
-    auto advertisement = new Advertisement(conn);
-    advertisement->setAdvertisedName("Naya naam");
-    advertisement->turnOnAdvertising();
+    data.manufacturer_data[0xffff] = vector<u8>(20);
+    cout << "Fits legacy PDU: " << std::boolalpha
+         << (data.getPayloadSize() <= LEGACY_ADVERTISING_DATA_MAX_B)
+         << " (false)" << endl;
 }
 
 void test_create_root_object(sdbus::IConnection &conn) {
@@ -185,6 +448,28 @@ void test_start_ble_scan(sdbus::IConnection &conn) {
     }
 }
 
+/**
+ * @note PREREQUISIT: Scan should have found some devices
+ */
+void test_connection_manager() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto manager = ConnectionManager();
+    for (auto address : getAvailableBLEPeripherals()) {
+        manager.connect(address,
+                        [](BdAddr address, const sdbus::Error *error) {
+                            if (error) {
+                                cout << address << ": " << error->getMessage()
+                                     << endl;
+                            } else {
+                                cout << address << ": Connected" << endl;
+                            }
+                        });
+    }
+    manager.waitUntilIdle();
+    cout << manager.getConnectedDevices().size() << " devices connected"
+         << endl;
+}
+
 void test_turn_on_adapter() {
     cout << '\n' << __func__ << "\n========================" << endl;
     try {
@@ -196,19 +481,139 @@ void test_turn_on_adapter() {
     }
 }
 
+/* The other end of the socket pair stands in for bluez */
+void test_fd_link() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                   fds) == -1) {
+        std::cerr << "socketpair failed" << endl;
+        return;
+    }
+
+    auto read_promise = std::promise<vector<u8>>();
+    auto closed_promise = std::promise<void>();
+    auto link = FdLink::open(
+        fds[0], 23,
+        [&read_promise](const u8 *data, size_t size_b) {
+            read_promise.set_value(vector<u8>(data, data + size_b));
+        },
+        [&closed_promise]() { closed_promise.set_value(); });
+
+    const u8 written[] = {0xde, 0xad, 0xbe, 0xef};
+    (void)write(fds[1], written, sizeof(written));
+    auto read = read_promise.get_future();
+    if (read.wait_for(std::chrono::seconds(1)) != std::future_status::ready ||
+        read.get() != vector<u8>(written, written + sizeof(written))) {
+        std::cerr << "Write from bluez side not received" << endl;
+    }
+
+    const auto notification = vector<u8>{1, 2, 3};
+    link->send(notification.data(), notification.size());
+    u8 received[23];
+    auto received_b = std::max<ssize_t>(
+        recv(fds[1], received, sizeof(received), 0), 0);
+    cout << "Notification received: " << std::boolalpha
+         << (vector<u8>(received, received + received_b) == notification)
+         << endl;
+
+    (void)close(fds[1]);
+    auto closed = closed_promise.get_future();
+    cout << "Link closed on hangup: "
+         << (closed.wait_for(std::chrono::seconds(1)) ==
+             std::future_status::ready)
+         << endl;
+}
+
+/* Producer pushes faster than the consumer pops, nothing must be lost
+ * without being counted as dropped */
+void test_scan_event_ring() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    const auto EVENT_COUNT = 100000u;
+    auto ring = ScanEventRing(64, OverflowPolicy::DROP_OLDEST);
+
+    auto is_producing = std::atomic<bool>(true);
+    auto producer = std::thread([&ring, &is_producing, EVENT_COUNT]() {
+        auto event = ScanEvent();
+        for (auto i = 0u; i < EVENT_COUNT; ++i) {
+            event.timestamp_ns = i;
+            ring.push(event);
+        }
+        is_producing = false;
+    });
+
+    auto popped = 0u;
+    auto last_timestamp_ns = u64(0);
+    auto is_ordered = true;
+    auto event = ScanEvent();
+    while (true) {
+        /* Read before popping, so an empty pop after it means all is popped */
+        auto was_producing = is_producing.load();
+        if (ring.tryPop(event)) {
+            is_ordered &= popped == 0 || event.timestamp_ns > last_timestamp_ns;
+            last_timestamp_ns = event.timestamp_ns;
+            ++popped;
+        } else if (!was_producing) {
+            break;
+        }
+    }
+    producer.join();
+
+    cout << "Popped: " << popped << ", dropped: " << ring.getDroppedCount()
+         << ", all accounted for: " << std::boolalpha
+         << (popped + ring.getDroppedCount() == EVENT_COUNT)
+         << ", in order: " << is_ordered << endl;
+}
+
+/* A vector back in the pool is reused, with its capacity, and one still
+ * shared by a ValueBuffer is not */
+void test_value_buffer() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto pool = ValueBufferPool(2);
+
+    auto first = pool.acquire();
+    first->assign(512, 0xa5);
+    auto first_bytes = first.get();
+    auto shared = ValueBuffer(std::move(first));
+    auto copy = shared;
+
+    auto second = pool.acquire();
+    auto is_not_reused_while_shared = second.get() != first_bytes;
+    second.reset();
+
+    shared = ValueBuffer();
+    copy = ValueBuffer();
+    auto again = pool.acquire();
+    auto is_reused = again.get() == first_bytes;
+
+    cout << "Not reused while shared: " << std::boolalpha
+         << is_not_reused_while_shared << ", reused: " << is_reused
+         << ", empty: " << again->empty()
+         << ", capacity kept: " << (again->capacity() >= 512) << endl;
+}
+
 void test_func() {
     auto conn = sdbus::createSystemBusConnection(); //"me.adig"
     cout << "Connection's unique name: " << conn->getUniqueName() << endl;
 
+    test_fd_link();
+    test_scan_event_ring();
+    test_value_buffer();
     test_turn_on_adapter();
     test_create_root_object(*conn);
 
     // peripheral
-    test_start_advertising(*conn);
-    test_register_application(*conn);
+    test_advertising_payload();
+    test_start_advertising();
+    test_advertisement_scheduler();
+    test_register_application();
+    test_long_read();
+    test_long_write();
+    test_bulk_transfer();
 
     // central
     test_start_ble_scan(*conn);
+    test_connection_manager();
 
     cout << "Going to infinite wait... can close or use gdbus/dbus-send to "
             "introspect the above unique name"
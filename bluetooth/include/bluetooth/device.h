@@ -12,9 +12,11 @@
 
 #include <iostream>
 #include <map>
-#include <regex>
+#include <optional>
 #include <string>
 
+#include "bdaddr.h"
+#include "bus_context.h"
 #include "sdbus-c++/sdbus-c++.h"
 
 using std::map, std::string, std::cout, std::endl;
@@ -24,58 +26,34 @@ using std::map, std::string, std::cout, std::endl;
  *
  * @pre Device should already be discovered
  *
+ * @note Answered from the context's DeviceNameIndex, so it neither costs a
+ * D-Bus call nor scans every device
+ *
  * @param device_name Device name/alias (Case-Insensitive), can also be
  * substring of the name
  *
+ * @param context Bus context to use, by default the shared system bus one
+ *
  * @note Can be modified to take adapter path also
  *
- * @return std::string Address of first matching device found is returned
+ * @return Address of first matching device found, std::nullopt if none
  */
-inline std::string get_device_address_by_name(std::string device_name) {
-    // Ignore case
-    for (auto &c : device_name) {
-        c = tolower(c);
-    }
-
-    auto actual_name = string();
-    auto address = string();
-    auto result =
-        std::map<sdbus::ObjectPath,
-                 std::map<string, std::map<string, sdbus::Variant>>>();
-
-    sdbus::createProxy("org.bluez", "/")
-        ->callMethod("GetManagedObjects")
-        .onInterface("org.freedesktop.DBus.ObjectManager")
-        .storeResultsTo(result);
-
-    for (auto &p : result) {
-        if (p.first.find("/org/bluez/hci0/dev_") == 0 &&
-            p.first.length() ==
-                sizeof("/org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX") - 1) {
-            // It is a device, can also use regex instead of those
-            auto name = p.second["org.bluez.Device1"]["Alias"].get<string>();
-            const auto &addr =
-                p.second["org.bluez.Device1"]["Address"].get<string>();
-
-            // Ignore case
-            for (auto &c : name) {
-                c = tolower(c);
-            }
-
-            if (name.find(device_name) != string::npos) {
-                // `device_name` matched a substring in name
-                cout << "Actual Name: " << name << endl;
-                cout << "Address: " << addr << endl;
-
-                return addr;
-            }
-        }
+inline std::optional<BdAddr>
+get_device_address_by_name(const std::string &device_name,
+                           BusContext &context = getDefaultBusContext()) {
+    auto device = context.getDeviceNameIndex().findFirstBySubstring(
+        device_name, "/org/bluez/hci0");
+    if (!device) {
+        cout << "ERROR: Couldn't find a device with matching name: "
+             << device_name << endl;
+        return std::nullopt;
     }
 
-    cout << "ERROR: Couldn't find a device with matching name: " << device_name
-         << endl;
-
-    return "";
+#ifdef VERBOSE_DEBUG
+    cout << "Device: " << device->device_path << endl;
+    cout << "Address: " << device->address << endl;
+#endif
+    return device->address;
 }
 
 /**
@@ -83,68 +61,48 @@ inline std::string get_device_address_by_name(std::string device_name) {
  *
  * @pre Device may need to be already paired
  *
- * @param address Address in form of eg. XX:XX:XX:XX:XX:XX
+ * @param address Address of the device, eg. BdAddr::parse("XX:XX:XX:XX:XX:XX")
  * @param adapter_path Path to adapter, with which the device is registered, for
  * most the default is a safe option, which is "/org/bluez/hci0"
+ * @param context Bus context to use, by default the shared system bus one
  */
 inline void
-connect_to_device_using_address(std::string address,
-                                string adapter_path = "/org/bluez/hci0") {
-    if (std::regex_match(
-            address,
-            /*regex pattern to match a valid address, may require updation*/
-            std::regex(
-                "([\\[0-9\\]\\[A-F\\]]{2}:){5}[\\[0-9\\]\\[A-F\\]]{2}"))) {
-
-        cout << "Matched: " << address << endl;
-        std::replace(address.begin(), address.end(), ':', '_');
-
-        auto device_path = adapter_path + "/dev_" + address;
-        auto device = sdbus::createProxy("org.bluez", device_path);
-        try {
-            device->callMethod("Connect")
-                .onInterface("org.bluez.Device1")
-                .withTimeout(std::chrono::seconds(1));
-        } catch (sdbus::Error &e) {
-            std::cerr << "ERROR: " << e.what() << endl;
-            return;
-        }
-    } else {
-        cout << "Invalid address: " << address
-             << ". Address should be of the form: XX:XX:XX:XX:XX:XX" << endl;
+connect_to_device_using_address(BdAddr address,
+                                const string &adapter_path = "/org/bluez/hci0",
+                                BusContext &context = getDefaultBusContext()) {
+    auto device = context.createBluezProxy(address.toObjectPath(adapter_path));
+    try {
+        device->callMethod("Connect")
+            .onInterface("org.bluez.Device1")
+            .withTimeout(std::chrono::seconds(1));
+    } catch (sdbus::Error &e) {
+        std::cerr << "ERROR: " << e.what() << endl;
+        return;
     }
 }
 
 /**
  * @brief Disconnect
  *
- * @param address Address in form of eg. XX:XX:XX:XX:XX:XX
+ * @param address Address of the device, eg. BdAddr::parse("XX:XX:XX:XX:XX:XX")
  * @param adapter_path Path to adapter, with which the device is registered, for
  * most the default is a safe option, which is "/org/bluez/hci0"
+ * @param context Bus context to use, by default the shared system bus one
  */
 inline void disconnect_from_device_using_address(
-    std::string address, std::string adapter_path = "/org/bluez/hci0") {
-    if (std::regex_match(
-            address,
-            /*regex pattern to match a valid address, may require updation*/
-            std::regex(
-                "([\\[0-9\\]\\[A-F\\]]{2}:){5}[\\[0-9\\]\\[A-F\\]]{2}"))) {
-
-        cout << "[Disconnect] Matched: " << address << endl;
-        std::replace(address.begin(), address.end(), ':', '_');
-
-        auto device_path = adapter_path + "/dev_" + address;
-        auto device = sdbus::createProxy("org.bluez", device_path);
-        device->callMethod("Disconnect").onInterface("org.bluez.Device1");
-        cout << "Disconnected: " << address << endl;
-    } else {
-        cout << "Invalid address: " << address
-             << ". Address should be of the form: XX:XX:XX:XX:XX:XX" << endl;
-    }
+    BdAddr address, const std::string &adapter_path = "/org/bluez/hci0",
+    BusContext &context = getDefaultBusContext()) {
+    auto device = context.createBluezProxy(address.toObjectPath(adapter_path));
+    device->callMethod("Disconnect").onInterface("org.bluez.Device1");
+    cout << "Disconnected: " << address << endl;
 }
 
 inline void
 connect_to_device_using_name(std::string name,
-                             string _adapter_path = "/org/bluez/hci0") {
-    connect_to_device_using_address(get_device_address_by_name(name));
+                             string _adapter_path = "/org/bluez/hci0",
+                             BusContext &context = getDefaultBusContext()) {
+    auto address = get_device_address_by_name(name, context);
+    if (address) {
+        connect_to_device_using_address(*address, _adapter_path, context);
+    }
 }
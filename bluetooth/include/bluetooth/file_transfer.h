@@ -13,6 +13,8 @@
 
 #include <string>
 
+#include "bdaddr.h"
+
 /**
  * @brief Send a file to a connected device, and intentionally blocks till the
  * transfer is complete or errors
@@ -24,13 +26,18 @@
  * ObjectPush (opp) which provides a simple SendFile method
  * More info on this is in bluez/doc/obex-api.txt in the bluez source code
  *
- * @param remote_device_address Address of the connected device (in the form of
- * eg. "XX:XX:XX:XX:XX:XX")
+ * @param remote_device_address Address of the connected device
  * @param local_filepath Filepath of the file to send, this can be a relative
  * path or an absolute path
+ *
+ * @throw sdbus::Error if the session couldn't be created, or the transfer
+ * failed
+ *
+ * @note Sets up an OBEX session per call, use an ObexSession to send many
+ * files to one device
  */
-void sendFile(const std::string &remote_device_address,
+void sendFile(BdAddr remote_device_address,
               const std::string &local_filepath);
 
-/* For recieving, there is org.bluez.obex.FileTransfer.GetFile, but not doing it
- * now not required*/
+/* For recieving, ObexSession::getFile() gets files from a device
+ * (FileTransfer1.GetFile), and an ObexReceiver accepts the ones it pushes */
@@ -11,6 +11,9 @@
 
 #include "device.h"
 #include "file_transfer.h"
+#include "obex_receiver.h"
+#include "obex_session.h"
+#include "transfer_dispatcher.h"
 
 /**
  * @references:
@@ -0,0 +1,133 @@
+/**
+ * @file obex_receiver.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Accepts files pushed by devices, as obexd's agent
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "bdaddr.h"
+#include "declarations.h"
+#include "obex_session.h"
+#include "sdbus-c++/sdbus-c++.h"
+#include "timer_queue.h"
+#include "transfer_handle.h"
+
+/**
+ * @brief A file a device is pushing
+ */
+struct IncomingPush {
+    /* Of the sending device, 00:00:00:00:00:00 if obexd didn't say */
+    BdAddr address;
+    /* As the device named it */
+    std::string name;
+    /* Where it is stored, in the receive folder, the name made unique */
+    std::string local_path;
+    /* 0 if the device didn't say */
+    u64 size_b = 0;
+};
+
+using ReceiveCallback = std::function<void(const IncomingPush &push,
+                                           const TransferProgress &progress)>;
+
+struct ObexReceiverConfig {
+    /* Where pushed files are stored, obexd must be able to write there */
+    std::string receive_dir = ".";
+    /* Whether to accept a push, null accepts all. Called on the receiver's
+     * own thread, so it may block (eg. to ask), till obexd gives up */
+    std::function<bool(const IncomingPush &push)> authorize;
+    /* Every update of an accepted push, and once at its end (status
+     * "complete" or "error"), on the event loop thread, so it must not
+     * block */
+    ReceiveCallback on_progress;
+};
+
+/**
+ * @brief Registers as obexd's org.bluez.obex.Agent1, and stores the files
+ * devices push (Object Push) in the receive folder
+ *
+ * obexd writes each file straight to its place, no temporary copy. Its disk
+ * space is reserved up front, if the device said the size, so a push that
+ * doesn't fit fails at the start, not at the end
+ *
+ * @note obexd takes one agent at a time, so only one receiver (in any
+ * program) can be registered
+ *
+ * @references: obex-api.txt -> AgentManager1, Agent1, Transfer1
+ */
+class ObexReceiver {
+    struct Incoming {
+        IncomingPush push;
+        std::shared_ptr<internal::TransferState> state;
+    };
+
+    sdbus::IConnection &connection;
+    ObexReceiverConfig config;
+    sdbus::ObjectPath agent_path;
+
+    mutable std::mutex mutex;
+    /* Accepted, by transfer object path, till complete or error */
+    std::map<std::string, Incoming> transfers;
+
+    u64 completed_b = 0;
+    unsigned int files_completed = 0;
+    unsigned int files_failed = 0;
+    std::chrono::steady_clock::duration busy{};
+    std::chrono::steady_clock::time_point busy_since;
+
+    /* Authorizing, and reserving disk, off the event loop thread */
+    std::unique_ptr<TimerQueue> timers;
+
+    /* Last members, so no call or signal comes in while the rest is
+     * destroyed */
+    std::unique_ptr<sdbus::IObject> agent;
+    sdbus::Slot properties_changed_slot;
+
+    void authorize_push(const sdbus::Result<std::string> &result,
+                        const sdbus::ObjectPath &transfer_path);
+    std::string make_local_path(const std::string &name) const;
+    void on_properties_changed(sdbus::Message &msg);
+    void preallocate(const std::string &transfer_path,
+                     const std::string &local_path, u64 size_b);
+
+  public:
+    /**
+     * @brief Register the agent, pushes are accepted from then on
+     *
+     * @param connection Session bus connection, with its event loop running
+     * (eg. getSessionBusContext().getConnection())
+     * @param agent_path Object path to export the agent at
+     *
+     * @throw sdbus::Error if obexd refuses, eg. another agent is registered
+     */
+    ObexReceiver(sdbus::IConnection &connection,
+                 ObexReceiverConfig config = ObexReceiverConfig(),
+                 const std::string &agent_path = "/bluetooth/obex_agent");
+
+    /**
+     * @brief Unregister the agent, pushes in progress go on, but aren't
+     * followed any more
+     */
+    ~ObexReceiver();
+
+    ObexReceiver(const ObexReceiver &) = delete;
+    ObexReceiver &operator=(const ObexReceiver &) = delete;
+
+    /**
+     * @brief Pushes accepted, and not yet complete
+     */
+    size_t getActiveCount() const;
+
+    ObexSessionStats getStats() const;
+};
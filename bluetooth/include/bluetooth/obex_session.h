@@ -0,0 +1,213 @@
+/**
+ * @file obex_session.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief One OBEX session to a device, reused for any number of files
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bdaddr.h"
+#include "declarations.h"
+#include "sdbus-c++/sdbus-c++.h"
+#include "timer_queue.h"
+#include "transfer_handle.h"
+
+/**
+ * @brief Totals of all files sent by a session
+ */
+struct ObexSessionStats {
+    /* Of completed files, and so far of the ones in progress */
+    u64 transferred_b = 0;
+    unsigned int files_completed = 0;
+    unsigned int files_failed = 0;
+    /* Time any file was queued or being sent, so idle time doesn't lower the
+     * throughput */
+    std::chrono::steady_clock::duration busy{};
+
+    double getThroughputKBps() const {
+        auto busy_s = std::chrono::duration<double>(busy).count();
+        if (busy_s <= 0) {
+            return 0;
+        }
+        return transferred_b / 1024.0 / busy_s;
+    }
+};
+
+/**
+ * @brief OBEX service the session connects to, Object Push only takes files,
+ * File Transfer also browses the device's folders, and gives files
+ */
+enum class ObexTarget { OBJECT_PUSH, FILE_TRANSFER };
+
+/**
+ * @brief One entry of FileTransfer1.ListFolder
+ */
+struct ObexFolderEntry {
+    std::string name;
+    bool is_folder = false;
+    /* 0 for folders, or if the device didn't say */
+    u64 size_b = 0;
+};
+
+/**
+ * @brief Keeps an org.bluez.obex.Session1 open to a device, and sends the
+ * files queued with sendFile() one after other over it
+ *
+ * Session setup (CreateSession, ie. connecting the OBEX channel) is paid once,
+ * not per file. The next file is handed to obexd while the current one is
+ * being sent, so it starts as soon as the current completes
+ *
+ * With ObexTarget::FILE_TRANSFER, files are also got from the device with
+ * getFile(), queued along with the ones sent. obexd writes them straight to
+ * their local path, whose disk space is reserved once the size is known
+ *
+ * @references: obex-api.txt -> Client1, Session1, ObjectPush1, FileTransfer1,
+ * Transfer1
+ */
+class ObexSession : private internal::TransferOwner {
+    using State = std::shared_ptr<internal::TransferState>;
+
+    sdbus::IConnection &connection;
+    BdAddr address;
+    ObexTarget target;
+    sdbus::ObjectPath session_path;
+
+    /* Lock before any transfer's lock, never after */
+    mutable std::mutex mutex;
+    std::deque<State> queue;
+    /* SendFile called, waiting for its reply */
+    std::vector<State> sending;
+    /* By transfer object path, till complete or error */
+    std::map<std::string, State> transfers;
+
+    u64 completed_b = 0;
+    unsigned int files_completed = 0;
+    unsigned int files_failed = 0;
+    std::chrono::steady_clock::duration busy{};
+    std::chrono::steady_clock::time_point busy_since;
+
+    /* Called after each file is done, outside the lock */
+    std::function<void()> on_file_done;
+
+    /* Deadlines, and cancels that mustn't block the event loop */
+    std::unique_ptr<TimerQueue> timers;
+
+    /* Last members, so no reply or signal comes in while the rest is
+     * destroyed */
+    std::unique_ptr<sdbus::IProxy> session;
+    sdbus::Slot properties_changed_slot;
+
+    /* For TransferDispatcher, which created the session itself, and routes
+     * its signals */
+    friend class TransferDispatcher;
+    ObexSession(sdbus::IConnection &connection, BdAddr address,
+                ObexTarget target, sdbus::ObjectPath session_path);
+    void enqueue(const State &state);
+    TransferHandle queue_transfer(const State &state,
+                                  std::chrono::milliseconds timeout_ms);
+    void on_properties_changed(sdbus::Message &msg);
+
+    bool is_busy() const;
+    void update_busy();
+    void pump();
+    void on_sent(const State &state, const sdbus::Error *error,
+                 const sdbus::ObjectPath &transfer,
+                 const std::map<std::string, sdbus::Variant> &properties);
+    void on_transfer_done(const std::string &transfer_path,
+                          std::exception_ptr error);
+    void finish(const State &state, std::exception_ptr error);
+    void preallocate(const State &state, u64 size_b);
+    void require_file_transfer() const;
+
+    bool cancel_transfer(const State &state,
+                         const std::string &reason) override;
+    void call_transfer(const State &state, const char *method) override;
+
+  public:
+    /**
+     * @brief Connect the OBEX session, blocks till it is (or fails)
+     *
+     * @param connection Session bus connection, with its event loop running
+     * (eg. getSessionBusContext().getConnection())
+     * @param address Address of the connected device
+     *
+     * @throw sdbus::Error if CreateSession fails, eg. device not reachable
+     */
+    ObexSession(sdbus::IConnection &connection, BdAddr address,
+                ObexTarget target = ObexTarget::OBJECT_PUSH);
+
+    /**
+     * @brief Closes the session (RemoveSession), files still queued or being
+     * sent fail
+     */
+    ~ObexSession();
+
+    ObexSession(const ObexSession &) = delete;
+    ObexSession &operator=(const ObexSession &) = delete;
+
+    /**
+     * @brief Queue a file, doesn't block
+     *
+     * @param local_filepath Relative or absolute path of the file
+     * @param options Progress callback and deadline
+     *
+     * @return Handle to follow the transfer with, or cancel, suspend or
+     * resume it
+     */
+    TransferHandle sendFile(const std::string &local_filepath,
+                            TransferOptions options = TransferOptions());
+
+    /**
+     * @brief Queue getting a file from the device's current folder, doesn't
+     * block, FILE_TRANSFER only
+     *
+     * @param remote_name Name of the file in the current folder
+     * @param local_filepath Where to store it, replaced if it exists
+     *
+     * @throw sdbus::Error org.bluez.obex.Error.NotSupported on an
+     * OBJECT_PUSH session
+     */
+    TransferHandle getFile(const std::string &remote_name,
+                           const std::string &local_filepath,
+                           TransferOptions options = TransferOptions());
+
+    /**
+     * @brief Entries of the device's current folder, blocks, after the
+     * transfers queued in obexd so far, FILE_TRANSFER only
+     *
+     * @throw sdbus::Error if not FILE_TRANSFER, or the device refuses
+     */
+    std::vector<ObexFolderEntry> listFolder();
+
+    /**
+     * @brief Change the device's current folder, blocks, FILE_TRANSFER only
+     *
+     * @param folder Name of a sub folder, or ".." for the parent
+     *
+     * @throw sdbus::Error if not FILE_TRANSFER, or no such folder
+     */
+    void changeFolder(const std::string &folder);
+
+    /**
+     * @brief Files queued or being sent
+     */
+    size_t getPendingCount() const;
+
+    ObexSessionStats getStats() const;
+
+    BdAddr getAddress() const { return address; }
+};
@@ -0,0 +1,144 @@
+/**
+ * @file transfer_dispatcher.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Sends files to many devices at once, over one session bus
+ * connection
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "bdaddr.h"
+#include "bus_context.h"
+#include "obex_session.h"
+#include "timer_queue.h"
+#include "transfer_handle.h"
+
+struct TransferDispatcherConfig {
+    /* Devices sent to at once, per adapter, each is an OBEX connection the
+     * adapter has to schedule */
+    unsigned int max_sessions_per_adapter = 4;
+    /* Files sent to a device in one go, before it makes way for a device
+     * waiting on the same adapter, 0 for no limit */
+    unsigned int max_files_per_turn = 8;
+};
+
+/**
+ * @brief Queues files for any number of devices, and sends to a few devices
+ * per adapter at a time, one ObexSession each
+ *
+ * All sessions share one connection (and event loop thread), and one
+ * PropertiesChanged match, routed to the session by the transfer's path.
+ * Devices take turns on their adapter, in the order they started waiting, so
+ * a device with many files doesn't hold up the rest
+ *
+ * The adapter of a device is looked up in the system bus object tree, and
+ * passed as "Source" to CreateSession
+ */
+class TransferDispatcher : private internal::TransferOwner {
+    using State = std::shared_ptr<internal::TransferState>;
+
+    struct Device {
+        /* Address of its adapter, empty if not found (obexd picks one) */
+        std::string adapter;
+        std::deque<State> queue;
+        std::shared_ptr<ObexSession> session;
+        /* Handed to the session, and not done yet */
+        unsigned int in_session = 0;
+        /* Handed to the session since it opened */
+        unsigned int turn_count = 0;
+        bool is_opening = false;
+        bool is_waiting = false;
+    };
+
+    struct Adapter {
+        unsigned int session_count = 0;
+        std::deque<BdAddr> waiting;
+    };
+
+    sdbus::IConnection &connection;
+    BusContext &system_context;
+    TransferDispatcherConfig config;
+
+    mutable std::mutex mutex;
+    std::map<BdAddr, Device> devices;
+    std::map<std::string, Adapter> adapters;
+    /* Open sessions by object path, to route signals */
+    std::map<std::string, std::shared_ptr<ObexSession>> sessions;
+
+    /* Of sessions already closed, and files that never reached one, `busy`
+     * is of the dispatcher, ie. while any device was known */
+    ObexSessionStats closed_stats;
+    std::chrono::steady_clock::time_point busy_since;
+
+    /* Deadlines, and closing sessions off the event loop thread */
+    std::unique_ptr<TimerQueue> timers;
+
+    /* Last members, so no reply or signal comes in while the rest is
+     * destroyed */
+    std::unique_ptr<sdbus::IProxy> obex;
+    sdbus::Slot properties_changed_slot;
+
+    void pump();
+    void close_session(std::shared_ptr<ObexSession> session);
+    void release_session(std::shared_ptr<ObexSession> session);
+    void open_session(BdAddr address, const std::string &adapter);
+    void on_session_created(BdAddr address, const sdbus::Error *error,
+                            const sdbus::ObjectPath &session_path);
+    void on_file_done(BdAddr address);
+    void on_properties_changed(sdbus::Message &msg);
+
+    bool cancel_transfer(const State &state,
+                         const std::string &reason) override;
+    void call_transfer(const State &state, const char *method) override;
+
+  public:
+    /**
+     * @param connection Session bus connection, with its event loop running
+     * (eg. getSessionBusContext().getConnection())
+     * @param system_context Used to find each device's adapter
+     */
+    TransferDispatcher(
+        sdbus::IConnection &connection,
+        TransferDispatcherConfig config = TransferDispatcherConfig(),
+        BusContext &system_context = getDefaultBusContext());
+
+    /**
+     * @brief Closes all sessions, files not yet sent fail
+     */
+    ~TransferDispatcher();
+
+    TransferDispatcher(const TransferDispatcher &) = delete;
+    TransferDispatcher &operator=(const TransferDispatcher &) = delete;
+
+    /**
+     * @brief Queue a file for `address`, doesn't block
+     *
+     * @return Handle to follow the transfer with, suspend and resume work
+     * only once it reached its device's session
+     */
+    TransferHandle send(BdAddr address, const std::string &local_filepath,
+                        TransferOptions options = TransferOptions());
+
+    /**
+     * @brief Files not yet sent (or failed)
+     */
+    size_t getPendingCount() const;
+
+    size_t getOpenSessionCount() const;
+
+    /**
+     * @brief Totals over all devices, `busy` is the time any file was
+     * pending, so throughput is of all sessions together
+     */
+    ObexSessionStats getStats() const;
+};
@@ -0,0 +1,172 @@
+/**
+ * @file transfer_handle.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Handle to follow and control one OBEX transfer, without blocking on
+ * it
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "declarations.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+/**
+ * @brief Where a transfer is, as of its last update from obexd
+ */
+struct TransferProgress {
+    /* "queued", "active", "suspended", "complete" or "error" */
+    std::string status = "queued";
+    u64 transferred_b = 0;
+    /* 0 if obexd didn't say */
+    u64 size_b = 0;
+    /* Between the last two updates, and since the transfer went active */
+    double current_KBps = 0;
+    double average_KBps = 0;
+    /* At the current rate, none till there is a rate, or size is known */
+    std::optional<std::chrono::steady_clock::duration> eta;
+};
+
+using ProgressCallback = std::function<void(const TransferProgress &progress)>;
+
+struct TransferOptions {
+    /* Called on every update, and once at the end, on the event loop thread,
+     * so it must not block */
+    ProgressCallback on_progress;
+    /* From sendFile(), including time queued, after which the transfer is
+     * cancelled, 0 for none */
+    std::chrono::milliseconds timeout_ms{0};
+};
+
+namespace internal {
+struct TransferState;
+
+/* Whoever has the transfer now, a dispatcher's queue, then a session */
+class TransferOwner {
+  public:
+    /* false if it doesn't own `state` (any more) */
+    virtual bool cancel_transfer(const std::shared_ptr<TransferState> &state,
+                                 const std::string &reason) = 0;
+    virtual void call_transfer(const std::shared_ptr<TransferState> &state,
+                               const char *method) = 0;
+
+  protected:
+    ~TransferOwner() = default;
+};
+
+/* Shared by the handles, and the owner sending the file */
+struct TransferState {
+    std::mutex mutex;
+    std::promise<void> promise;
+    std::shared_future<void> future;
+    ProgressCallback on_progress;
+    TransferOwner *owner = nullptr;
+    std::string local_path;
+    /* Name on the device, of a file got or put with FileTransfer1 */
+    std::string remote_name;
+    /* obexd writes local_path, instead of reading it */
+    bool is_receive = false;
+    bool is_preallocated = false;
+
+    /* Object path of org.bluez.obex.Transfer1, empty till SendFile replies */
+    std::string transfer_path;
+    /* Cancelled before SendFile replied, cancelled once it does */
+    std::optional<std::string> cancel_reason;
+    bool is_done = false;
+
+    TransferProgress progress;
+    std::chrono::steady_clock::time_point active_at;
+    std::chrono::steady_clock::time_point sampled_at;
+    u64 sampled_b = 0;
+};
+
+std::shared_ptr<TransferState>
+make_transfer_state(const std::string &path, ProgressCallback on_progress);
+
+/* Settle the transfer's future, once, complete if `error` is null */
+void finish_transfer(const std::shared_ptr<TransferState> &state,
+                     std::exception_ptr error);
+
+/* Through whoever owns it when called */
+void cancel_transfer(const std::shared_ptr<TransferState> &state,
+                     const std::string &reason);
+
+/* Apply Transfer1 properties (from a reply, or PropertiesChanged), with the
+ * state's lock held, returns the new Status, empty if it didn't change */
+std::string
+update_transfer(TransferState &state,
+                const std::map<std::string, sdbus::Variant> &properties);
+
+/* Bytes to reserve for a file being received, once its size is known and
+ * obexd is writing it, 0 if nothing (more) to do, with the lock held */
+u64 take_preallocation(TransferState &state);
+
+/* Reserve disk for the whole of a file obexd is writing, without changing
+ * its size, so it isn't fragmented, and a full disk fails it at the start
+ *
+ * 0, or the errno, eg. ENOSPC, or EOPNOTSUPP if the filesystem can't */
+int preallocate_file(const std::string &path, u64 size_b);
+} // namespace internal
+
+/**
+ * @brief Returned by ObexSession::sendFile() and TransferDispatcher::send(),
+ * copies refer to the same transfer
+ *
+ * @note Control functions (cancel, suspend, resume) must not be called after
+ * the session (or dispatcher) is destroyed, the rest can. They block on
+ * obexd, so don't call them from the progress callback either
+ */
+class TransferHandle {
+    std::shared_ptr<internal::TransferState> state;
+
+    void call(const char *method);
+
+  public:
+    explicit TransferHandle(std::shared_ptr<internal::TransferState> state);
+
+    /**
+     * @brief Ready once the transfer completes, `get()` throws sdbus::Error
+     * if it failed, was cancelled, or its deadline passed
+     */
+    std::shared_future<void> getFuture() const;
+
+    /**
+     * @brief Block till done, throws same as getFuture().get()
+     */
+    void wait() const;
+
+    bool isDone() const;
+
+    TransferProgress getProgress() const;
+
+    const std::string &getLocalPath() const;
+
+    /**
+     * @brief Stop the transfer, its future fails with
+     * org.bluez.obex.Error.Failed, does nothing if already done
+     */
+    void cancel();
+
+    /**
+     * @brief Pause and continue the transfer (Transfer1.Suspend/Resume),
+     * blocks for obexd's reply
+     *
+     * @throw sdbus::Error org.bluez.obex.Error.NotInProgress if the transfer
+     * isn't with obexd (still queued, or done), or obexd's error
+     */
+    void suspend();
+    void resume();
+};
@@ -0,0 +1,318 @@
+/**
+ * @file obex_receiver.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of ObexReceiver
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "bluetooth/obex_receiver.h"
+
+using std::string, std::map, std::vector;
+
+namespace fs = std::filesystem;
+
+namespace {
+const auto OBEX_SERVICE = "org.bluez.obex";
+const auto OBEX_AGENT_MANAGER_IFACE = "org.bluez.obex.AgentManager1";
+const auto OBEX_AGENT_IFACE = "org.bluez.obex.Agent1";
+const auto OBEX_SESSION_IFACE = "org.bluez.obex.Session1";
+const auto OBEX_TRANSFER_IFACE = "org.bluez.obex.Transfer1";
+const auto PROPERTIES_IFACE = "org.freedesktop.DBus.Properties";
+
+void register_agent(sdbus::IConnection &connection, const char *method,
+                    const sdbus::ObjectPath &agent_path) {
+    sdbus::createProxy(connection, OBEX_SERVICE, "/org/bluez/obex")
+        ->callMethod(method)
+        .onInterface(OBEX_AGENT_MANAGER_IFACE)
+        .withArguments(agent_path);
+}
+} // namespace
+
+ObexReceiver::ObexReceiver(sdbus::IConnection &connection,
+                           ObexReceiverConfig config,
+                           const string &agent_path)
+    : connection(connection), config(std::move(config)),
+      agent_path(agent_path), timers(std::make_unique<TimerQueue>()),
+      agent(sdbus::createObject(connection, agent_path)) {
+    agent->registerMethod("Release")
+        .onInterface(OBEX_AGENT_IFACE)
+        .implementedAs([]() {});
+    agent->registerMethod("AuthorizePush")
+        .onInterface(OBEX_AGENT_IFACE)
+        .withInputParamNames("transfer")
+        .withOutputParamNames("path")
+        .implementedAs([this](sdbus::Result<string> &&result,
+                              sdbus::ObjectPath transfer_path) {
+            /* Looking up the transfer blocks, and so may `authorize` */
+            auto shared_result =
+                std::make_shared<sdbus::Result<string>>(std::move(result));
+            timers->scheduleAfter(
+                std::chrono::milliseconds(0),
+                [this, shared_result, transfer_path]() {
+                    authorize_push(*shared_result, transfer_path);
+                });
+        });
+    /* obexd gave up on a push we didn't answer yet, our answer is ignored */
+    agent->registerMethod("Cancel")
+        .onInterface(OBEX_AGENT_IFACE)
+        .implementedAs([]() {});
+    agent->finishRegistration();
+
+    /* Server side transfers are under the server's sessions */
+    properties_changed_slot = connection.addMatch(
+        "type='signal',sender='org.bluez.obex',"
+        "path_namespace='/org/bluez/obex/server',"
+        "interface='org.freedesktop.DBus.Properties',"
+        "member='PropertiesChanged'",
+        [this](sdbus::Message &msg) { on_properties_changed(msg); });
+
+    register_agent(connection, "RegisterAgent", this->agent_path);
+}
+
+ObexReceiver::~ObexReceiver() {
+    try {
+        register_agent(connection, "UnregisterAgent", agent_path);
+    } catch (const sdbus::Error &e) {
+#ifdef VERBOSE_DEBUG
+        std::cerr << "UnregisterAgent failed: " << e.what() << std::endl;
+#endif
+    }
+
+    /* So a signal still coming in finds nothing to do */
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        transfers.clear();
+    }
+    properties_changed_slot.reset();
+    agent.reset();
+    /* Pushes not yet answered get no answer, obexd times them out */
+    timers.reset();
+}
+
+void ObexReceiver::authorize_push(const sdbus::Result<string> &result,
+                                  const sdbus::ObjectPath &transfer_path) {
+    auto push = IncomingPush();
+    try {
+        auto properties = map<string, sdbus::Variant>();
+        sdbus::createProxy(connection, OBEX_SERVICE, transfer_path)
+            ->callMethod("GetAll")
+            .onInterface(PROPERTIES_IFACE)
+            .withArguments(OBEX_TRANSFER_IFACE)
+            .storeResultsTo(properties);
+
+        auto name = properties.find("Name");
+        if (name != properties.end()) {
+            push.name = name->second.get<string>();
+        }
+        auto size = properties.find("Size");
+        if (size != properties.end()) {
+            push.size_b = size->second.get<u64>();
+        }
+        auto session = properties.find("Session");
+        if (session != properties.end()) {
+            auto destination =
+                sdbus::createProxy(connection, OBEX_SERVICE,
+                                   session->second.get<sdbus::ObjectPath>())
+                    ->getProperty("Destination")
+                    .onInterface(OBEX_SESSION_IFACE);
+            push.address = BdAddr::parse(destination.get<string>())
+                               .value_or(BdAddr());
+        }
+    } catch (const sdbus::Error &e) {
+        /* Eg. the device already gave up */
+        result.returnError(e);
+        return;
+    }
+
+    push.local_path = make_local_path(push.name);
+    if (config.authorize && !config.authorize(push)) {
+        result.returnError(sdbus::Error("org.bluez.obex.Error.Rejected",
+                                        "Not authorized"));
+        return;
+    }
+
+    auto on_progress = ProgressCallback();
+    if (config.on_progress) {
+        on_progress = [on_progress = config.on_progress,
+                       push](const TransferProgress &progress) {
+            on_progress(push, progress);
+        };
+    }
+    auto state =
+        internal::make_transfer_state(push.local_path, std::move(on_progress));
+    state->is_receive = true;
+    state->transfer_path = transfer_path;
+    state->progress.size_b = push.size_b;
+
+    {
+        /* Before answering, so none of its signals is missed */
+        std::lock_guard<std::mutex> lock(mutex);
+        if (transfers.empty()) {
+            busy_since = std::chrono::steady_clock::now();
+        }
+        transfers[transfer_path] = Incoming{push, state};
+    }
+
+#ifdef VERBOSE_DEBUG
+    std::cout << "Receiving " << push.name << " (" << push.size_b
+              << " bytes) from " << push.address << " into "
+              << push.local_path << std::endl;
+#endif
+    result.returnResults(push.local_path);
+}
+
+/* In the receive folder, `name` without any folders in it, and made unique
+ * by a " (n)" suffix, not to overwrite earlier files */
+string ObexReceiver::make_local_path(const string &name) const {
+    auto file_name = fs::path(name).filename();
+    if (file_name.empty() || file_name == "." || file_name == "..") {
+        file_name = "received";
+    }
+    auto dir = fs::absolute(config.receive_dir);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto is_taken = [this](const fs::path &path) {
+        if (fs::exists(path)) {
+            return true;
+        }
+        return std::any_of(transfers.begin(), transfers.end(),
+                           [&path](const auto &transfer) {
+                               return transfer.second.push.local_path ==
+                                      path.string();
+                           });
+    };
+
+    auto path = dir / file_name;
+    for (auto i = 1; is_taken(path); ++i) {
+        path = dir / (file_name.stem().string() + " (" + std::to_string(i) +
+                      ")" + file_name.extension().string());
+    }
+    return path.string();
+}
+
+void ObexReceiver::on_properties_changed(sdbus::Message &msg) {
+    auto interface = string();
+    auto changed = map<string, sdbus::Variant>();
+    auto invalidated = vector<string>();
+    msg >> interface >> changed >> invalidated;
+    if (interface != OBEX_TRANSFER_IFACE) {
+        return;
+    }
+
+    auto transfer_path = string(msg.getPath());
+    auto status = string();
+    auto state = std::shared_ptr<internal::TransferState>();
+    auto on_progress = ProgressCallback();
+    auto progress = TransferProgress();
+    auto preallocation_b = u64(0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto transfer = transfers.find(transfer_path);
+        if (transfer == transfers.end()) {
+            return;
+        }
+        state = transfer->second.state;
+
+        {
+            std::lock_guard<std::mutex> state_lock(state->mutex);
+            status = internal::update_transfer(*state, changed);
+            preallocation_b = internal::take_preallocation(*state);
+            on_progress = state->on_progress;
+            progress = state->progress;
+        }
+
+        if (status == "complete" || status == "error") {
+            if (status == "complete") {
+                completed_b +=
+                    std::max(progress.size_b, progress.transferred_b);
+                ++files_completed;
+            } else {
+                completed_b += progress.transferred_b;
+                ++files_failed;
+            }
+            transfers.erase(transfer);
+            if (transfers.empty()) {
+                busy += std::chrono::steady_clock::now() - busy_since;
+            }
+        }
+    }
+
+    if (preallocation_b > 0) {
+        preallocate(transfer_path, state->local_path, preallocation_b);
+    }
+
+    /* The end is reported by finish_transfer() */
+    if (status == "complete") {
+        internal::finish_transfer(state, nullptr);
+    } else if (status == "error") {
+        internal::finish_transfer(
+            state, std::make_exception_ptr(sdbus::Error(
+                       "org.bluez.obex.Error.Failed", "Transfer failed")));
+    } else if (on_progress) {
+        on_progress(progress);
+    }
+}
+
+/* Off the event loop thread, fallocate may have to write out the blocks, and
+ * Cancel blocks for its reply */
+void ObexReceiver::preallocate(const string &transfer_path,
+                               const string &local_path, u64 size_b) {
+    timers->scheduleAfter(
+        std::chrono::milliseconds(0),
+        [this, transfer_path, local_path, size_b]() {
+            auto error = internal::preallocate_file(local_path, size_b);
+            /* Else it's only slower, eg. the filesystem can't */
+            if (error == ENOSPC) {
+                try {
+                    sdbus::createProxy(connection, OBEX_SERVICE,
+                                       transfer_path)
+                        ->callMethod("Cancel")
+                        .onInterface(OBEX_TRANSFER_IFACE);
+                } catch (const sdbus::Error &e) {
+                    /* Eg. it completed meanwhile */
+                }
+            }
+#ifdef VERBOSE_DEBUG
+            if (error != 0) {
+                std::cerr << "Couldn't reserve " << size_b << " bytes for "
+                          << local_path << ": " << std::strerror(error)
+                          << std::endl;
+            }
+#endif
+        });
+}
+
+size_t ObexReceiver::getActiveCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return transfers.size();
+}
+
+ObexSessionStats ObexReceiver::getStats() const {
+    auto stats = ObexSessionStats();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.transferred_b = completed_b;
+    for (const auto &transfer : transfers) {
+        auto &state = *transfer.second.state;
+        std::lock_guard<std::mutex> state_lock(state.mutex);
+        stats.transferred_b += state.progress.transferred_b;
+    }
+    stats.files_completed = files_completed;
+    stats.files_failed = files_failed;
+    stats.busy = busy;
+    if (!transfers.empty()) {
+        stats.busy += std::chrono::steady_clock::now() - busy_since;
+    }
+    return stats;
+}
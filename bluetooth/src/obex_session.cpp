@@ -0,0 +1,525 @@
+/**
+ * @file obex_session.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of ObexSession
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "bluetooth/obex_session.h"
+
+using std::string, std::map, std::vector;
+
+namespace fs = std::filesystem;
+
+namespace {
+const auto OBEX_SERVICE = "org.bluez.obex";
+const auto OBEX_CLIENT_IFACE = "org.bluez.obex.Client1";
+const auto OBEX_OBJECTPUSH_IFACE = "org.bluez.obex.ObjectPush1";
+const auto OBEX_FILETRANSFER_IFACE = "org.bluez.obex.FileTransfer1";
+const auto OBEX_TRANSFER_IFACE = "org.bluez.obex.Transfer1";
+
+/* The file being sent, and the next one, already queued in obexd, so it
+ * starts without waiting a round trip for us to send it */
+const size_t MAX_FILES_IN_FLIGHT = 2;
+} // namespace
+
+namespace {
+sdbus::ObjectPath create_session(sdbus::IConnection &connection,
+                                 BdAddr address, ObexTarget target) {
+    auto session_path = sdbus::ObjectPath();
+    auto target_name = string("opp");
+    if (target == ObexTarget::FILE_TRANSFER) {
+        target_name = "ftp";
+    }
+    sdbus::createProxy(connection, OBEX_SERVICE, "/org/bluez/obex")
+        ->callMethod("CreateSession")
+        .onInterface(OBEX_CLIENT_IFACE)
+        .withArguments(address.toString(),
+                       map<string, sdbus::Variant>({{"Target", target_name}}))
+        .storeResultsTo(session_path);
+    return session_path;
+}
+} // namespace
+
+ObexSession::ObexSession(sdbus::IConnection &connection, BdAddr address,
+                         ObexTarget target)
+    : ObexSession(connection, address, target,
+                  create_session(connection, address, target)) {
+    /* Transfers are children of the session, so one match covers all of
+     * them, instead of a proxy per transfer */
+    properties_changed_slot = connection.addMatch(
+        "type='signal',sender='org.bluez.obex',path_namespace='" +
+            session_path +
+            "',interface='org.freedesktop.DBus.Properties',"
+            "member='PropertiesChanged'",
+        [this](sdbus::Message &msg) { on_properties_changed(msg); });
+}
+
+ObexSession::ObexSession(sdbus::IConnection &connection, BdAddr address,
+                         ObexTarget target, sdbus::ObjectPath session_path)
+    : connection(connection), address(address), target(target),
+      session_path(std::move(session_path)),
+      timers(std::make_unique<TimerQueue>()),
+      session(sdbus::createProxy(connection, OBEX_SERVICE,
+                                 this->session_path)) {
+#ifdef VERBOSE_DEBUG
+    std::cout << "Created session: " << this->session_path << std::endl;
+#endif
+}
+
+ObexSession::~ObexSession() {
+    /* Taken off the books first, so a reply, signal or deadline still coming
+     * in finds nothing to do */
+    auto pending = vector<State>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.assign(queue.begin(), queue.end());
+        pending.insert(pending.end(), sending.begin(), sending.end());
+        for (auto &transfer : transfers) {
+            pending.push_back(transfer.second);
+        }
+        queue.clear();
+        sending.clear();
+        transfers.clear();
+    }
+
+    /* Stops deadlines, they call into the session */
+    timers.reset();
+    /* Drops replies of calls in flight, and stops signals */
+    properties_changed_slot.reset();
+    session.reset();
+    on_file_done = nullptr;
+
+    try {
+        sdbus::createProxy(connection, OBEX_SERVICE, "/org/bluez/obex")
+            ->callMethod("RemoveSession")
+            .onInterface(OBEX_CLIENT_IFACE)
+            .withArguments(session_path);
+    } catch (const sdbus::Error &e) {
+#ifdef VERBOSE_DEBUG
+        std::cerr << "RemoveSession failed: " << e.what() << std::endl;
+#endif
+    }
+
+    auto error = std::make_exception_ptr(
+        sdbus::Error("org.bluez.obex.Error.Failed", "Session closed"));
+    for (auto &state : pending) {
+        internal::finish_transfer(state, error);
+    }
+}
+
+/* Called with the lock held */
+bool ObexSession::is_busy() const {
+    return !queue.empty() || !sending.empty() || !transfers.empty();
+}
+
+/* Called with the lock held, after a file is done */
+void ObexSession::update_busy() {
+    if (!is_busy()) {
+        busy += std::chrono::steady_clock::now() - busy_since;
+    }
+}
+
+TransferHandle ObexSession::sendFile(const string &local_filepath,
+                                     TransferOptions options) {
+    auto state = internal::make_transfer_state(local_filepath,
+                                               std::move(options.on_progress));
+    /* Only FileTransfer1.PutFile takes a name, same as the local one */
+    state->remote_name = fs::path(state->local_path).filename().string();
+    return queue_transfer(state, options.timeout_ms);
+}
+
+TransferHandle ObexSession::getFile(const string &remote_name,
+                                    const string &local_filepath,
+                                    TransferOptions options) {
+    require_file_transfer();
+    auto state = internal::make_transfer_state(local_filepath,
+                                               std::move(options.on_progress));
+    state->remote_name = remote_name;
+    state->is_receive = true;
+    return queue_transfer(state, options.timeout_ms);
+}
+
+TransferHandle
+ObexSession::queue_transfer(const State &state,
+                            std::chrono::milliseconds timeout_ms) {
+    enqueue(state);
+
+    if (timeout_ms.count() > 0) {
+        /* Not cancelled when the transfer finishes first, that could wait on
+         * a deadline blocked in Cancel, whose reply needs the event loop */
+        auto weak_state = std::weak_ptr<internal::TransferState>(state);
+        timers->scheduleAfter(timeout_ms, [weak_state]() {
+            if (auto state = weak_state.lock()) {
+                internal::cancel_transfer(state, "Deadline passed");
+            }
+        });
+    }
+
+    return TransferHandle(state);
+}
+
+vector<ObexFolderEntry> ObexSession::listFolder() {
+    require_file_transfer();
+    auto listing = vector<map<string, sdbus::Variant>>();
+    session->callMethod("ListFolder")
+        .onInterface(OBEX_FILETRANSFER_IFACE)
+        .storeResultsTo(listing);
+
+    auto entries = vector<ObexFolderEntry>();
+    for (auto &properties : listing) {
+        auto entry = ObexFolderEntry();
+        auto name = properties.find("Name");
+        if (name != properties.end()) {
+            entry.name = name->second.get<string>();
+        }
+        auto type = properties.find("Type");
+        entry.is_folder = type != properties.end() &&
+                          type->second.get<string>() == "folder";
+        auto size = properties.find("Size");
+        if (size != properties.end()) {
+            entry.size_b = size->second.get<u64>();
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+void ObexSession::changeFolder(const string &folder) {
+    require_file_transfer();
+    session->callMethod("ChangeFolder")
+        .onInterface(OBEX_FILETRANSFER_IFACE)
+        .withArguments(folder);
+}
+
+void ObexSession::require_file_transfer() const {
+    if (target != ObexTarget::FILE_TRANSFER) {
+        throw sdbus::Error("org.bluez.obex.Error.NotSupported",
+                           "Not a file transfer session");
+    }
+}
+
+void ObexSession::enqueue(const State &state) {
+    auto cancel_reason = std::optional<string>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<std::mutex> state_lock(state->mutex);
+        state->owner = this;
+        /* Cancelled while being handed over by a dispatcher */
+        cancel_reason = state->cancel_reason;
+        if (cancel_reason) {
+            ++files_failed;
+        } else {
+            if (!is_busy()) {
+                busy_since = std::chrono::steady_clock::now();
+            }
+            queue.push_back(state);
+        }
+    }
+
+    if (cancel_reason) {
+        finish(state, std::make_exception_ptr(sdbus::Error(
+                          "org.bluez.obex.Error.Failed", *cancel_reason)));
+    } else {
+        pump();
+    }
+}
+
+/* Hand files to obexd, till MAX_FILES_IN_FLIGHT are with it, all of them on
+ * a FILE_TRANSFER session, so they keep their order with ChangeFolder */
+void ObexSession::pump() {
+    auto to_send = vector<State>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!queue.empty() &&
+               (target == ObexTarget::FILE_TRANSFER ||
+                sending.size() + transfers.size() < MAX_FILES_IN_FLIGHT)) {
+            sending.push_back(queue.front());
+            to_send.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+    }
+
+    for (auto &state : to_send) {
+        auto on_reply = [this, state](const sdbus::Error *error,
+                                      sdbus::ObjectPath transfer,
+                                      map<string, sdbus::Variant> properties) {
+            on_sent(state, error, transfer, properties);
+        };
+        try {
+            if (target == ObexTarget::OBJECT_PUSH) {
+                session->callMethodAsync("SendFile")
+                    .onInterface(OBEX_OBJECTPUSH_IFACE)
+                    .withArguments(state->local_path)
+                    .uponReplyInvoke(std::move(on_reply));
+            } else if (state->is_receive) {
+                session->callMethodAsync("GetFile")
+                    .onInterface(OBEX_FILETRANSFER_IFACE)
+                    .withArguments(state->local_path, state->remote_name)
+                    .uponReplyInvoke(std::move(on_reply));
+            } else {
+                session->callMethodAsync("PutFile")
+                    .onInterface(OBEX_FILETRANSFER_IFACE)
+                    .withArguments(state->local_path, state->remote_name)
+                    .uponReplyInvoke(std::move(on_reply));
+            }
+        } catch (const sdbus::Error &e) {
+            on_sent(state, &e, {}, {});
+        }
+    }
+}
+
+/* obexd replies to SendFile (and GetFile, PutFile) before it emits anything
+ * on the transfer, and
+ * messages from one sender arrive in order, so the transfer is known before
+ * its first PropertiesChanged */
+void ObexSession::on_sent(const State &state, const sdbus::Error *error,
+                          const sdbus::ObjectPath &transfer,
+                          const map<string, sdbus::Variant> &properties) {
+    auto cancel_reason = std::optional<string>();
+    auto preallocation_b = u64(0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto sent = std::find(sending.begin(), sending.end(), state);
+        /* The session is closing */
+        if (sent == sending.end()) {
+            return;
+        }
+        sending.erase(sent);
+        if (error) {
+            ++files_failed;
+            update_busy();
+        } else {
+            transfers[transfer] = state;
+
+            std::lock_guard<std::mutex> state_lock(state->mutex);
+            state->transfer_path = transfer;
+            internal::update_transfer(*state, properties);
+            cancel_reason = state->cancel_reason;
+            preallocation_b = internal::take_preallocation(*state);
+        }
+    }
+
+#ifdef VERBOSE_DEBUG
+    std::cout << "Created transfer: " << transfer << " for "
+              << state->local_path << std::endl;
+#endif
+
+    if (error) {
+        finish(state, std::make_exception_ptr(*error));
+    } else if (cancel_reason) {
+        /* Cancel blocks for its reply, which this (event loop) thread
+         * would have to dispatch */
+        timers->scheduleAfter(std::chrono::milliseconds(0),
+                              [this, state, reason = *cancel_reason]() {
+                                  cancel_transfer(state, reason);
+                              });
+    } else if (preallocation_b > 0) {
+        preallocate(state, preallocation_b);
+    }
+}
+
+void ObexSession::on_properties_changed(sdbus::Message &msg) {
+    auto interface = string();
+    auto changed = map<string, sdbus::Variant>();
+    auto invalidated = vector<string>();
+    msg >> interface >> changed >> invalidated;
+    if (interface != OBEX_TRANSFER_IFACE) {
+        return;
+    }
+
+    auto transfer_path = string(msg.getPath());
+    auto status = string();
+    auto state = State();
+    auto on_progress = ProgressCallback();
+    auto progress = TransferProgress();
+    auto preallocation_b = u64(0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto transfer = transfers.find(transfer_path);
+        if (transfer == transfers.end()) {
+            return;
+        }
+        state = transfer->second;
+
+        std::lock_guard<std::mutex> state_lock(state->mutex);
+        status = internal::update_transfer(*state, changed);
+        preallocation_b = internal::take_preallocation(*state);
+        on_progress = state->on_progress;
+        progress = state->progress;
+    }
+
+    if (preallocation_b > 0) {
+        preallocate(state, preallocation_b);
+    }
+
+    /* "queued", "active" and "suspended" aren't the end */
+    if (status == "complete") {
+        on_transfer_done(transfer_path, nullptr);
+    } else if (status == "error") {
+        /* obexd doesn't say why */
+        on_transfer_done(transfer_path,
+                         std::make_exception_ptr(sdbus::Error(
+                             "org.bluez.obex.Error.Failed",
+                             "Transfer failed")));
+    } else if (on_progress) {
+        on_progress(progress);
+    }
+}
+
+/* Done with obexd, complete if `error` is null */
+void ObexSession::on_transfer_done(const string &transfer_path,
+                                   std::exception_ptr error) {
+    auto state = State();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto transfer = transfers.find(transfer_path);
+        if (transfer == transfers.end()) {
+            return;
+        }
+        state = std::move(transfer->second);
+        transfers.erase(transfer);
+
+        std::lock_guard<std::mutex> state_lock(state->mutex);
+        auto &progress = state->progress;
+        if (error) {
+            completed_b += progress.transferred_b;
+            ++files_failed;
+        } else {
+            /* The last "Transferred" may not be signalled before it */
+            completed_b += std::max(progress.size_b, progress.transferred_b);
+            ++files_completed;
+        }
+        update_busy();
+    }
+
+    finish(state, error);
+}
+
+/* Off the event loop thread, fallocate may have to write out the blocks */
+void ObexSession::preallocate(const State &state, u64 size_b) {
+    timers->scheduleAfter(std::chrono::milliseconds(0), [state, size_b]() {
+        auto error = internal::preallocate_file(state->local_path, size_b);
+        /* Else it's only slower, eg. the filesystem can't */
+        if (error == ENOSPC) {
+            internal::cancel_transfer(state, "No space left for file");
+        }
+#ifdef VERBOSE_DEBUG
+        if (error != 0) {
+            std::cerr << "Couldn't reserve " << size_b << " bytes for "
+                      << state->local_path << ": " << std::strerror(error)
+                      << std::endl;
+        }
+#endif
+    });
+}
+
+/* After the file is taken off the session's books */
+void ObexSession::finish(const State &state, std::exception_ptr error) {
+    internal::finish_transfer(state, error);
+    pump();
+    if (on_file_done) {
+        on_file_done();
+    }
+}
+
+bool ObexSession::cancel_transfer(const State &state, const string &reason) {
+    auto error = std::make_exception_ptr(
+        sdbus::Error("org.bluez.obex.Error.Failed", reason));
+    auto transfer_path = string();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto queued = std::find(queue.begin(), queue.end(), state);
+        if (queued != queue.end()) {
+            queue.erase(queued);
+            ++files_failed;
+            update_busy();
+        } else {
+            std::lock_guard<std::mutex> state_lock(state->mutex);
+            if (state->is_done) {
+                return true;
+            }
+            if (state->owner != this) {
+                return false;
+            }
+            /* on_sent() cancels it, once there is a transfer to cancel */
+            if (state->transfer_path.empty()) {
+                state->cancel_reason = reason;
+                return true;
+            }
+            transfer_path = state->transfer_path;
+        }
+    }
+
+    if (transfer_path.empty()) {
+        finish(state, error);
+        return true;
+    }
+
+    try {
+        sdbus::createProxy(connection, OBEX_SERVICE, transfer_path)
+            ->callMethod("Cancel")
+            .onInterface(OBEX_TRANSFER_IFACE);
+    } catch (const sdbus::Error &e) {
+        /* Eg. it completed meanwhile, then this does nothing */
+#ifdef VERBOSE_DEBUG
+        std::cerr << "Cancel failed: " << e.what() << std::endl;
+#endif
+    }
+    /* Whether or not obexd signals an error too */
+    on_transfer_done(transfer_path, error);
+    return true;
+}
+
+void ObexSession::call_transfer(const State &state, const char *method) {
+    auto transfer_path = string();
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->owner == this) {
+            transfer_path = state->transfer_path;
+        }
+    }
+    if (transfer_path.empty()) {
+        throw sdbus::Error("org.bluez.obex.Error.NotInProgress",
+                           "Transfer is not with obexd");
+    }
+
+    sdbus::createProxy(connection, OBEX_SERVICE, transfer_path)
+        ->callMethod(method)
+        .onInterface(OBEX_TRANSFER_IFACE);
+}
+
+size_t ObexSession::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() + sending.size() + transfers.size();
+}
+
+ObexSessionStats ObexSession::getStats() const {
+    auto stats = ObexSessionStats();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.transferred_b = completed_b;
+    for (const auto &transfer : transfers) {
+        std::lock_guard<std::mutex> state_lock(transfer.second->mutex);
+        stats.transferred_b += transfer.second->progress.transferred_b;
+    }
+    stats.files_completed = files_completed;
+    stats.files_failed = files_failed;
+    stats.busy = busy;
+    if (is_busy()) {
+        stats.busy += std::chrono::steady_clock::now() - busy_since;
+    }
+    return stats;
+}
@@ -0,0 +1,450 @@
+/**
+ * @file transfer_dispatcher.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of TransferDispatcher
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "bluetooth/transfer_dispatcher.h"
+
+using std::string, std::map, std::vector;
+
+namespace {
+const auto OBEX_SERVICE = "org.bluez.obex";
+const auto OBEX_CLIENT_IFACE = "org.bluez.obex.Client1";
+const auto OBEX_CLIENT_PATH = "/org/bluez/obex/client";
+
+/* Same as a session keeps with obexd, the file being sent and the next,
+ * the rest wait here, so they can still go to another session */
+const unsigned int MAX_FILES_PER_SESSION = 2;
+
+/* Address of the adapter `address` is known to, empty if none is */
+string find_adapter(BusContext &context, BdAddr address) {
+    auto adapters = vector<std::pair<string, string>>();
+    try {
+        auto &tree = context.getObjectTree();
+        tree.forEachObjectWithInterface(
+            "org.bluez.Adapter1",
+            [&adapters](const sdbus::ObjectPath &path,
+                        const map<string, sdbus::Variant> &properties) {
+                auto adapter_address = properties.find("Address");
+                if (adapter_address != properties.end()) {
+                    adapters.emplace_back(
+                        path, adapter_address->second.get<string>());
+                }
+            });
+
+        /* Not from the callback above, the tree is locked in it */
+        for (const auto &adapter : adapters) {
+            if (tree.getProperty(address.toObjectPath(adapter.first),
+                                 "org.bluez.Device1", "Address")) {
+                return adapter.second;
+            }
+        }
+    } catch (const sdbus::Error &e) {
+#ifdef VERBOSE_DEBUG
+        std::cerr << "Adapter lookup failed: " << e.what() << std::endl;
+#endif
+    }
+    return string();
+}
+} // namespace
+
+TransferDispatcher::TransferDispatcher(sdbus::IConnection &connection,
+                                       TransferDispatcherConfig config,
+                                       BusContext &system_context)
+    : connection(connection), system_context(system_context),
+      config(config), timers(std::make_unique<TimerQueue>()),
+      obex(sdbus::createProxy(connection, OBEX_SERVICE, "/org/bluez/obex")) {
+    /* One match for the transfers of all sessions, instead of one per
+     * session, the path says whose transfer it is */
+    properties_changed_slot = connection.addMatch(
+        string("type='signal',sender='org.bluez.obex',path_namespace='") +
+            OBEX_CLIENT_PATH +
+            "',interface='org.freedesktop.DBus.Properties',"
+            "member='PropertiesChanged'",
+        [this](sdbus::Message &msg) { on_properties_changed(msg); });
+}
+
+TransferDispatcher::~TransferDispatcher() {
+    /* Taken out first, so a session's callback, a reply, signal or deadline
+     * still coming in finds nothing to do */
+    auto open_sessions = vector<std::shared_ptr<ObexSession>>();
+    auto pending = vector<State>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &device : devices) {
+            if (device.second.session) {
+                open_sessions.push_back(std::move(device.second.session));
+            }
+            pending.insert(pending.end(), device.second.queue.begin(),
+                           device.second.queue.end());
+        }
+        devices.clear();
+        adapters.clear();
+        sessions.clear();
+    }
+
+    /* Drops replies of CreateSession calls in flight, and stops signals */
+    properties_changed_slot.reset();
+    obex.reset();
+
+    /* Fails the files they have, their callbacks find no device */
+    open_sessions.clear();
+
+    auto error = std::make_exception_ptr(
+        sdbus::Error("org.bluez.obex.Error.Failed", "Dispatcher closed"));
+    for (auto &state : pending) {
+        internal::finish_transfer(state, error);
+    }
+
+    /* Last, a session released meanwhile is closed on it. Closes the
+     * sessions waiting to be closed too */
+    timers.reset();
+}
+
+TransferHandle TransferDispatcher::send(BdAddr address,
+                                        const string &local_filepath,
+                                        TransferOptions options) {
+    auto state = internal::make_transfer_state(local_filepath,
+                                               std::move(options.on_progress));
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->owner = this;
+    }
+
+    auto is_known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_known = devices.count(address) > 0;
+    }
+    /* Looked up once per device, outside the lock, the first lookup seeds
+     * the object tree */
+    auto adapter = string();
+    if (!is_known) {
+        adapter = find_adapter(system_context, address);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (devices.empty()) {
+            busy_since = std::chrono::steady_clock::now();
+        }
+        auto inserted = devices.emplace(address, Device());
+        auto &device = inserted.first->second;
+        if (inserted.second) {
+            device.adapter = adapter;
+        }
+        if (!device.session && !device.is_opening && !device.is_waiting) {
+            device.is_waiting = true;
+            adapters[device.adapter].waiting.push_back(address);
+        }
+        device.queue.push_back(state);
+    }
+
+    if (options.timeout_ms.count() > 0) {
+        /* Same as ObexSession::sendFile(), whoever owns it then cancels */
+        auto weak_state = std::weak_ptr<internal::TransferState>(state);
+        timers->scheduleAfter(options.timeout_ms, [weak_state]() {
+            if (auto state = weak_state.lock()) {
+                internal::cancel_transfer(state, "Deadline passed");
+            }
+        });
+    }
+
+    pump();
+    return TransferHandle(state);
+}
+
+/* Hand files to open sessions, close sessions that are done or whose turn is
+ * over, and open sessions for waiting devices, as adapters allow */
+void TransferDispatcher::pump() {
+    auto hand_overs =
+        vector<std::pair<std::shared_ptr<ObexSession>, State>>();
+    auto to_close = vector<std::shared_ptr<ObexSession>>();
+    auto to_open = vector<std::pair<BdAddr, string>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto &entry : devices) {
+            auto &device = entry.second;
+            if (!device.session) {
+                continue;
+            }
+
+            auto &adapter = adapters[device.adapter];
+            auto is_turn_over = [&]() {
+                return config.max_files_per_turn > 0 &&
+                       device.turn_count >= config.max_files_per_turn &&
+                       !adapter.waiting.empty();
+            };
+            while (!device.queue.empty() && !is_turn_over() &&
+                   device.in_session < MAX_FILES_PER_SESSION) {
+                auto state = std::move(device.queue.front());
+                device.queue.pop_front();
+                {
+                    std::lock_guard<std::mutex> state_lock(state->mutex);
+                    state->owner = device.session.get();
+                }
+                hand_overs.emplace_back(device.session, std::move(state));
+                ++device.in_session;
+                ++device.turn_count;
+            }
+
+            if (device.in_session > 0 ||
+                (!device.queue.empty() && !is_turn_over())) {
+                continue;
+            }
+
+            /* Done, or making way, its stats are kept, its files aren't */
+            auto stats = device.session->getStats();
+            closed_stats.transferred_b += stats.transferred_b;
+            closed_stats.files_completed += stats.files_completed;
+            closed_stats.files_failed += stats.files_failed;
+
+            sessions.erase(device.session->session_path);
+            to_close.push_back(std::move(device.session));
+            --adapter.session_count;
+            device.turn_count = 0;
+            if (!device.queue.empty()) {
+                device.is_waiting = true;
+                adapter.waiting.push_back(entry.first);
+            }
+        }
+
+        for (auto &entry : adapters) {
+            auto &adapter = entry.second;
+            while (!adapter.waiting.empty() &&
+                   adapter.session_count < config.max_sessions_per_adapter) {
+                auto &device = devices[adapter.waiting.front()];
+                device.is_waiting = false;
+                /* Its files were cancelled while it waited */
+                if (!device.queue.empty()) {
+                    device.is_opening = true;
+                    ++adapter.session_count;
+                    to_open.emplace_back(adapter.waiting.front(),
+                                         entry.first);
+                }
+                adapter.waiting.pop_front();
+            }
+        }
+
+        for (auto device = devices.begin(); device != devices.end();) {
+            if (!device->second.session && !device->second.is_opening &&
+                !device->second.is_waiting && device->second.queue.empty()) {
+                device = devices.erase(device);
+                if (devices.empty()) {
+                    closed_stats.busy += now - busy_since;
+                }
+            } else {
+                ++device;
+            }
+        }
+    }
+
+    for (auto &session : to_close) {
+        close_session(std::move(session));
+    }
+
+    for (auto &hand_over : hand_overs) {
+        hand_over.first->enqueue(hand_over.second);
+        release_session(std::move(hand_over.first));
+    }
+
+    for (auto &device : to_open) {
+        open_session(device.first, device.second);
+    }
+}
+
+/* RemoveSession blocks for its reply, which the event loop thread (maybe
+ * this one) would have to dispatch, so a session is destroyed on the timer
+ * thread */
+void TransferDispatcher::close_session(std::shared_ptr<ObexSession> session) {
+    timers->scheduleAfter(std::chrono::milliseconds(0),
+                          [session = std::move(session)]() mutable {
+                              session.reset();
+                          });
+}
+
+/* Drop a reference taken out of the books. If the session was closed
+ * meanwhile, it may be the last one, so it is closed as pump() does. Else
+ * the books still have one, and it is dropped under the lock, so it can't
+ * become the last */
+void TransferDispatcher::release_session(
+    std::shared_ptr<ObexSession> session) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = sessions.find(session->session_path);
+        if (found != sessions.end() && found->second == session) {
+            session.reset();
+            return;
+        }
+    }
+    close_session(std::move(session));
+}
+
+void TransferDispatcher::open_session(BdAddr address, const string &adapter) {
+    auto options = map<string, sdbus::Variant>({{"Target", string("opp")}});
+    if (!adapter.empty()) {
+        options["Source"] = adapter;
+    }
+
+    try {
+        obex->callMethodAsync("CreateSession")
+            .onInterface(OBEX_CLIENT_IFACE)
+            .withArguments(address.toString(), options)
+            .uponReplyInvoke([this, address](const sdbus::Error *error,
+                                             sdbus::ObjectPath session_path) {
+                on_session_created(address, error, session_path);
+            });
+    } catch (const sdbus::Error &e) {
+        on_session_created(address, &e, {});
+    }
+}
+
+void TransferDispatcher::on_session_created(
+    BdAddr address, const sdbus::Error *error,
+    const sdbus::ObjectPath &session_path) {
+    auto failed = vector<State>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto device = devices.find(address);
+        if (device == devices.end()) {
+            return;
+        }
+        device->second.is_opening = false;
+        if (!error) {
+            /* Doesn't block, the session is already connected */
+            auto session = std::shared_ptr<ObexSession>(
+                new ObexSession(connection, address,
+                                ObexTarget::OBJECT_PUSH, session_path));
+            session->on_file_done = [this, address]() {
+                on_file_done(address);
+            };
+            device->second.session = session;
+            sessions[session_path] = std::move(session);
+        } else {
+            --adapters[device->second.adapter].session_count;
+            failed.assign(device->second.queue.begin(),
+                          device->second.queue.end());
+            device->second.queue.clear();
+            closed_stats.files_failed += failed.size();
+        }
+    }
+
+#ifdef VERBOSE_DEBUG
+    if (error) {
+        std::cerr << "CreateSession to " << address
+                  << " failed: " << error->what() << std::endl;
+    }
+#endif
+
+    /* The device may not be reachable, its files fail, not the others' */
+    for (auto &state : failed) {
+        internal::finish_transfer(state, std::make_exception_ptr(*error));
+    }
+    pump();
+}
+
+void TransferDispatcher::on_file_done(BdAddr address) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto device = devices.find(address);
+        if (device == devices.end() || device->second.in_session == 0) {
+            return;
+        }
+        --device->second.in_session;
+    }
+    pump();
+}
+
+void TransferDispatcher::on_properties_changed(sdbus::Message &msg) {
+    /* Transfers are children of their session */
+    auto path = string(msg.getPath());
+    auto session = std::shared_ptr<ObexSession>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = sessions.find(path.substr(0, path.rfind('/')));
+        if (found == sessions.end()) {
+            return;
+        }
+        session = found->second;
+    }
+    session->on_properties_changed(msg);
+    release_session(std::move(session));
+}
+
+bool TransferDispatcher::cancel_transfer(const State &state,
+                                         const string &reason) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto is_queued = false;
+        for (auto &device : devices) {
+            auto &queue = device.second.queue;
+            auto queued = std::find(queue.begin(), queue.end(), state);
+            if (queued != queue.end()) {
+                queue.erase(queued);
+                ++closed_stats.files_failed;
+                is_queued = true;
+                break;
+            }
+        }
+        /* Handed to a session meanwhile */
+        if (!is_queued) {
+            return false;
+        }
+    }
+
+    internal::finish_transfer(
+        state, std::make_exception_ptr(
+                   sdbus::Error("org.bluez.obex.Error.Failed", reason)));
+    pump();
+    return true;
+}
+
+void TransferDispatcher::call_transfer(const State &state,
+                                       const char *method) {
+    throw sdbus::Error("org.bluez.obex.Error.NotInProgress",
+                       "Transfer is still queued");
+}
+
+size_t TransferDispatcher::getPendingCount() const {
+    auto count = size_t(0);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &device : devices) {
+        count += device.second.queue.size() + device.second.in_session;
+    }
+    return count;
+}
+
+size_t TransferDispatcher::getOpenSessionCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+ObexSessionStats TransferDispatcher::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto stats = closed_stats;
+    for (const auto &device : devices) {
+        if (device.second.session) {
+            auto session_stats = device.second.session->getStats();
+            stats.transferred_b += session_stats.transferred_b;
+            stats.files_completed += session_stats.files_completed;
+            stats.files_failed += session_stats.files_failed;
+        }
+    }
+    if (!devices.empty()) {
+        stats.busy += std::chrono::steady_clock::now() - busy_since;
+    }
+    return stats;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file transfer_handle.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of TransferHandle
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bluetooth/transfer_handle.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+/* Called with the transfer's lock held */
+void update_rates(internal::TransferState &state, u64 transferred_b,
+                  std::chrono::steady_clock::time_point now) {
+    auto &progress = state.progress;
+    progress.transferred_b = transferred_b;
+    /* "active" wasn't seen */
+    if (state.active_at == std::chrono::steady_clock::time_point()) {
+        state.active_at = state.sampled_at = now;
+        state.sampled_b = 0;
+    }
+
+    auto since_sample_s =
+        std::chrono::duration<double>(now - state.sampled_at).count();
+    if (since_sample_s > 0 && transferred_b >= state.sampled_b) {
+        progress.current_KBps =
+            (transferred_b - state.sampled_b) / 1024.0 / since_sample_s;
+        state.sampled_at = now;
+        state.sampled_b = transferred_b;
+    }
+
+    auto active_s =
+        std::chrono::duration<double>(now - state.active_at).count();
+    if (active_s > 0) {
+        progress.average_KBps = transferred_b / 1024.0 / active_s;
+    }
+
+    progress.eta.reset();
+    if (progress.current_KBps > 0 && progress.size_b >= transferred_b) {
+        auto left_s = (progress.size_b - transferred_b) / 1024.0 /
+                      progress.current_KBps;
+        progress.eta = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(left_s));
+    }
+}
+} // namespace
+
+namespace internal {
+std::shared_ptr<TransferState>
+make_transfer_state(const std::string &path, ProgressCallback on_progress) {
+    auto state = std::make_shared<TransferState>();
+    state->future = state->promise.get_future().share();
+    state->on_progress = std::move(on_progress);
+    state->local_path = fs::absolute(path).string();
+    return state;
+}
+
+void finish_transfer(const std::shared_ptr<TransferState> &state,
+                     std::exception_ptr error) {
+    auto on_progress = ProgressCallback();
+    auto progress = TransferProgress();
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->is_done) {
+            return;
+        }
+        state->is_done = true;
+        state->owner = nullptr;
+        if (error) {
+            state->progress.status = "error";
+        } else {
+            state->progress.status = "complete";
+            state->progress.transferred_b = std::max(
+                state->progress.size_b, state->progress.transferred_b);
+        }
+        state->progress.current_KBps = 0;
+        state->progress.eta.reset();
+        on_progress = std::move(state->on_progress);
+        progress = state->progress;
+    }
+
+    if (error) {
+        state->promise.set_exception(error);
+    } else {
+        state->promise.set_value();
+    }
+    if (on_progress) {
+        on_progress(progress);
+    }
+}
+
+void cancel_transfer(const std::shared_ptr<TransferState> &state,
+                     const std::string &reason) {
+    while (true) {
+        auto owner = static_cast<TransferOwner *>(nullptr);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->is_done || !state->owner) {
+                return;
+            }
+            owner = state->owner;
+        }
+
+        if (owner->cancel_transfer(state, reason)) {
+            return;
+        }
+
+        /* Handed to another owner meanwhile, cancel it there */
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->owner == owner) {
+            return;
+        }
+    }
+}
+
+std::string
+update_transfer(TransferState &state,
+                const std::map<std::string, sdbus::Variant> &properties) {
+    auto now = std::chrono::steady_clock::now();
+    auto status = std::string();
+    auto size = properties.find("Size");
+    if (size != properties.end()) {
+        state.progress.size_b = size->second.get<u64>();
+    }
+    auto new_status = properties.find("Status");
+    if (new_status != properties.end()) {
+        status = new_status->second.get<std::string>();
+        state.progress.status = status;
+        if (status == "active" &&
+            state.active_at == std::chrono::steady_clock::time_point()) {
+            state.active_at = state.sampled_at = now;
+            state.sampled_b = state.progress.transferred_b;
+        }
+    }
+    auto transferred = properties.find("Transferred");
+    if (transferred != properties.end()) {
+        auto transferred_b = transferred->second.get<u64>();
+        /* A 0 before "active", as in a reply, doesn't start the clock */
+        if (transferred_b > 0 ||
+            state.active_at != std::chrono::steady_clock::time_point()) {
+            update_rates(state, transferred_b, now);
+        }
+    }
+    return status;
+}
+
+u64 take_preallocation(TransferState &state) {
+    if (!state.is_receive || state.is_preallocated ||
+        state.progress.size_b == 0 || state.progress.status == "queued") {
+        return 0;
+    }
+    state.is_preallocated = true;
+    return state.progress.size_b;
+}
+
+int preallocate_file(const std::string &path, u64 size_b) {
+    /* Not created here, obexd creates (and truncates) it */
+    auto fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+    /* FALLOC_FL_KEEP_SIZE, so obexd still appends at the end of what it
+     * wrote, and an early end leaves no zeroes */
+    auto error = 0;
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, off_t(size_b)) != 0) {
+        error = errno;
+    }
+    ::close(fd);
+    return error;
+}
+} // namespace internal
+
+TransferHandle::TransferHandle(std::shared_ptr<internal::TransferState> state)
+    : state(std::move(state)) {}
+
+std::shared_future<void> TransferHandle::getFuture() const {
+    return state->future;
+}
+
+void TransferHandle::wait() const { state->future.get(); }
+
+bool TransferHandle::isDone() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->is_done;
+}
+
+TransferProgress TransferHandle::getProgress() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->progress;
+}
+
+const std::string &TransferHandle::getLocalPath() const {
+    return state->local_path;
+}
+
+void TransferHandle::cancel() {
+    internal::cancel_transfer(state, "Transfer cancelled");
+}
+
+void TransferHandle::suspend() { call("Suspend"); }
+
+void TransferHandle::resume() { call("Resume"); }
+
+void TransferHandle::call(const char *method) {
+    auto owner = static_cast<internal::TransferOwner *>(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        owner = state->owner;
+    }
+    if (!owner) {
+        throw sdbus::Error("org.bluez.obex.Error.NotInProgress",
+                           "Transfer is done");
+    }
+    owner->call_transfer(state, method);
+}
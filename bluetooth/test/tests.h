@@ -10,16 +10,19 @@
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
+#include <future>
 #include <iostream>
 #include <map>
-#include <regex>
 #include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "common/adapter.h"
+#include "common/bdaddr.h"
+#include "common/bus_context.h"
 #include "common/declarations.h"
+#include "common/device_name_index.h"
 
 #include "bluetooth/functions.h"
 
@@ -35,7 +38,7 @@ const auto DEFAULT_ADAPTER_PATH = "/org/bluez/hci0";
  *
  * @param address
  */
-void test_connect_to_device(string address,
+void test_connect_to_device(BdAddr address,
                             string adapter_path = DEFAULT_ADAPTER_PATH) {
     cout << '\n' << __func__ << "\n========================" << endl;
     cout << "Connecting to " << address << endl;
@@ -47,7 +50,7 @@ void test_connect_to_device(string address,
  *
  * @param address
  */
-void test_disconnect_from_device(string address,
+void test_disconnect_from_device(BdAddr address,
                                  string adapter_path = DEFAULT_ADAPTER_PATH) {
     cout << '\n' << __func__ << "\n========================" << endl;
     cout << "Disconnecting from " << address << endl;
@@ -56,8 +59,10 @@ void test_disconnect_from_device(string address,
 
 void test_get_device_address(std::string device_name) {
     cout << '\n' << __func__ << "\n========================" << endl;
-    cout << "Got device address: " << get_device_address_by_name(device_name)
-         << endl;
+    auto address = get_device_address_by_name(device_name);
+    if (address) {
+        cout << "Got device address: " << *address << endl;
+    }
 }
 
 void test_get_adapter_powered_status() {
@@ -146,16 +151,217 @@ void test_get_all_managed_objects() {
     }
 }
 
+/**
+ * @note PREREQUISIT: Device must be connected, and accept files
+ */
+void test_obex_session(BdAddr address) {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto session =
+        ObexSession(getSessionBusContext().getConnection(), address);
+
+    /* All queued at once, sent one after other over the one session */
+    auto options = TransferOptions();
+    options.timeout_ms = std::chrono::seconds(60);
+    options.on_progress = [](const TransferProgress &progress) {
+        cout << progress.status << ": " << progress.transferred_b << "/"
+             << progress.size_b << " bytes, " << progress.current_KBps
+             << " KB/s" << endl;
+    };
+    auto sent = vector<TransferHandle>();
+    for (auto path : {"/etc/hostname", "/etc/hosts", "/etc/fstab"}) {
+        sent.push_back(session.sendFile(path, options));
+    }
+
+    /* Cancelled while still queued, so it fails without reaching obexd */
+    auto cancelled = session.sendFile("/etc/passwd");
+    cancelled.cancel();
+
+    for (auto &file : sent) {
+        try {
+            file.wait();
+        } catch (const sdbus::Error &e) {
+            std::cerr << "ERROR: " << e.what() << endl;
+        }
+    }
+    cout << "Cancelled transfer: " << cancelled.getProgress().status
+         << " (error)" << endl;
+
+    auto stats = session.getStats();
+    cout << "Sent " << stats.files_completed << " files (3), "
+         << stats.files_failed << " failed (1), " << stats.transferred_b
+         << " bytes at " << stats.getThroughputKBps() << " KB/s" << endl;
+}
+
+/**
+ * @note PREREQUISIT: Devices must be connected, and accept files
+ */
+void test_transfer_dispatcher(const vector<BdAddr> &addresses) {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto config = TransferDispatcherConfig();
+    config.max_files_per_turn = 2;
+    auto dispatcher =
+        TransferDispatcher(getSessionBusContext().getConnection(), config);
+
+    /* Devices take turns, 2 files at a time, if more are waiting than the
+     * adapter takes at once */
+    auto sent = vector<TransferHandle>();
+    for (auto address : addresses) {
+        for (auto path : {"/etc/hostname", "/etc/hosts", "/etc/fstab"}) {
+            sent.push_back(dispatcher.send(address, path));
+        }
+    }
+    cout << "Sessions open: " << dispatcher.getOpenSessionCount() << endl;
+
+    for (auto &file : sent) {
+        try {
+            file.wait();
+        } catch (const sdbus::Error &e) {
+            std::cerr << "ERROR: " << file.getLocalPath() << ": " << e.what()
+                      << endl;
+        }
+    }
+
+    auto stats = dispatcher.getStats();
+    cout << "Sent " << stats.files_completed << " files ("
+         << 3 * addresses.size() << "), " << stats.files_failed
+         << " failed, " << stats.transferred_b << " bytes at "
+         << stats.getThroughputKBps() << " KB/s, pending "
+         << dispatcher.getPendingCount() << " (0)" << endl;
+}
+
+/**
+ * @note PREREQUISIT: Device must be connected, and serve File Transfer
+ */
+void test_get_file(BdAddr address) {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto session = ObexSession(getSessionBusContext().getConnection(), address,
+                               ObexTarget::FILE_TRANSFER);
+
+    auto got = vector<TransferHandle>();
+    for (auto &entry : session.listFolder()) {
+        if (entry.is_folder) {
+            cout << "[folder] ";
+        }
+        cout << entry.name << " " << entry.size_b << " bytes" << endl;
+        /* Just the first few files, into /tmp */
+        if (!entry.is_folder && got.size() < 3) {
+            got.push_back(session.getFile(entry.name, "/tmp/" + entry.name));
+        }
+    }
+
+    for (auto &file : got) {
+        try {
+            file.wait();
+            cout << "Got " << file.getLocalPath() << endl;
+        } catch (const sdbus::Error &e) {
+            std::cerr << "ERROR: " << file.getLocalPath() << ": " << e.what()
+                      << endl;
+        }
+    }
+}
+
+/**
+ * @note PREREQUISIT: Send a file from a paired device, while this waits
+ */
+void test_obex_receiver() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto config = ObexReceiverConfig();
+    config.receive_dir = "/tmp";
+    config.authorize = [](const IncomingPush &push) {
+        cout << "Accepting " << push.name << " (" << push.size_b
+             << " bytes) from " << push.address << endl;
+        return true;
+    };
+    config.on_progress = [](const IncomingPush &push,
+                            const TransferProgress &progress) {
+        cout << push.local_path << ": " << progress.status << ", "
+             << progress.transferred_b << "/" << progress.size_b << " bytes"
+             << endl;
+    };
+
+    try {
+        auto receiver =
+            ObexReceiver(getSessionBusContext().getConnection(), config);
+        cout << "Waiting 30s for files" << endl;
+        std::this_thread::sleep_for(std::chrono::seconds(30));
+
+        auto stats = receiver.getStats();
+        cout << "Received " << stats.files_completed << " files, "
+             << stats.files_failed << " failed, " << stats.transferred_b
+             << " bytes at " << stats.getThroughputKBps() << " KB/s" << endl;
+    } catch (const sdbus::Error &e) {
+        /* Eg. another agent is registered */
+        std::cerr << "ERROR: " << e.what() << endl;
+    }
+}
+
 void test_send_file() {
     cout << '\n' << __func__ << "\n========================" << endl;
     string name;
     cout << "Enter device name capable of recieving files (can be a substring, "
             "case-insensitive): \n";
     cin >> name;
-    string addr = get_device_address_by_name(name);
-    cout << "Sending file: /etc/fstab to " << addr << " (" << name << ")"
+    auto addr = get_device_address_by_name(name);
+    if (!addr) {
+        return;
+    }
+    cout << "Sending file: /etc/fstab to " << *addr << " (" << name << ")"
          << endl;
-    sendFile(addr /*"30:4B:07:72:25:A4"*/, "/etc/fstab");
+    sendFile(*addr /*"30:4B:07:72:25:A4"*/, "/etc/fstab");
+    test_obex_session(*addr);
+    test_transfer_dispatcher({*addr});
+    test_get_file(*addr);
+}
+
+void test_bdaddr() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    constexpr auto address = BdAddr::parse("11:22:33:aa:BB:cc");
+    static_assert(address && address->toU64() == 0x112233aabbcc);
+    static_assert(!BdAddr::parse("11:22:33:AA:BB"));
+    static_assert(!BdAddr::parse("11-22-33-AA-BB-CC"));
+    static_assert(!BdAddr::fromObjectPath(
+        "/org/bluez/hci0/dev_11_22_33_AA_BB_CC/service0001"));
+    static_assert(!BdAddr::fromObjectPath(
+        "/org/bluez/hci1/dev_11_22_33_AA_BB_CC", "/org/bluez/hci0"));
+
+    auto path = address->toObjectPath(DEFAULT_ADAPTER_PATH);
+    cout << address->toString() << " -> " << path << endl;
+    if (address->toString() != "11:22:33:AA:BB:CC" ||
+        path != "/org/bluez/hci0/dev_11_22_33_AA_BB_CC" ||
+        BdAddr::fromObjectPath(path, DEFAULT_ADAPTER_PATH) != address) {
+        throw std::runtime_error("BdAddr round trip failed");
+    }
+}
+
+void test_device_name_index() {
+    cout << '\n' << __func__ << "\n========================" << endl;
+    auto index = DeviceNameIndex();
+    index.update("/org/bluez/hci0/dev_11_22_33_44_55_66", {"Rockerz 450"});
+    index.update("/org/bluez/hci0/dev_11_22_33_44_55_67",
+                 {"My Phone", "Pixel 6"});
+    index.update("/org/bluez/hci1/dev_11_22_33_44_55_68", {"Pixel Buds"});
+
+    auto check = [](bool condition, const string &what) {
+        if (!condition) {
+            cout << what << ": FAILED" << endl;
+            throw std::runtime_error(what);
+        }
+        cout << what << ": OK" << endl;
+    };
+
+    check(index.findBySubstring("PIXEL").size() == 2, "case-insensitive");
+    check(index.findBySubstring("pixel", DEFAULT_ADAPTER_PATH).size() == 1,
+          "adapter filter");
+    check(index.findBySubstring("rz 4").size() == 1, "substring");
+    check(index.findBySubstring("ixeb").empty(), "3-grams out of order");
+    check(index.findByPrefix("pix").size() == 2, "prefix");
+
+    index.update("/org/bluez/hci0/dev_11_22_33_44_55_67", {"Tablet"});
+    index.remove("/org/bluez/hci1/dev_11_22_33_44_55_68");
+    check(index.findBySubstring("pixel").empty() &&
+              index.findFirstBySubstring("tab")->address ==
+                  BdAddr(0x112233445567),
+          "rename and remove");
 }
 
 void test_func() {
@@ -170,14 +376,20 @@ void test_func() {
     cout << "Enter device name (can be a substring, case-insensitive): \n";
     cin >> name;
     test_get_device_address(name /*"Rockerz 450"*/);
-    string addr = get_device_address_by_name(name);
-    test_connect_to_device(addr /*"11:11:22:AF:5F:70"*/);
+    auto addr = get_device_address_by_name(name);
+    if (addr) {
+        test_connect_to_device(*addr /*"11:11:22:AF:5F:70"*/);
+
+        cout << "Waiting for 4 seconds, can verify connection..." << endl;
+        std::this_thread::sleep_for(std::chrono::seconds(4));
+        test_disconnect_from_device(*addr /*"11:11:22:AF:5F:70"*/);
+    }
 
-    cout << "Waiting for 4 seconds, can verify connection..." << endl;
-    std::this_thread::sleep_for(std::chrono::seconds(4));
-    test_disconnect_from_device(addr /*"11:11:22:AF:5F:70"*/);
+    test_bdaddr();
+    test_device_name_index();
 
     test_send_file();
+    test_obex_receiver();
 
     cout << "Tests complete...";
 }
@@ -13,13 +13,16 @@
 
 #include <exception>
 #include <iostream>
+#include <stdexcept>
 
+#include "bus_context.h"
 #include "sdbus-c++/sdbus-c++.h"
 
 static bool
-isAdapterPoweredOn(const std::string &adapter_object_path = "/org/bluez/hci0") {
+isAdapterPoweredOn(const std::string &adapter_object_path = "/org/bluez/hci0",
+                   BusContext &context = getDefaultBusContext()) {
     try {
-        return sdbus::createProxy("org.bluez", adapter_object_path)
+        return context.createBluezProxy(adapter_object_path)
             ->getProperty("Powered")
             .onInterface("org.bluez.Adapter1")
             .get<bool>();
@@ -29,29 +32,22 @@ isAdapterPoweredOn(const std::string &adapter_object_path = "/org/bluez/hci0") {
     }
 }
 
-static void tryPoweringOnAdapter(
-    const std::string &adapter_object_path = "/org/bluez/hci0") {
-    auto adapter = sdbus::createProxy("org.bluez", adapter_object_path);
+static void
+tryPoweringOnAdapter(const std::string &adapter_object_path = "/org/bluez/hci0",
+                     BusContext &context = getDefaultBusContext()) {
+    auto adapter = context.createBluezProxy(adapter_object_path);
     adapter->callMethod("Set")
         .onInterface("org.freedesktop.DBus.Properties")
         .withArguments("org.bluez.Adapter1", "Powered", sdbus::Variant(true));
 }
 
-static std::string get_advertising_capable_adapter_path() {
-    auto results = std::map<
-        sdbus::ObjectPath,
-        std::map<std::string, std::map<std::string, sdbus::Variant>>>();
-    // Note: This creates a temporary connection, and a new thread for a event loop
-    sdbus::createProxy("org.bluez", "/")
-        ->callMethod("GetManagedObjects")
-        .onInterface("org.freedesktop.DBus.ObjectManager")
-        .storeResultsTo(results);
-
-    for (const auto &obj : results) {
-        auto it = obj.second.find("org.bluez.LEAdvertisingManager1");
-        if (it != obj.second.cend()) {
-            return obj.first;
-        }
+static std::string get_advertising_capable_adapter_path(
+    BusContext &context = getDefaultBusContext()) {
+    /* Answered from the object tree cache, no GetManagedObjects call */
+    auto adapter_path = context.getObjectTree().findObjectWithInterface(
+        "org.bluez.LEAdvertisingManager1");
+    if (adapter_path) {
+        return *adapter_path;
     }
 
     throw std::logic_error(
@@ -0,0 +1,171 @@
+/**
+ * @file bdaddr.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Bluetooth device address, packed into an integer, so it can be
+ * compared, hashed and copied without touching strings
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "declarations.h"
+
+/**
+ * @brief 48 bit address, in the low bits of a u64, most significant byte
+ * being the first one in "XX:XX:XX:XX:XX:XX"
+ *
+ * Parsing is constexpr, so an address literal can be checked at compile
+ * time:
+ *
+ *     constexpr auto address = BdAddr::parse("11:22:33:AA:BB:CC").value();
+ */
+class BdAddr {
+    u64 value = 0;
+
+    static constexpr size_t STRING_LENGTH = sizeof("XX:XX:XX:XX:XX:XX") - 1;
+    static constexpr std::string_view DEVICE_PREFIX = "/dev_";
+
+    static constexpr int hex_digit_value(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    /* 6 hex pairs separated by `separator`, ':' in addresses, '_' in object
+     * paths */
+    static constexpr std::optional<BdAddr> parse_with_separator(
+        std::string_view text, char separator) {
+        if (text.size() != STRING_LENGTH) {
+            return std::nullopt;
+        }
+
+        auto value = u64(0);
+        for (auto i = size_t(0); i < STRING_LENGTH; i += 3) {
+            auto high = hex_digit_value(text[i]);
+            auto low = hex_digit_value(text[i + 1]);
+            if (high < 0 || low < 0 ||
+                (i + 2 < STRING_LENGTH && text[i + 2] != separator)) {
+                return std::nullopt;
+            }
+            value = (value << 8) | u64(high << 4 | low);
+        }
+
+        return BdAddr(value);
+    }
+
+    /* Same as toString(), with `separator` between the bytes */
+    std::string format(char separator) const {
+        const auto DIGITS = "0123456789ABCDEF";
+        auto text = std::string(STRING_LENGTH, separator);
+        for (auto i = 0; i < 6; ++i) {
+            auto byte = u8(value >> (8 * (5 - i)));
+            text[3 * i] = DIGITS[byte >> 4];
+            text[3 * i + 1] = DIGITS[byte & 0xf];
+        }
+        return text;
+    }
+
+  public:
+    constexpr BdAddr() = default;
+
+    /**
+     * @param value Only the low 48 bits are kept
+     */
+    constexpr explicit BdAddr(u64 value) : value(value & 0xffffffffffff) {}
+
+    /**
+     * @brief Parse "XX:XX:XX:XX:XX:XX", hex digits in any case
+     *
+     * @return std::nullopt if `text` is not an address
+     */
+    static constexpr std::optional<BdAddr> parse(std::string_view text) {
+        return parse_with_separator(text, ':');
+    }
+
+    /**
+     * @brief Address of a device object, eg. "/org/bluez/hci0/dev_XX_XX_..."
+     *
+     * @param adapter_path If not empty, `object_path` must also be a device
+     * of this adapter
+     *
+     * @return std::nullopt if `object_path` is not a device object (objects
+     * under it, like its services, are not)
+     */
+    static constexpr std::optional<BdAddr>
+    fromObjectPath(std::string_view object_path,
+                   std::string_view adapter_path = "") {
+        auto slash = object_path.rfind('/');
+        if (slash == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        auto parent = object_path.substr(0, slash);
+        if (!adapter_path.empty() && parent != adapter_path) {
+            return std::nullopt;
+        }
+
+        auto name = object_path.substr(slash);
+        if (name.substr(0, DEVICE_PREFIX.size()) != DEVICE_PREFIX) {
+            return std::nullopt;
+        }
+
+        return parse_with_separator(name.substr(DEVICE_PREFIX.size()), '_');
+    }
+
+    constexpr u64 toU64() const { return value; }
+
+    /**
+     * @brief "XX:XX:XX:XX:XX:XX", upper case, same as bluez's Address
+     * property
+     */
+    std::string toString() const { return format(':'); }
+
+    /**
+     * @brief eg. "/org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX" for adapter
+     * "/org/bluez/hci0"
+     */
+    std::string toObjectPath(std::string_view adapter_path) const {
+        auto path = std::string(adapter_path);
+        path.append(DEVICE_PREFIX);
+        path.append(format('_'));
+        return path;
+    }
+
+    constexpr bool operator==(const BdAddr &other) const {
+        return value == other.value;
+    }
+    constexpr bool operator!=(const BdAddr &other) const {
+        return value != other.value;
+    }
+    constexpr bool operator<(const BdAddr &other) const {
+        return value < other.value;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const BdAddr &address) {
+    return out << address.toString();
+}
+
+namespace std {
+template <> struct hash<BdAddr> {
+    size_t operator()(const BdAddr &address) const {
+        return hash<u64>()(address.toU64());
+    }
+};
+} // namespace std
@@ -0,0 +1,180 @@
+/**
+ * @file bounded_ring.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Fixed size lock-free queue, to hand data from the event loop thread
+ * to other threads without ever blocking the event loop
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "declarations.h"
+
+/**
+ * @brief What push() does when the ring is full
+ */
+enum class OverflowPolicy {
+    /* Drop the value being pushed, keeping what consumers haven't read */
+    DROP_NEWEST,
+    /* Drop the oldest unread value, to make space for the new one */
+    DROP_OLDEST
+};
+
+/**
+ * @brief Bounded multi-producer multi-consumer ring of `T`, all slots are
+ * allocated once, in the constructor
+ *
+ * Each slot has a sequence number telling whether it is free for the
+ * producer of position `pos`, or holds a value for the consumer of `pos`,
+ * so producers and consumers only contend on their own position counter
+ *
+ * @references:
+ * 1. Dmitry Vyukov, "Bounded MPMC queue", 1024cores.net
+ */
+template <typename T> class BoundedRing {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "BoundedRing copies values in and out of preallocated "
+                  "slots, so T must be trivially copyable");
+
+    /* Own cache line for each, so a producer and a consumer touching
+     * neighbouring slots or counters don't invalidate each other's cache */
+    static constexpr size_t CACHE_LINE_B = 64;
+
+    struct alignas(CACHE_LINE_B) Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    OverflowPolicy policy;
+
+    alignas(CACHE_LINE_B) std::atomic<size_t> push_position{0};
+    alignas(CACHE_LINE_B) std::atomic<size_t> pop_position{0};
+    alignas(CACHE_LINE_B) std::atomic<u64> pushed_count{0};
+    std::atomic<u64> dropped_count{0};
+
+    static size_t round_up_to_power_of_2(size_t n) {
+        auto power = size_t(1);
+        while (power < n) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    bool try_push(const T &value) {
+        auto position = push_position.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &slots[position & mask];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = intptr_t(sequence) - intptr_t(position);
+            if (difference == 0) {
+                if (push_position.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                /* Slot still holds the value from one lap ago, full */
+                return false;
+            } else {
+                position = push_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = value;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+  public:
+    /**
+     * @param capacity Rounded up to a power of 2
+     */
+    explicit BoundedRing(size_t capacity,
+                         OverflowPolicy policy = OverflowPolicy::DROP_NEWEST)
+        : slots(new Slot[round_up_to_power_of_2(capacity)]),
+          mask(round_up_to_power_of_2(capacity) - 1), policy(policy) {
+        for (auto i = size_t(0); i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedRing(const BoundedRing &) = delete;
+    BoundedRing &operator=(const BoundedRing &) = delete;
+
+    /**
+     * @brief Never blocks or allocates, if full, drops a value as per the
+     * overflow policy
+     *
+     * @return false if `value` itself was dropped (DROP_NEWEST)
+     */
+    bool push(const T &value) {
+        while (!try_push(value)) {
+            if (policy == OverflowPolicy::DROP_NEWEST) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            /* A consumer may have made space meanwhile, in which case this
+             * pop fails and the push is simply retried */
+            T oldest;
+            if (tryPop(oldest)) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        pushed_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @return false if empty
+     */
+    bool tryPop(T &value) {
+        auto position = pop_position.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &slots[position & mask];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = intptr_t(sequence) - intptr_t(position + 1);
+            if (difference == 0) {
+                if (pop_position.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = pop_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = slot->value;
+        slot->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t getCapacity() const { return mask + 1; }
+
+    /**
+     * @brief Values accepted by push(), including ones dropped later by
+     * DROP_OLDEST
+     */
+    u64 getPushedCount() const {
+        return pushed_count.load(std::memory_order_relaxed);
+    }
+
+    u64 getDroppedCount() const {
+        return dropped_count.load(std::memory_order_relaxed);
+    }
+};
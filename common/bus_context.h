@@ -0,0 +1,127 @@
+/**
+ * @file bus_context.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief One long lived bus connection, shared by all proxies the library
+ * creates, instead of a temporary connection (and thread) per call
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "device_name_index.h"
+#include "object_tree.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+/**
+ * @brief Owns a bus connection and the thread running its event loop
+ *
+ * Every proxy created through a context is multiplexed over this one
+ * connection. Since the event loop always runs, blocking calls from any other
+ * thread get their replies through it, and signal handlers keep working
+ *
+ * @note Don't call enterEventLoop/leaveEventLoop on getConnection() yourself,
+ * the context owns the event loop
+ */
+class BusContext {
+    std::unique_ptr<sdbus::IConnection> connection;
+
+    /* Created on first use, since not every user needs bluez's objects */
+    std::once_flag object_tree_once;
+    std::unique_ptr<BluezObjectTree> object_tree;
+
+    std::once_flag device_name_index_once;
+    std::unique_ptr<DeviceNameIndex> device_name_index;
+
+  public:
+    /**
+     * @brief Take ownership of `connection` and start its event loop in a
+     * separate thread
+     */
+    explicit BusContext(std::unique_ptr<sdbus::IConnection> connection)
+        : connection(std::move(connection)) {
+        this->connection->enterEventLoopAsync();
+    }
+
+    BusContext(const BusContext &) = delete;
+    BusContext &operator=(const BusContext &) = delete;
+
+    ~BusContext() {
+        /* Stop the event loop first, so no signal handler runs on a half
+         * destroyed object tree */
+        connection->leaveEventLoop();
+        device_name_index.reset();
+        object_tree.reset();
+    }
+
+    sdbus::IConnection &getConnection() { return *connection; }
+
+    /**
+     * @brief Create a proxy on this context's connection
+     *
+     * @note Proxies are cheap, it's the connection that is expensive, so it
+     * is fine to create one per call
+     */
+    std::unique_ptr<sdbus::IProxy>
+    createProxy(const std::string &destination,
+                const std::string &object_path) {
+        return sdbus::createProxy(*connection, destination, object_path);
+    }
+
+    std::unique_ptr<sdbus::IProxy>
+    createBluezProxy(const std::string &object_path) {
+        return createProxy("org.bluez", object_path);
+    }
+
+    /**
+     * @brief Get the cache of bluez's objects, seeded on first call
+     */
+    BluezObjectTree &getObjectTree() {
+        std::call_once(object_tree_once, [this]() {
+            object_tree = std::make_unique<BluezObjectTree>(*connection);
+        });
+
+        return *object_tree;
+    }
+
+    /**
+     * @brief Get the index of device names, built from the object tree on
+     * first call, and kept current with it after that
+     */
+    DeviceNameIndex &getDeviceNameIndex() {
+        auto &tree = getObjectTree();
+        std::call_once(device_name_index_once, [this, &tree]() {
+            device_name_index = std::make_unique<DeviceNameIndex>(tree);
+        });
+
+        return *device_name_index;
+    }
+};
+
+/**
+ * @brief Get the system bus context used by default by the library functions
+ *
+ * Created on first call, and lives till the program exits
+ */
+inline BusContext &getDefaultBusContext() {
+    static auto context = BusContext(sdbus::createSystemBusConnection());
+    return context;
+}
+
+/**
+ * @brief Get the session bus context, obexd (file transfers) is on the
+ * session bus, not the system bus
+ *
+ * Created on first call, and lives till the program exits
+ */
+inline BusContext &getSessionBusContext() {
+    static auto context = BusContext(sdbus::createSessionBusConnection());
+    return context;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file byte_view.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Non-owning view of bytes, to hand values to handlers without copying
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "declarations.h"
+
+/**
+ * @brief Pointer and size of bytes owned by someone else, valid only as long
+ * as they are, so copy (toVector) what has to be kept
+ */
+class ByteView {
+    const u8 *bytes = nullptr;
+    size_t size_b = 0;
+
+  public:
+    constexpr ByteView() = default;
+    constexpr ByteView(const u8 *bytes, size_t size_b)
+        : bytes(bytes), size_b(size_b) {}
+    ByteView(const std::vector<u8> &value)
+        : bytes(value.data()), size_b(value.size()) {}
+
+    constexpr const u8 *data() const { return bytes; }
+    constexpr size_t size() const { return size_b; }
+    constexpr bool empty() const { return size_b == 0; }
+
+    constexpr const u8 *begin() const { return bytes; }
+    constexpr const u8 *end() const { return bytes + size_b; }
+
+    constexpr u8 operator[](size_t index) const { return bytes[index]; }
+
+    /**
+     * @brief Bytes from `offset`, at most `count` of them
+     */
+    constexpr ByteView subview(size_t offset, size_t count = size_t(-1)) const {
+        if (offset > size_b) {
+            offset = size_b;
+        }
+        if (count > size_b - offset) {
+            count = size_b - offset;
+        }
+        return ByteView(bytes + offset, count);
+    }
+
+    std::vector<u8> toVector() const { return std::vector<u8>(begin(), end()); }
+};
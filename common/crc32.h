@@ -0,0 +1,62 @@
+/**
+ * @file crc32.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief CRC-32 (IEEE 802.3, same as zlib), computed incrementally
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "byte_view.h"
+#include "declarations.h"
+
+namespace internal {
+constexpr std::array<u32, 256> make_crc32_table() {
+    /* Reflected polynomial */
+    const u32 POLYNOMIAL = 0xedb88320;
+    auto table = std::array<u32, 256>();
+    for (u32 i = 0; i < 256; ++i) {
+        auto crc = i;
+        for (auto bit = 0; bit < 8; ++bit) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ POLYNOMIAL;
+            } else {
+                crc >>= 1;
+            }
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<u32, 256> CRC32_TABLE = make_crc32_table();
+} // namespace internal
+
+/**
+ * @brief Running CRC-32, bytes can be added as they arrive, in any number of
+ * pieces
+ */
+class Crc32 {
+    u32 state = 0xffffffff;
+
+  public:
+    constexpr void update(ByteView bytes) {
+        for (auto byte : bytes) {
+            state = internal::CRC32_TABLE[(state ^ byte) & 0xff] ^ (state >> 8);
+        }
+    }
+
+    constexpr u32 get() const { return state ^ 0xffffffff; }
+
+    static constexpr u32 compute(ByteView bytes) {
+        auto crc = Crc32();
+        crc.update(bytes);
+        return crc.get();
+    }
+};
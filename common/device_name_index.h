@@ -0,0 +1,432 @@
+/**
+ * @file device_name_index.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Case-insensitive substring and prefix search over device names,
+ * kept current with the object tree
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bdaddr.h"
+#include "declarations.h"
+#include "object_tree.h"
+
+/**
+ * @brief Index from device Alias and Name to device, for lookups by a part of
+ * the name
+ *
+ * Every 1, 2 and 3 character substring (n-gram) of each lowercased name maps
+ * to the devices having it. A query of upto 3 characters is one map lookup,
+ * a longer one intersects the lists of its 3-grams, and only checks the few
+ * devices left. Prefix queries use a sorted set of names
+ *
+ * When constructed on a BluezObjectTree, it is seeded from the tree, and
+ * updated with the tree's listener as devices are added, removed or renamed
+ *
+ * @note Case folding is ASCII only, same as the linear search it replaces
+ */
+class DeviceNameIndex {
+  public:
+    struct Match {
+        std::string device_path;
+        BdAddr address;
+    };
+
+  private:
+    using DeviceId = u32;
+
+    struct Device {
+        std::string device_path;
+        BdAddr address;
+        /* Lowercased, without duplicates */
+        std::vector<std::string> names;
+    };
+
+    BluezObjectTree *tree = nullptr;
+    BluezObjectTree::ListenerId listener_id = 0;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, DeviceId> ids;
+    std::unordered_map<DeviceId, Device> devices;
+    DeviceId next_id = 0;
+
+    /* N-gram -> devices, sorted by id */
+    std::unordered_map<u32, std::vector<DeviceId>> postings;
+    /* (name, device), for prefix search */
+    std::set<std::pair<std::string, DeviceId>> sorted_names;
+
+    static constexpr size_t MAX_GRAM_LENGTH = 3;
+
+    static std::string to_lower(std::string_view text) {
+        auto lower = std::string(text);
+        for (auto &c : lower) {
+            c = char(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return lower;
+    }
+
+    /* Length in the top byte, so "a" and "a\0" differ */
+    static u32 gram_key(std::string_view gram) {
+        auto key = u32(gram.size()) << 24;
+        for (auto i = size_t(0); i < gram.size(); ++i) {
+            key |= u32(u8(gram[i])) << (8 * (2 - i));
+        }
+        return key;
+    }
+
+    /* Every distinct n-gram of `name`, for n from 1 to 3 */
+    static std::vector<u32> grams_of(const std::string &name) {
+        auto keys = std::vector<u32>();
+        for (auto length = size_t(1); length <= MAX_GRAM_LENGTH; ++length) {
+            for (auto i = size_t(0); i + length <= name.size(); ++i) {
+                keys.push_back(
+                    gram_key(std::string_view(name).substr(i, length)));
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    static std::vector<u32> grams_of(const std::vector<std::string> &names) {
+        auto keys = std::vector<u32>();
+        for (const auto &name : names) {
+            auto name_keys = grams_of(name);
+            keys.insert(keys.end(), name_keys.begin(), name_keys.end());
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    void index_names(DeviceId id, const std::vector<std::string> &names) {
+        for (auto key : grams_of(names)) {
+            auto &list = postings[key];
+            list.insert(std::lower_bound(list.begin(), list.end(), id), id);
+        }
+        for (const auto &name : names) {
+            sorted_names.emplace(name, id);
+        }
+    }
+
+    void unindex_names(DeviceId id, const std::vector<std::string> &names) {
+        for (auto key : grams_of(names)) {
+            auto list = postings.find(key);
+            if (list == postings.end()) {
+                continue;
+            }
+            auto position = std::lower_bound(list->second.begin(),
+                                             list->second.end(), id);
+            if (position != list->second.end() && *position == id) {
+                list->second.erase(position);
+            }
+            if (list->second.empty()) {
+                postings.erase(list);
+            }
+        }
+        for (const auto &name : names) {
+            sorted_names.erase({name, id});
+        }
+    }
+
+    /* Devices whose names may contain `query` (already lowercased), exact
+     * for queries of upto 3 characters */
+    std::vector<DeviceId> candidates_for(const std::string &query) const {
+        if (query.size() <= MAX_GRAM_LENGTH) {
+            auto list = postings.find(gram_key(query));
+            if (list == postings.end()) {
+                return {};
+            }
+            return list->second;
+        }
+
+        /* Intersect the shortest lists first, so the result shrinks fast */
+        auto lists = std::vector<const std::vector<DeviceId> *>();
+        for (auto i = size_t(0); i + MAX_GRAM_LENGTH <= query.size(); ++i) {
+            auto list = postings.find(gram_key(
+                std::string_view(query).substr(i, MAX_GRAM_LENGTH)));
+            if (list == postings.end()) {
+                return {};
+            }
+            lists.push_back(&list->second);
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<DeviceId> *a,
+                     const std::vector<DeviceId> *b) {
+                      return a->size() < b->size();
+                  });
+
+        auto result = *lists.front();
+        for (auto i = size_t(1); i < lists.size() && !result.empty(); ++i) {
+            auto intersection = std::vector<DeviceId>();
+            std::set_intersection(result.begin(), result.end(),
+                                  lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(intersection));
+            result = std::move(intersection);
+        }
+
+        /* Having all 3-grams doesn't mean having them in order */
+        result.erase(std::remove_if(result.begin(), result.end(),
+                                    [this, &query](DeviceId id) {
+                                        return !has_substring(id, query);
+                                    }),
+                     result.end());
+        return result;
+    }
+
+    bool has_substring(DeviceId id, const std::string &query) const {
+        const auto &names = devices.at(id).names;
+        return std::any_of(names.begin(), names.end(),
+                           [&query](const std::string &name) {
+                               return name.find(query) != std::string::npos;
+                           });
+    }
+
+    static bool is_in_adapter(const Device &device,
+                              std::string_view adapter_path) {
+        return adapter_path.empty() ||
+               BdAddr::fromObjectPath(device.device_path, adapter_path);
+    }
+
+    static std::vector<std::string>
+    names_of(const BluezObjectTree::Properties &properties) {
+        auto names = std::vector<std::string>();
+        for (auto property : {"Alias", "Name"}) {
+            auto value = properties.find(property);
+            if (value != properties.end()) {
+                names.push_back(value->second.get<std::string>());
+            }
+        }
+        return names;
+    }
+
+    void on_change(const BluezObjectTree::Change &change) {
+        if (change.kind == BluezObjectTree::Change::Kind::REMOVED) {
+            remove(change.object_path);
+            return;
+        }
+
+        /* Most changes are RSSI and such, skip reading the properties */
+        if (change.kind == BluezObjectTree::Change::Kind::PROPERTIES_CHANGED &&
+            std::none_of(change.changed.begin(), change.changed.end(),
+                         [](const std::string &name) {
+                             return name == "Alias" || name == "Name";
+                         })) {
+            return;
+        }
+
+        update(change.object_path, names_of(change.properties));
+    }
+
+  public:
+    /**
+     * @brief Empty index, filled only by update() and remove()
+     */
+    DeviceNameIndex() = default;
+
+    /**
+     * @brief Index all devices in `tree`, and keep following it
+     */
+    explicit DeviceNameIndex(BluezObjectTree &tree) : tree(&tree) {
+        /* Listen before seeding, a device changed in between is just
+         * updated twice, with same result */
+        listener_id = tree.addListener(
+            "org.bluez.Device1",
+            [this](const BluezObjectTree::Change &change) {
+                on_change(change);
+            });
+
+        tree.forEachObjectWithInterface(
+            "org.bluez.Device1",
+            [this](const sdbus::ObjectPath &object_path,
+                   const BluezObjectTree::Properties &properties) {
+                update(object_path, names_of(properties));
+            });
+    }
+
+    DeviceNameIndex(const DeviceNameIndex &) = delete;
+    DeviceNameIndex &operator=(const DeviceNameIndex &) = delete;
+
+    ~DeviceNameIndex() {
+        if (tree) {
+            tree->removeListener(listener_id);
+        }
+    }
+
+    /**
+     * @brief Set the names of a device, adding it if not known
+     *
+     * Ignored if `device_path` is not a device object path
+     */
+    void update(const std::string &device_path,
+                const std::vector<std::string> &names) {
+        auto address = BdAddr::fromObjectPath(device_path);
+        if (!address) {
+            return;
+        }
+
+        auto lower_names = std::vector<std::string>();
+        for (const auto &name : names) {
+            lower_names.push_back(to_lower(name));
+        }
+        std::sort(lower_names.begin(), lower_names.end());
+        lower_names.erase(std::unique(lower_names.begin(), lower_names.end()),
+                          lower_names.end());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto known = ids.find(device_path);
+        if (known != ids.end()) {
+            auto &device = devices.at(known->second);
+            if (device.names == lower_names) {
+                return;
+            }
+            unindex_names(known->second, device.names);
+            device.names = std::move(lower_names);
+            index_names(known->second, device.names);
+            return;
+        }
+
+        auto id = next_id++;
+        ids.emplace(device_path, id);
+        auto &device =
+            devices
+                .emplace(id, Device{device_path, *address,
+                                    std::move(lower_names)})
+                .first->second;
+        index_names(id, device.names);
+    }
+
+    void remove(const std::string &device_path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto known = ids.find(device_path);
+        if (known == ids.end()) {
+            return;
+        }
+
+        unindex_names(known->second, devices.at(known->second).names);
+        devices.erase(known->second);
+        ids.erase(known);
+    }
+
+    /**
+     * @brief Devices with `text` anywhere in their alias or name, ignoring
+     * case, sorted by object path
+     *
+     * @param adapter_path If not empty, only devices of this adapter
+     */
+    std::vector<Match>
+    findBySubstring(std::string_view text,
+                    std::string_view adapter_path = "") const {
+        auto query = to_lower(text);
+        auto matches = std::vector<Match>();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (query.empty()) {
+            for (const auto &device : devices) {
+                if (is_in_adapter(device.second, adapter_path)) {
+                    matches.push_back(
+                        {device.second.device_path, device.second.address});
+                }
+            }
+        } else {
+            for (auto id : candidates_for(query)) {
+                const auto &device = devices.at(id);
+                if (is_in_adapter(device, adapter_path)) {
+                    matches.push_back({device.device_path, device.address});
+                }
+            }
+        }
+
+        std::sort(matches.begin(), matches.end(),
+                  [](const Match &a, const Match &b) {
+                      return a.device_path < b.device_path;
+                  });
+        return matches;
+    }
+
+    /**
+     * @brief First device (by object path) with `text` in its alias or name,
+     * without building the list of all matches
+     */
+    std::optional<Match>
+    findFirstBySubstring(std::string_view text,
+                         std::string_view adapter_path = "") const {
+        auto query = to_lower(text);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const Device *first = nullptr;
+        auto consider = [&first, adapter_path](const Device &device) {
+            if (is_in_adapter(device, adapter_path) &&
+                (!first || device.device_path < first->device_path)) {
+                first = &device;
+            }
+        };
+
+        if (query.empty()) {
+            for (const auto &device : devices) {
+                consider(device.second);
+            }
+        } else {
+            for (auto id : candidates_for(query)) {
+                consider(devices.at(id));
+            }
+        }
+
+        if (!first) {
+            return std::nullopt;
+        }
+        return Match{first->device_path, first->address};
+    }
+
+    /**
+     * @brief Devices whose alias or name starts with `prefix`, ignoring case,
+     * sorted by object path
+     */
+    std::vector<Match> findByPrefix(std::string_view prefix,
+                                    std::string_view adapter_path = "") const {
+        auto query = to_lower(prefix);
+        auto found = std::set<DeviceId>();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto name = sorted_names.lower_bound({query, 0});
+             name != sorted_names.end() &&
+             name->first.compare(0, query.size(), query) == 0;
+             ++name) {
+            found.insert(name->second);
+        }
+
+        auto matches = std::vector<Match>();
+        for (auto id : found) {
+            const auto &device = devices.at(id);
+            if (is_in_adapter(device, adapter_path)) {
+                matches.push_back({device.device_path, device.address});
+            }
+        }
+        std::sort(matches.begin(), matches.end(),
+                  [](const Match &a, const Match &b) {
+                      return a.device_path < b.device_path;
+                  });
+        return matches;
+    }
+
+    size_t getDeviceCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return devices.size();
+    }
+};
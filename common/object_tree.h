@@ -0,0 +1,350 @@
+/**
+ * @file object_tree.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Live cache of the object tree exported by bluez, so lookups like
+ * "which devices are known" don't need a GetManagedObjects round trip
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sdbus-c++/sdbus-c++.h"
+
+/**
+ * @brief Mirror of what `GetManagedObjects` on org.bluez would return
+ *
+ * It is seeded once with GetManagedObjects, and after that is kept current
+ * with the InterfacesAdded, InterfacesRemoved and PropertiesChanged signals
+ * bluez emits, so all queries are answered from memory
+ *
+ * @note The event loop of the passed connection must be running (eg. with
+ * enterEventLoopAsync) for the tree to receive updates
+ *
+ * @devnotes: Queries hold one exclusive lock, and not a shared one, since
+ * sdbus::Variant::get() rewinds the message inside the variant, so even
+ * 'reading' a variant from two threads is not safe
+ */
+class BluezObjectTree {
+  public:
+    using Properties = std::map<std::string, sdbus::Variant>;
+    using Interfaces = std::map<std::string, Properties>;
+    using Objects = std::map<sdbus::ObjectPath, Interfaces>;
+
+    /**
+     * @brief A change to one interface of one object, as seen by listeners
+     */
+    struct Change {
+        enum class Kind { ADDED, PROPERTIES_CHANGED, REMOVED };
+
+        Kind kind;
+        const sdbus::ObjectPath &object_path;
+        const std::string &interface;
+
+        /* All properties of the interface after the change (before it, for
+         * REMOVED) */
+        const Properties &properties;
+
+        /* Names of properties changed or invalidated, all of them for ADDED
+         */
+        std::vector<std::string> changed;
+    };
+
+    using Listener = std::function<void(const Change &change)>;
+    using ListenerId = unsigned long;
+
+  private:
+    sdbus::IConnection &connection;
+    sdbus::Slot object_manager_slot;
+    sdbus::Slot properties_changed_slot;
+
+    mutable std::mutex mutex;
+    Objects objects;
+
+    /* Listeners, with the interface each one listens to */
+    std::map<ListenerId, std::pair<std::string, Listener>> listeners;
+    ListenerId next_listener_id = 1;
+
+    void notify_listeners(const Change &change) {
+        for (const auto &listener : listeners) {
+            if (listener.second.first == change.interface) {
+                listener.second.second(change);
+            }
+        }
+    }
+
+    /* Signals that arrive while GetManagedObjects is still in flight are
+     * kept here, and replayed (in order) over the GetManagedObjects result */
+    bool is_seeded = false;
+    std::vector<std::function<void()>> pending_updates;
+
+    void apply_interfaces_added(const sdbus::ObjectPath &object_path,
+                                Interfaces &interfaces) {
+        auto &object = objects[object_path];
+        for (auto &iface : interfaces) {
+            auto &properties = object[iface.first];
+            auto changed = std::vector<std::string>();
+            for (auto &property : iface.second) {
+                changed.push_back(property.first);
+                properties[property.first] = std::move(property.second);
+            }
+
+            notify_listeners({Change::Kind::ADDED, object_path, iface.first,
+                              properties, std::move(changed)});
+        }
+    }
+
+    void apply_interfaces_removed(const sdbus::ObjectPath &object_path,
+                                  const std::vector<std::string> &interfaces) {
+        auto object = objects.find(object_path);
+        if (object == objects.end()) {
+            return;
+        }
+
+        for (const auto &iface : interfaces) {
+            auto properties = object->second.find(iface);
+            if (properties == object->second.end()) {
+                continue;
+            }
+
+            notify_listeners({Change::Kind::REMOVED, object_path, iface,
+                              properties->second, {}});
+            object->second.erase(properties);
+        }
+
+        if (object->second.empty()) {
+            objects.erase(object);
+        }
+    }
+
+    void apply_properties_changed(const sdbus::ObjectPath &object_path,
+                                  const std::string &interface,
+                                  Properties &changed,
+                                  const std::vector<std::string> &invalidated) {
+        auto object = objects.find(object_path);
+        if (object == objects.end()) {
+            /* PropertiesChanged for an object we were never told about, eg.
+             * the adapter's "/org/bluez" itself, nothing to update */
+            return;
+        }
+
+        auto iface = object->second.find(interface);
+        if (iface == object->second.end()) {
+            return;
+        }
+
+        auto names = invalidated;
+        for (auto &property : changed) {
+            names.push_back(property.first);
+            iface->second[property.first] = std::move(property.second);
+        }
+        for (const auto &name : invalidated) {
+            iface->second.erase(name);
+        }
+
+        notify_listeners({Change::Kind::PROPERTIES_CHANGED, object_path,
+                          interface, iface->second, std::move(names)});
+    }
+
+    /* Runs `update` now if seeded, else defers it till seeding completes.
+     * Called on the event loop thread */
+    void apply_or_defer(std::function<void()> update) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (is_seeded) {
+            update();
+        } else {
+            pending_updates.push_back(std::move(update));
+        }
+    }
+
+    void on_object_manager_signal(sdbus::Message &msg) {
+        sdbus::ObjectPath object_path;
+        msg >> object_path;
+
+        if (msg.getMemberName() == "InterfacesAdded") {
+            auto interfaces = Interfaces();
+            msg >> interfaces;
+            apply_or_defer([this, object_path,
+                            interfaces = std::move(interfaces)]() mutable {
+                apply_interfaces_added(object_path, interfaces);
+            });
+        } else if (msg.getMemberName() == "InterfacesRemoved") {
+            auto interfaces = std::vector<std::string>();
+            msg >> interfaces;
+            apply_or_defer(
+                [this, object_path, interfaces = std::move(interfaces)]() {
+                    apply_interfaces_removed(object_path, interfaces);
+                });
+        }
+    }
+
+    void on_properties_changed(sdbus::Message &msg) {
+        auto interface = std::string();
+        auto changed = Properties();
+        auto invalidated = std::vector<std::string>();
+        msg >> interface >> changed >> invalidated;
+
+        apply_or_defer([this, object_path = sdbus::ObjectPath(msg.getPath()),
+                        interface = std::move(interface),
+                        changed = std::move(changed),
+                        invalidated = std::move(invalidated)]() mutable {
+            apply_properties_changed(object_path, interface, changed,
+                                     invalidated);
+        });
+    }
+
+    /* Only called once, from the constructor */
+    void seed_from_managed_objects() {
+        auto result = Objects();
+        sdbus::createProxy(connection, "org.bluez", "/")
+            ->callMethod("GetManagedObjects")
+            .onInterface("org.freedesktop.DBus.ObjectManager")
+            .storeResultsTo(result);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        objects = std::move(result);
+
+        /* Replaying signals that were sent before the GetManagedObjects reply
+         * is harmless, since they are replayed in order, the end state is
+         * same as the reply */
+        for (auto &update : pending_updates) {
+            update();
+        }
+        pending_updates.clear();
+        is_seeded = true;
+    }
+
+  public:
+    /**
+     * @brief Subscribe to bluez's object manager signals and seed the tree
+     *
+     * @param connection Connection to the system bus, whose event loop is
+     * running or will be started after this constructor
+     */
+    explicit BluezObjectTree(sdbus::IConnection &connection)
+        : connection(connection) {
+        /* Subscribe BEFORE seeding, so no change between the seed and the
+         * subscription can be missed */
+        object_manager_slot = connection.addMatch(
+            "type='signal',sender='org.bluez',path='/',"
+            "interface='org.freedesktop.DBus.ObjectManager'",
+            [this](sdbus::Message &msg) { on_object_manager_signal(msg); });
+
+        properties_changed_slot = connection.addMatch(
+            "type='signal',sender='org.bluez',path_namespace='/org/bluez',"
+            "interface='org.freedesktop.DBus.Properties',"
+            "member='PropertiesChanged'",
+            [this](sdbus::Message &msg) { on_properties_changed(msg); });
+
+        seed_from_managed_objects();
+    }
+
+    BluezObjectTree(const BluezObjectTree &) = delete;
+    BluezObjectTree &operator=(const BluezObjectTree &) = delete;
+
+    /**
+     * @brief Call `callback(object_path, properties)` for every object that
+     * implements `interface`, properties are of that interface
+     *
+     * @note The tree is locked while callback runs, so don't call back into
+     * the tree from it
+     */
+    template <typename Callback>
+    void forEachObjectWithInterface(const std::string &interface,
+                                    Callback &&callback) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &object : objects) {
+            auto iface = object.second.find(interface);
+            if (iface != object.second.cend()) {
+                callback(object.first, iface->second);
+            }
+        }
+    }
+
+    /**
+     * @brief Find first object (in path order) implementing `interface`
+     *
+     * @return std::nullopt if no such object
+     */
+    std::optional<sdbus::ObjectPath>
+    findObjectWithInterface(const std::string &interface) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &object : objects) {
+            if (object.second.find(interface) != object.second.cend()) {
+                return object.first;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get a cached property value
+     *
+     * @return std::nullopt if object, interface or property is not known
+     */
+    std::optional<sdbus::Variant> getProperty(const std::string &object_path,
+                                              const std::string &interface,
+                                              const std::string &name) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto object = objects.find(sdbus::ObjectPath(object_path));
+        if (object == objects.cend()) {
+            return std::nullopt;
+        }
+
+        auto iface = object->second.find(interface);
+        if (iface == object->second.cend()) {
+            return std::nullopt;
+        }
+
+        auto property = iface->second.find(name);
+        if (property == iface->second.cend()) {
+            return std::nullopt;
+        }
+
+        return std::optional<sdbus::Variant>(std::in_place,
+                                             property->second);
+    }
+
+    /**
+     * @brief Call `listener` for every change to an object's `interface`,
+     * after the change is applied to the tree
+     *
+     * @note Listeners run on the event loop thread, with the tree locked, so
+     * they must not block, or call into the tree (including removeListener)
+     */
+    ListenerId addListener(const std::string &interface, Listener listener) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto id = next_listener_id++;
+        listeners.emplace(id, std::make_pair(interface, std::move(listener)));
+        return id;
+    }
+
+    /**
+     * @brief Once this returns, the listener is not running, and won't be
+     * called again
+     */
+    void removeListener(ListenerId id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        listeners.erase(id);
+    }
+
+    /**
+     * @brief Copy of the whole tree, prefer the other queries, this one
+     * copies everything
+     */
+    Objects getManagedObjects() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects;
+    }
+};
@@ -0,0 +1,141 @@
+/**
+ * @file timer_queue.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief One thread running tasks at their deadlines, for everything that
+ * has to happen 'later' (rate limits, retries, timeouts), instead of a
+ * sleeping thread per task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "declarations.h"
+
+/**
+ * @brief Runs scheduled tasks, in order of their deadlines, on its own thread
+ *
+ * Tasks should be short, as they delay the tasks after them
+ */
+class TimerQueue {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = u64;
+    using Task = std::function<void()>;
+
+  private:
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    /* Ordered by deadline, ties by order of scheduling */
+    std::map<std::pair<Clock::time_point, TimerId>, Task> timers;
+    std::map<TimerId, Clock::time_point> deadlines;
+    TimerId next_id = 1;
+
+    /* Timer whose task is running now, 0 if none */
+    TimerId running_id = 0;
+    bool is_running = true;
+
+    std::thread thread;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (is_running) {
+            if (timers.empty()) {
+                changed.wait(lock);
+                continue;
+            }
+
+            auto first = timers.begin();
+            if (Clock::now() < first->first.first) {
+                changed.wait_until(lock, first->first.first);
+                continue;
+            }
+
+            auto id = first->first.second;
+            auto task = std::move(first->second);
+            timers.erase(first);
+            deadlines.erase(id);
+
+            running_id = id;
+            lock.unlock();
+            task();
+            lock.lock();
+            running_id = 0;
+            changed.notify_all();
+        }
+    }
+
+  public:
+    TimerQueue() : thread([this]() { run(); }) {}
+
+    TimerQueue(const TimerQueue &) = delete;
+    TimerQueue &operator=(const TimerQueue &) = delete;
+
+    /**
+     * @brief Stop the thread, tasks not yet run are dropped
+     */
+    ~TimerQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_running = false;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    TimerId scheduleAt(Clock::time_point deadline, Task task) {
+        auto id = TimerId();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            id = next_id++;
+            timers.emplace(std::make_pair(deadline, id), std::move(task));
+            deadlines.emplace(id, deadline);
+        }
+        changed.notify_all();
+
+        return id;
+    }
+
+    TimerId scheduleAfter(Clock::duration delay, Task task) {
+        return scheduleAt(Clock::now() + delay, std::move(task));
+    }
+
+    /**
+     * @brief Cancel a timer, if its task is running, wait for it to finish
+     * (unless called from the task itself)
+     *
+     * @return false if the task already ran (or is running), or no such timer
+     */
+    bool cancel(TimerId id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto deadline = deadlines.find(id);
+        if (deadline != deadlines.end()) {
+            timers.erase(std::make_pair(deadline->second, id));
+            deadlines.erase(deadline);
+            return true;
+        }
+
+        if (!isTimerThread()) {
+            changed.wait(lock, [this, id]() { return running_id != id; });
+        }
+        return false;
+    }
+
+    /**
+     * @brief Whether the caller is running inside a task of this queue
+     */
+    bool isTimerThread() const {
+        return std::this_thread::get_id() == thread.get_id();
+    }
+};
@@ -0,0 +1,118 @@
+/**
+ * @file value_buffer.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Ref-counted read only bytes, and a pool of the vectors behind them,
+ * so characteristic values are shared instead of copied, and reused instead
+ * of allocated
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "byte_view.h"
+#include "declarations.h"
+
+/**
+ * @brief A value that can't change once made, copying it copies a reference,
+ * so one value can be handed to any number of readers
+ */
+class ValueBuffer {
+    std::shared_ptr<const std::vector<u8>> bytes;
+
+  public:
+    ValueBuffer() = default;
+    explicit ValueBuffer(std::vector<u8> value)
+        : bytes(std::make_shared<const std::vector<u8>>(std::move(value))) {}
+    /* Eg. from ValueBufferPool::acquire(), `bytes` must not be changed
+     * after */
+    ValueBuffer(std::shared_ptr<const std::vector<u8>> bytes)
+        : bytes(std::move(bytes)) {}
+
+    const std::vector<u8> &get() const {
+        static const auto EMPTY = std::vector<u8>();
+        if (!bytes) {
+            return EMPTY;
+        }
+        return *bytes;
+    }
+
+    ByteView view() const { return ByteView(get()); }
+    const u8 *data() const { return get().data(); }
+    size_t size() const {
+        if (!bytes) {
+            return 0;
+        }
+        return bytes->size();
+    }
+    bool empty() const { return size() == 0; }
+};
+
+/**
+ * @brief Vectors that keep their capacity between uses, so filling one is a
+ * copy, not an allocation (after the first few)
+ *
+ * A vector is back in the pool once the last reference to it, or to the
+ * ValueBuffer made from it, is dropped. If all are in use, a new one is made,
+ * kept if the pool isn't full
+ */
+class ValueBufferPool {
+    std::mutex mutex;
+    /* The pool's own reference, the vector is free when it is the only
+     * one */
+    std::vector<std::shared_ptr<std::vector<u8>>> buffers;
+    size_t max_buffers;
+    /* Where the last search stopped, the next free one is likely after it */
+    size_t next = 0;
+
+  public:
+    explicit ValueBufferPool(size_t max_buffers = 32)
+        : max_buffers(max_buffers) {}
+
+    ValueBufferPool(const ValueBufferPool &) = delete;
+    ValueBufferPool &operator=(const ValueBufferPool &) = delete;
+
+    /**
+     * @brief An empty vector, to fill, then share as a ValueBuffer, or use
+     * and drop
+     */
+    std::shared_ptr<std::vector<u8>> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            /* Only the pool holds it, and nobody can copy it from the pool
+             * but us, so it stays free */
+            for (auto i = size_t(0); i < buffers.size(); ++i) {
+                auto &buffer = buffers[(next + i) % buffers.size()];
+                if (buffer.use_count() == 1) {
+                    /* Pairs with the release of the last user's reference,
+                     * so its use of the bytes happened before ours */
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    next = (next + i + 1) % buffers.size();
+                    buffer->clear();
+                    return buffer;
+                }
+            }
+            if (buffers.size() < max_buffers) {
+                buffers.push_back(std::make_shared<std::vector<u8>>());
+                return buffers.back();
+            }
+        }
+        return std::make_shared<std::vector<u8>>();
+    }
+
+    /**
+     * @brief Pool shared by all characteristics
+     */
+    static ValueBufferPool &getDefault() {
+        static auto pool = ValueBufferPool();
+        return pool;
+    }
+};
@@ -0,0 +1,126 @@
+/**
+ * @file bluez.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief A stand-in for the bluez daemon (org.bluez), to run the library
+ * without bluetooth hardware, eg. for benchmarks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "declarations.h"
+#include "timer_queue.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+struct MockBluezConfig {
+    unsigned int adapter_count = 1;
+    unsigned int devices_per_adapter = 10;
+
+    /* How long Device1.Connect takes to reply, 0 replies immediately */
+    std::chrono::milliseconds connect_delay_ms{0};
+
+    /* First this many Connect calls to every device fail (after the delay),
+     * like LE connections the controller gave up on */
+    unsigned int failed_connects_per_device = 0;
+
+    /* Same as the adapter in logs/controller_primary_arch.log */
+    u8 supported_advertising_instances = 5;
+
+    /* Readable characteristics in one primary service of every device, see
+     * MockBluez::getCharacteristicUuid() */
+    unsigned int characteristics_per_device = 0;
+
+    /* How long one ReadValue takes over the air, reads of a device are
+     * served one after other, like ATT requests */
+    std::chrono::milliseconds read_delay_ms{0};
+};
+
+/**
+ * @brief Exports adapters (Adapter1, LEAdvertisingManager1, GattManager1) and
+ * devices
+ * (Device1, and GattService1/GattCharacteristic1 below them) like bluez does,
+ * with properties modelled on the dumps in logs/
+ *
+ * Object paths are also same as bluez, ie. "/org/bluez/hciN" for adapters and
+ * "/org/bluez/hciN/dev_XX_XX_XX_XX_XX_XX" for devices, and "/" implements
+ * org.freedesktop.DBus.ObjectManager
+ *
+ * @note It requests the name "org.bluez" on the passed connection, so it
+ * should be a connection to a private bus (see PrivateBus). Event loop of
+ * the connection must be run by the caller
+ */
+class MockBluez {
+  public:
+    class Adapter;
+    class Device;
+
+  private:
+    sdbus::IConnection &connection;
+    MockBluezConfig config;
+    std::unique_ptr<sdbus::IObject> root;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Adapter>> adapters;
+    std::vector<std::unique_ptr<Device>> devices;
+
+    /* Replies to delayed method calls, last member so it is stopped before
+     * the devices are destroyed */
+    TimerQueue delayed_replies;
+
+  public:
+    MockBluez(sdbus::IConnection &connection, MockBluezConfig config = {});
+
+    MockBluez(const MockBluez &) = delete;
+    MockBluez &operator=(const MockBluez &) = delete;
+
+    ~MockBluez();
+
+    /**
+     * @brief Add a device under adapter `adapter_index`, announced with
+     * InterfacesAdded
+     *
+     * @param address Address in form of eg. XX:XX:XX:XX:XX:XX
+     */
+    void addDevice(unsigned int adapter_index, const std::string &address,
+                   const std::string &name);
+
+    /**
+     * @brief Remove a device, announced with InterfacesRemoved
+     *
+     * @return false if no such device
+     */
+    bool removeDevice(const std::string &device_object_path);
+
+    std::string getAdapterPath(unsigned int adapter_index) const;
+
+    /**
+     * @brief Addresses of all devices, in the order they were added
+     */
+    std::vector<std::string> getDeviceAddresses() const;
+
+    /**
+     * @brief Names of all devices, in the order they were added
+     */
+    std::vector<std::string> getDeviceNames() const;
+
+    const MockBluezConfig &getConfig() const;
+
+    /**
+     * @brief UUID of the `index`th characteristic of every device
+     */
+    static std::string getCharacteristicUuid(unsigned int index);
+
+    /* Used by Device and Adapter, for replies that have to be sent later */
+    void runDelayed(std::chrono::milliseconds delay_ms,
+                    std::function<void()> task);
+};
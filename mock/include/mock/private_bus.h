@@ -0,0 +1,49 @@
+/**
+ * @file private_bus.h
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief A private dbus-daemon, so the mock bluez (and library calls going to
+ * it) never touch the real system bus
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief Spawns `dbus-daemon --session` as a child process, and points this
+ * process's DBUS_SYSTEM_BUS_ADDRESS and DBUS_SESSION_BUS_ADDRESS at it
+ *
+ * So, after constructing it, sdbus::createSystemBusConnection() (and hence
+ * getDefaultBusContext()) connect to the private bus
+ *
+ * @note Must be constructed before the first connection is created, and
+ * there should be only one at a time, since it changes the environment
+ */
+class PrivateBus {
+    pid_t daemon_pid = -1;
+    std::string address;
+
+  public:
+    /**
+     * @throws std::runtime_error if dbus-daemon could not be started
+     */
+    PrivateBus();
+
+    PrivateBus(const PrivateBus &) = delete;
+    PrivateBus &operator=(const PrivateBus &) = delete;
+
+    /**
+     * @brief Terminate the daemon
+     */
+    ~PrivateBus();
+
+    /**
+     * @brief Address of the bus, eg. "unix:abstract=/tmp/dbus-XXXX,guid=..."
+     */
+    const std::string &getAddress() const;
+};
@@ -0,0 +1,36 @@
+/**
+ * @file main.cpp
+ * @brief Standalone mock bluez daemon, to run test_ble/test_bluetooth (or any
+ * program using the library) against it instead of real hardware
+ *
+ * Usage:
+ *   dbus-daemon --session --print-address --fork  # note the address
+ *   export DBUS_SYSTEM_BUS_ADDRESS=<that address>
+ *   ./mock_bluezd [adapters] [devices per adapter] &
+ */
+
+#include <iostream>
+#include <string>
+
+#include "mock/bluez.h"
+#include "sdbus-c++/sdbus-c++.h"
+
+int main(int argc, char *argv[]) {
+    auto config = MockBluezConfig();
+    if (argc > 1) {
+        config.adapter_count = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        config.devices_per_adapter = std::stoul(argv[2]);
+    }
+
+    auto connection = sdbus::createSystemBusConnection();
+    auto bluez = MockBluez(*connection, config);
+
+    std::cout << "Mock org.bluez running with " << config.adapter_count
+              << " adapter(s), " << config.devices_per_adapter
+              << " device(s) each, on " << connection->getUniqueName()
+              << std::endl;
+
+    connection->enterEventLoop();
+}
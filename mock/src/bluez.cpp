@@ -0,0 +1,684 @@
+/**
+ * @file bluez.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Implementation of the mock bluez daemon's adapters and devices
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mock/bluez.h"
+
+using std::string, std::vector, std::map;
+
+namespace {
+const auto BLUEZ_DBUS_NAME = "org.bluez";
+const auto ADAPTER_IFACE = "org.bluez.Adapter1";
+const auto ADVERTISING_MANAGER_IFACE = "org.bluez.LEAdvertisingManager1";
+const auto DEVICE_IFACE = "org.bluez.Device1";
+const auto GATT_MANAGER_IFACE = "org.bluez.GattManager1";
+const auto GATT_SERVICE_IFACE = "org.bluez.GattService1";
+const auto GATT_CHARACTERISTIC_IFACE = "org.bluez.GattCharacteristic1";
+
+/* Device Information, and the 16 bit UUIDs after "Device Name" (0x2a00) */
+const auto DEVICE_SERVICE_UUID = "0000180a-0000-1000-8000-00805f9b34fb";
+const u16 FIRST_CHARACTERISTIC_UUID16 = 0x2a00;
+
+/* Seen in logs/, so the mock devices look like what we met in practice */
+const vector<string> DEVICE_NAME_PREFIXES = {
+    "motorola one power", "Rockerz 450",   "Mi Smart Band 5",
+    "JBL Flip 5",         "Nordic_HRM",    "Galaxy Buds Live",
+    "LE-Bose QC35",       "Thingy Sensor",
+};
+
+/* Class of Device for a smartphone, and the modalias of logs/ adapter */
+const u32 PHONE_DEVICE_CLASS = 0x5a020c;
+const u32 ADAPTER_CLASS = 268;
+const u32 DISCOVERABLE_TIMEOUT_S = 180;
+
+const i16 STRONGEST_RSSI_DBM = -40;
+const unsigned int RSSI_SPREAD_DBM = 55;
+const u16 APPLE_COMPANY_ID = 0x004c;
+
+/* Address in form of XX:XX:XX:XX:XX:XX, generated from two indices, so it
+ * is unique and stable between runs */
+string make_address(unsigned int adapter_index, unsigned int device_index) {
+    char address[sizeof("XX:XX:XX:XX:XX:XX")];
+    (void)std::snprintf(address, sizeof(address), "30:4B:%02X:%02X:%02X:%02X",
+                        adapter_index & 0xff, (device_index >> 16) & 0xff,
+                        (device_index >> 8) & 0xff, device_index & 0xff);
+    return address;
+}
+} // namespace
+
+class MockBluez::Device {
+    MockBluez &bluez;
+    std::unique_ptr<sdbus::IObject> object;
+    string address;
+    string name;
+    std::atomic<bool> is_connected{false};
+    std::atomic<unsigned int> connect_count{0};
+
+    std::unique_ptr<sdbus::IObject> service;
+    vector<std::unique_ptr<sdbus::IObject>> characteristics;
+
+    /* Reads are served one after other, this is when the last one ends */
+    std::mutex air_mutex;
+    TimerQueue::Clock::time_point air_busy_until;
+
+    /* Time from now till a read of `duration`, queued after the ones already
+     * in flight, completes */
+    std::chrono::milliseconds reserve_air_time(
+        std::chrono::milliseconds duration) {
+        std::lock_guard<std::mutex> lock(air_mutex);
+        auto now = TimerQueue::Clock::now();
+        air_busy_until = std::max(now, air_busy_until) + duration;
+        return std::chrono::ceil<std::chrono::milliseconds>(air_busy_until -
+                                                            now);
+    }
+
+    void add_gatt_objects(unsigned int seed) {
+        auto count = bluez.getConfig().characteristics_per_device;
+        if (count == 0) {
+            return;
+        }
+
+        auto device_path = object->getObjectPath();
+        auto service_path = device_path + "/service0001";
+        service = sdbus::createObject(bluez.connection, service_path);
+        service->registerProperty("UUID")
+            .onInterface(GATT_SERVICE_IFACE)
+            .withGetter([]() { return string(DEVICE_SERVICE_UUID); });
+        service->registerProperty("Primary")
+            .onInterface(GATT_SERVICE_IFACE)
+            .withGetter([]() { return true; });
+        service->registerProperty("Device")
+            .onInterface(GATT_SERVICE_IFACE)
+            .withGetter(
+                [device_path]() { return sdbus::ObjectPath(device_path); });
+        service->registerProperty("Includes")
+            .onInterface(GATT_SERVICE_IFACE)
+            .withGetter([]() { return vector<sdbus::ObjectPath>(); });
+        service->finishRegistration();
+
+        for (auto i = 0u; i < count; ++i) {
+            char char_name[sizeof("/charXXXX")];
+            (void)std::snprintf(char_name, sizeof(char_name), "/char%04x",
+                                (i + 2) & 0xffff);
+            auto characteristic =
+                sdbus::createObject(bluez.connection, service_path + char_name);
+
+            characteristic->registerProperty("UUID")
+                .onInterface(GATT_CHARACTERISTIC_IFACE)
+                .withGetter([i]() { return getCharacteristicUuid(i); });
+            characteristic->registerProperty("Service")
+                .onInterface(GATT_CHARACTERISTIC_IFACE)
+                .withGetter([service_path]() {
+                    return sdbus::ObjectPath(service_path);
+                });
+            characteristic->registerProperty("Flags")
+                .onInterface(GATT_CHARACTERISTIC_IFACE)
+                .withGetter([]() { return vector<string>({"read"}); });
+
+            /* Same value every read, so callers can check what they got */
+            auto value = vector<u8>({u8(seed & 0xff), u8((seed >> 8) & 0xff),
+                                     u8(i & 0xff), u8((i >> 8) & 0xff)});
+            characteristic->registerMethod("ReadValue")
+                .onInterface(GATT_CHARACTERISTIC_IFACE)
+                .withInputParamNames("options")
+                .withOutputParamNames("value")
+                .implementedAs([this, value](
+                                   sdbus::Result<vector<u8>> &&result,
+                                   map<string, sdbus::Variant> options) {
+                    if (!is_connected) {
+                        result.returnError(sdbus::Error(
+                            "org.bluez.Error.Failed", "Not connected"));
+                        return;
+                    }
+
+                    auto delay_ms = this->bluez.getConfig().read_delay_ms;
+                    if (delay_ms.count() == 0) {
+                        result.returnResults(value);
+                        return;
+                    }
+
+                    auto shared_result =
+                        std::make_shared<sdbus::Result<vector<u8>>>(
+                            std::move(result));
+                    this->bluez.runDelayed(
+                        reserve_air_time(delay_ms),
+                        [shared_result, value]() {
+                            shared_result->returnResults(value);
+                        });
+                });
+            characteristic->finishRegistration();
+
+            characteristics.push_back(std::move(characteristic));
+        }
+    }
+
+    void set_connected(bool connected) {
+        is_connected = connected;
+        object->emitPropertiesChangedSignal(DEVICE_IFACE,
+                                            {"Connected", "ServicesResolved"});
+    }
+
+  public:
+    Device(MockBluez &bluez, const string &adapter_path, const string &address,
+           const string &name, unsigned int seed)
+        : bluez(bluez), address(address), name(name) {
+        auto dev_name = address;
+        std::replace(dev_name.begin(), dev_name.end(), ':', '_');
+        object =
+            sdbus::createObject(bluez.connection, adapter_path + "/dev_" +
+                                                      dev_name);
+
+        /* Properties are as in a `GetAll` of a phone on BlueZ 5.63 */
+        object->registerProperty("Address")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([this]() { return this->address; });
+        object->registerProperty("AddressType")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return string("public"); });
+        object->registerProperty("Name")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([this]() { return this->name; });
+        object->registerProperty("Alias")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([this]() { return this->name; });
+        object->registerProperty("Class")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return PHONE_DEVICE_CLASS; });
+        object->registerProperty("Icon")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return string("phone"); });
+        object->registerProperty("Paired")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return true; });
+        object->registerProperty("Trusted")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return false; });
+        object->registerProperty("Blocked")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return false; });
+        object->registerProperty("LegacyPairing")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return false; });
+        object->registerProperty("Connected")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([this]() { return this->is_connected.load(); });
+        object->registerProperty("ServicesResolved")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([this]() { return this->is_connected.load(); });
+        object->registerProperty("RSSI")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([rssi_dbm = i16(STRONGEST_RSSI_DBM -
+                                        i16(seed % RSSI_SPREAD_DBM))]() {
+                return rssi_dbm;
+            });
+        object->registerProperty("TxPower")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return i16(0); });
+        object->registerProperty("UUIDs")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() {
+                return vector<string>({"00001105-0000-1000-8000-00805f9b34fb",
+                                       "0000110a-0000-1000-8000-00805f9b34fb",
+                                       "0000180a-0000-1000-8000-00805f9b34fb"});
+            });
+        object->registerProperty("ManufacturerData")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([seed]() {
+                return map<u16, sdbus::Variant>(
+                    {{APPLE_COMPANY_ID,
+                      sdbus::Variant(vector<u8>({0x10, 0x05, u8(seed & 0xff),
+                                                 u8((seed >> 8) & 0xff)}))}});
+            });
+        object->registerProperty("Modalias")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([]() { return string("bluetooth:v001Dp1200d1436"); });
+        object->registerProperty("Adapter")
+            .onInterface(DEVICE_IFACE)
+            .withGetter([adapter_path]() {
+                return sdbus::ObjectPath(adapter_path);
+            });
+
+        object->registerMethod("Connect")
+            .onInterface(DEVICE_IFACE)
+            .implementedAs([this](sdbus::Result<> &&result) {
+                const auto &config = this->bluez.getConfig();
+                auto delay_ms = config.connect_delay_ms;
+                auto is_failing =
+                    connect_count++ < config.failed_connects_per_device;
+                auto reply = [this, is_failing](const sdbus::Result<> &result) {
+                    if (is_failing) {
+                        result.returnError(sdbus::Error(
+                            "org.bluez.Error.Failed",
+                            "le-connection-abort-by-local"));
+                        return;
+                    }
+                    set_connected(true);
+                    result.returnResults();
+                };
+
+                if (delay_ms.count() == 0) {
+                    reply(result);
+                    return;
+                }
+
+                /* sdbus::Result is move only, std::function needs copyable */
+                auto shared_result =
+                    std::make_shared<sdbus::Result<>>(std::move(result));
+                this->bluez.runDelayed(delay_ms, [reply, shared_result]() {
+                    reply(*shared_result);
+                });
+            });
+        object->registerMethod("Disconnect")
+            .onInterface(DEVICE_IFACE)
+            .implementedAs([this]() { set_connected(false); });
+        object->registerMethod("Pair")
+            .onInterface(DEVICE_IFACE)
+            .implementedAs([]() { /* Always paired */ });
+        object->registerMethod("CancelPairing")
+            .onInterface(DEVICE_IFACE)
+            .implementedAs([]() { /* Nothing to cancel */ });
+
+        object->finishRegistration();
+
+        add_gatt_objects(seed);
+    }
+
+    void announce() {
+        object->emitInterfacesAddedSignal();
+        if (service) {
+            service->emitInterfacesAddedSignal();
+        }
+        for (auto &characteristic : characteristics) {
+            characteristic->emitInterfacesAddedSignal();
+        }
+    }
+
+    void withdraw() {
+        for (auto &characteristic : characteristics) {
+            characteristic->emitInterfacesRemovedSignal();
+        }
+        if (service) {
+            service->emitInterfacesRemovedSignal();
+        }
+        object->emitInterfacesRemovedSignal();
+    }
+
+    const string &getAddress() const { return address; }
+    const string &getName() const { return name; }
+    const string &getObjectPath() const { return object->getObjectPath(); }
+};
+
+class MockBluez::Adapter {
+    MockBluez &bluez;
+    std::unique_ptr<sdbus::IObject> object;
+    string address;
+    std::atomic<bool> is_powered{true};
+    std::atomic<bool> is_discovering{false};
+
+    /* Registered advertisement paths, and who registered them */
+    std::mutex advertisements_mutex;
+    map<string, string> advertisements;
+
+    /* Registered GATT application paths, and who registered them */
+    std::mutex applications_mutex;
+    map<string, string> applications;
+
+    void register_advertisement(const sdbus::ObjectPath &advertisement_path) {
+        auto sender = object->getCurrentlyProcessedMessage()->getSender();
+        {
+            std::lock_guard<std::mutex> lock(advertisements_mutex);
+            if (advertisements.size() >=
+                bluez.getConfig().supported_advertising_instances) {
+                throw sdbus::Error("org.bluez.Error.Failed",
+                                   "Maximum advertisements reached");
+            }
+            if (advertisements.count(advertisement_path) != 0) {
+                throw sdbus::Error("org.bluez.Error.AlreadyExists",
+                                   "Advertisement already registered");
+            }
+        }
+
+        /* Like bluez, read the advertisement's properties before replying,
+         * it's what makes clients without a running event loop hang */
+        auto properties = map<string, sdbus::Variant>();
+        sdbus::createProxy(bluez.connection, sender, advertisement_path)
+            ->callMethod("GetAll")
+            .onInterface("org.freedesktop.DBus.Properties")
+            .withArguments("org.bluez.LEAdvertisement1")
+            .storeResultsTo(properties);
+
+        if (properties.find("Type") == properties.cend()) {
+            throw sdbus::Error("org.bluez.Error.InvalidArguments",
+                               "Advertisement has no Type");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(advertisements_mutex);
+            advertisements[advertisement_path] = sender;
+        }
+        object->emitPropertiesChangedSignal(ADVERTISING_MANAGER_IFACE,
+                                            {"ActiveInstances"});
+    }
+
+    void unregister_advertisement(const sdbus::ObjectPath &advertisement_path) {
+        {
+            std::lock_guard<std::mutex> lock(advertisements_mutex);
+            if (advertisements.erase(advertisement_path) == 0) {
+                throw sdbus::Error("org.bluez.Error.DoesNotExist",
+                                   "No such advertisement");
+            }
+        }
+        object->emitPropertiesChangedSignal(ADVERTISING_MANAGER_IFACE,
+                                            {"ActiveInstances"});
+    }
+
+    void register_application(const sdbus::ObjectPath &application_path) {
+        auto sender = object->getCurrentlyProcessedMessage()->getSender();
+
+        /* Like bluez, walk the application's object tree before replying,
+         * there must be at least one service with a characteristic */
+        auto objects = map<sdbus::ObjectPath,
+                           map<string, map<string, sdbus::Variant>>>();
+        sdbus::createProxy(bluez.connection, sender, application_path)
+            ->callMethod("GetManagedObjects")
+            .onInterface("org.freedesktop.DBus.ObjectManager")
+            .storeResultsTo(objects);
+
+        auto has_service = false;
+        auto has_characteristic = false;
+        for (const auto &object : objects) {
+            has_service |=
+                object.second.count("org.bluez.GattService1") != 0;
+            has_characteristic |=
+                object.second.count("org.bluez.GattCharacteristic1") != 0;
+        }
+        if (!has_service || !has_characteristic) {
+            throw sdbus::Error("org.bluez.Error.InvalidArguments",
+                               "No service or characteristic in application");
+        }
+
+        std::lock_guard<std::mutex> lock(applications_mutex);
+        if (!applications.emplace(application_path, sender).second) {
+            throw sdbus::Error("org.bluez.Error.AlreadyExists",
+                               "Application already registered");
+        }
+    }
+
+    void unregister_application(const sdbus::ObjectPath &application_path) {
+        std::lock_guard<std::mutex> lock(applications_mutex);
+        if (applications.erase(application_path) == 0) {
+            throw sdbus::Error("org.bluez.Error.DoesNotExist",
+                               "No such application");
+        }
+    }
+
+    u8 get_active_instances() {
+        std::lock_guard<std::mutex> lock(advertisements_mutex);
+        return u8(advertisements.size());
+    }
+
+  public:
+    Adapter(MockBluez &bluez, const string &object_path, const string &address)
+        : bluez(bluez), address(address) {
+        object = sdbus::createObject(bluez.connection, object_path);
+
+        /* Properties as in logs/hci0_introspect_on_second_arch.log */
+        object->registerProperty("Address")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([this]() { return this->address; });
+        object->registerProperty("AddressType")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return string("public"); });
+        object->registerProperty("Name")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return string("BlueZ 5.63"); });
+        object->registerProperty("Alias")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return string("BlueZ 5.63"); });
+        object->registerProperty("Class")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return ADAPTER_CLASS; });
+        object->registerProperty("Powered")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([this]() { return this->is_powered.load(); })
+            .withSetter([this](const bool &powered) {
+                this->is_powered = powered;
+                this->object->emitPropertiesChangedSignal(ADAPTER_IFACE,
+                                                          {"Powered"});
+            });
+        object->registerProperty("Discoverable")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return false; });
+        object->registerProperty("DiscoverableTimeout")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return DISCOVERABLE_TIMEOUT_S; });
+        object->registerProperty("Pairable")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return false; });
+        object->registerProperty("PairableTimeout")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return u32(0); });
+        object->registerProperty("Discovering")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([this]() { return this->is_discovering.load(); });
+        object->registerProperty("UUIDs")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() {
+                return vector<string>({"00001801-0000-1000-8000-00805f9b34fb",
+                                       "00001800-0000-1000-8000-00805f9b34fb",
+                                       "0000180a-0000-1000-8000-00805f9b34fb"});
+            });
+        object->registerProperty("Modalias")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() { return string("usb:v1D6Bp0246d053F"); });
+        object->registerProperty("Roles")
+            .onInterface(ADAPTER_IFACE)
+            .withGetter([]() {
+                return vector<string>({"central", "peripheral"});
+            });
+
+        object->registerMethod("StartDiscovery")
+            .onInterface(ADAPTER_IFACE)
+            .implementedAs([this]() {
+                this->is_discovering = true;
+                this->object->emitPropertiesChangedSignal(ADAPTER_IFACE,
+                                                          {"Discovering"});
+            });
+        object->registerMethod("StopDiscovery")
+            .onInterface(ADAPTER_IFACE)
+            .implementedAs([this]() {
+                this->is_discovering = false;
+                this->object->emitPropertiesChangedSignal(ADAPTER_IFACE,
+                                                          {"Discovering"});
+            });
+        object->registerMethod("SetDiscoveryFilter")
+            .onInterface(ADAPTER_IFACE)
+            .withInputParamNames("properties")
+            .implementedAs([](const map<string, sdbus::Variant> &) {
+                /* Every mock device matches every filter */
+            });
+        object->registerMethod("GetDiscoveryFilters")
+            .onInterface(ADAPTER_IFACE)
+            .withOutputParamNames("filters")
+            .implementedAs([]() {
+                return vector<string>({"UUIDs", "RSSI", "Pathloss",
+                                       "Transport", "DuplicateData"});
+            });
+        object->registerMethod("RemoveDevice")
+            .onInterface(ADAPTER_IFACE)
+            .withInputParamNames("device")
+            .implementedAs([this](const sdbus::ObjectPath &device_path) {
+                if (!this->bluez.removeDevice(device_path)) {
+                    throw sdbus::Error("org.bluez.Error.DoesNotExist",
+                                       "No such device");
+                }
+            });
+
+        /* Same as logs/controller_primary_arch.log "Advertising Features" */
+        object->registerProperty("ActiveInstances")
+            .onInterface(ADVERTISING_MANAGER_IFACE)
+            .withGetter([this]() { return get_active_instances(); });
+        object->registerProperty("SupportedInstances")
+            .onInterface(ADVERTISING_MANAGER_IFACE)
+            .withGetter([this]() {
+                return u8(this->bluez.getConfig()
+                              .supported_advertising_instances -
+                          get_active_instances());
+            });
+        object->registerProperty("SupportedIncludes")
+            .onInterface(ADVERTISING_MANAGER_IFACE)
+            .withGetter([]() {
+                return vector<string>({"tx-power", "appearance", "local-name"});
+            });
+        object->registerMethod("RegisterAdvertisement")
+            .onInterface(ADVERTISING_MANAGER_IFACE)
+            .withInputParamNames("advertisement", "options")
+            .implementedAs([this](const sdbus::ObjectPath &advertisement_path,
+                                  const map<string, sdbus::Variant> &) {
+                register_advertisement(advertisement_path);
+            });
+        object->registerMethod("UnregisterAdvertisement")
+            .onInterface(ADVERTISING_MANAGER_IFACE)
+            .withInputParamNames("advertisement")
+            .implementedAs([this](const sdbus::ObjectPath &advertisement_path) {
+                unregister_advertisement(advertisement_path);
+            });
+
+        object->registerMethod("RegisterApplication")
+            .onInterface(GATT_MANAGER_IFACE)
+            .withInputParamNames("application", "options")
+            .implementedAs([this](const sdbus::ObjectPath &application_path,
+                                  const map<string, sdbus::Variant> &) {
+                register_application(application_path);
+            });
+        object->registerMethod("UnregisterApplication")
+            .onInterface(GATT_MANAGER_IFACE)
+            .withInputParamNames("application")
+            .implementedAs([this](const sdbus::ObjectPath &application_path) {
+                unregister_application(application_path);
+            });
+
+        object->finishRegistration();
+    }
+
+    const string &getObjectPath() const { return object->getObjectPath(); }
+};
+
+MockBluez::MockBluez(sdbus::IConnection &connection, MockBluezConfig config)
+    : connection(connection), config(config) {
+    /* GetManagedObjects is served by sd-bus itself, for all objects below the
+     * object manager */
+    root = sdbus::createObject(connection, "/");
+    root->addObjectManager();
+    root->finishRegistration();
+
+    for (auto i = 0u; i < config.adapter_count; ++i) {
+        char address[sizeof("XX:XX:XX:XX:XX:XX")];
+        (void)std::snprintf(address, sizeof(address), "AC:67:5D:EF:6F:%02X",
+                            0xea + i);
+        adapters.push_back(std::make_unique<Adapter>(
+            *this, "/org/bluez/hci" + std::to_string(i), address));
+    }
+
+    /* Not announced with InterfacesAdded, nobody can be listening to a name
+     * we haven't requested yet */
+    for (auto i = 0u; i < config.adapter_count; ++i) {
+        for (auto j = 0u; j < config.devices_per_adapter; ++j) {
+            auto seed = i * config.devices_per_adapter + j;
+            auto name =
+                DEVICE_NAME_PREFIXES[seed % DEVICE_NAME_PREFIXES.size()] +
+                " #" + std::to_string(seed);
+            devices.push_back(std::make_unique<Device>(
+                *this, adapters[i]->getObjectPath(), make_address(i, j), name,
+                seed));
+        }
+    }
+
+    connection.requestName(BLUEZ_DBUS_NAME);
+}
+
+MockBluez::~MockBluez() { connection.releaseName(BLUEZ_DBUS_NAME); }
+
+void MockBluez::addDevice(unsigned int adapter_index, const string &address,
+                          const string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto seed = unsigned(devices.size());
+    devices.push_back(std::make_unique<Device>(
+        *this, adapters.at(adapter_index)->getObjectPath(), address, name,
+        seed));
+    devices.back()->announce();
+}
+
+bool MockBluez::removeDevice(const string &device_object_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto device = std::find_if(devices.begin(), devices.end(),
+                               [&device_object_path](const auto &device) {
+                                   return device->getObjectPath() ==
+                                          device_object_path;
+                               });
+    if (device == devices.end()) {
+        return false;
+    }
+
+    /* Announce before destroying, sd-bus needs the object to list its
+     * interfaces in InterfacesRemoved */
+    (*device)->withdraw();
+    devices.erase(device);
+    return true;
+}
+
+string MockBluez::getAdapterPath(unsigned int adapter_index) const {
+    return adapters.at(adapter_index)->getObjectPath();
+}
+
+vector<string> MockBluez::getDeviceAddresses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto addresses = vector<string>();
+    addresses.reserve(devices.size());
+    for (const auto &device : devices) {
+        addresses.push_back(device->getAddress());
+    }
+
+    return addresses;
+}
+
+vector<string> MockBluez::getDeviceNames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto names = vector<string>();
+    names.reserve(devices.size());
+    for (const auto &device : devices) {
+        names.push_back(device->getName());
+    }
+
+    return names;
+}
+
+const MockBluezConfig &MockBluez::getConfig() const { return config; }
+
+string MockBluez::getCharacteristicUuid(unsigned int index) {
+    char uuid[sizeof("0000XXXX-0000-1000-8000-00805f9b34fb")];
+    (void)std::snprintf(uuid, sizeof(uuid),
+                        "0000%04x-0000-1000-8000-00805f9b34fb",
+                        (FIRST_CHARACTERISTIC_UUID16 + index) & 0xffff);
+    return uuid;
+}
+
+void MockBluez::runDelayed(std::chrono::milliseconds delay_ms,
+                           std::function<void()> task) {
+    delayed_replies.scheduleAfter(delay_ms, std::move(task));
+}
@@ -0,0 +1,90 @@
+/**
+ * @file private_bus.cpp
+ * @author Aditya Gupta (adityag.ug19.cs@nitp.ac.in)
+ * @brief Spawning and stopping a private dbus-daemon
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Apache License (c) 2022
+ *
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mock/private_bus.h"
+
+using std::string;
+
+namespace {
+const auto READ_END = 0;
+const auto WRITE_END = 1;
+const auto EXEC_FAILED_EXIT_CODE = 127;
+
+string get_errno_message(const string &what) {
+    return what + ": " + std::strerror(errno);
+}
+} // namespace
+
+PrivateBus::PrivateBus() {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == -1) {
+        throw std::runtime_error(get_errno_message("pipe"));
+    }
+
+    daemon_pid = fork();
+    if (daemon_pid == -1) {
+        (void)close(pipe_fds[READ_END]);
+        (void)close(pipe_fds[WRITE_END]);
+        throw std::runtime_error(get_errno_message("fork"));
+    }
+
+    if (daemon_pid == 0) {
+        /* Child: dbus-daemon writes its address followed by a newline, to
+         * the fd passed in --print-address */
+        (void)close(pipe_fds[READ_END]);
+        auto print_address =
+            "--print-address=" + std::to_string(pipe_fds[WRITE_END]);
+        execlp("dbus-daemon", "dbus-daemon", "--session", "--nofork",
+               "--nopidfile", print_address.c_str(), (char *)nullptr);
+        _exit(EXEC_FAILED_EXIT_CODE);
+    }
+
+    (void)close(pipe_fds[WRITE_END]);
+
+    char c;
+    ssize_t read_bytes;
+    while ((read_bytes = read(pipe_fds[READ_END], &c, 1)) == 1 && c != '\n') {
+        address.push_back(c);
+    }
+    (void)close(pipe_fds[READ_END]);
+
+    if (address.empty()) {
+        (void)kill(daemon_pid, SIGTERM);
+        (void)waitpid(daemon_pid, nullptr, 0);
+        throw std::runtime_error(
+            "Could not start dbus-daemon, is it installed and in PATH ?");
+    }
+
+    if (setenv("DBUS_SYSTEM_BUS_ADDRESS", address.c_str(), 1) == -1 ||
+        setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1) == -1) {
+        (void)kill(daemon_pid, SIGTERM);
+        (void)waitpid(daemon_pid, nullptr, 0);
+        throw std::runtime_error(get_errno_message("setenv"));
+    }
+}
+
+PrivateBus::~PrivateBus() {
+    if (daemon_pid > 0) {
+        (void)kill(daemon_pid, SIGTERM);
+        (void)waitpid(daemon_pid, nullptr, 0);
+    }
+}
+
+const std::string &PrivateBus::getAddress() const { return address; }